@@ -0,0 +1,203 @@
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+#include "core/order_types.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// Every MSVC target is little-endian; GCC and Clang report it through __BYTE_ORDER__.
+#if !defined(_MSC_VER) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "The binary order-entry protocol is read and written in host byte order, which must be little-endian"
+#endif
+
+namespace GoQuant
+{
+
+    // Fixed-layout order-entry messages carried in WebSocket binary frames,
+    // one message per frame. A connection switches to them with a JSON
+    // {"type": "logon", "protocol": "binary", "version": 1} request, whose
+    // reply lists each symbol's id, tick size and step size; text frames
+    // stay JSON either way. Prices are in ticks and quantities in lots, so
+    // messages map straight onto engine types. All integers are
+    // little-endian and structs are packed.
+    namespace Binary
+    {
+
+        constexpr uint8_t PROTOCOL_VERSION = 1;
+
+        enum class MessageType : uint8_t
+        {
+            NEW_ORDER = 1,
+            CANCEL = 2,
+            AMEND = 3,
+            MASS_CANCEL = 4,
+            ACK = 101,
+            FILL = 102,
+            REJECT = 103
+        };
+
+        enum class TimeInForce : uint8_t
+        {
+            GTC = 0,
+            GTT = 1,
+            GFD = 2
+        };
+
+        // Side filter of a MASS_CANCEL.
+        constexpr uint8_t ANY_SIDE = 0xFF;
+
+        // With matching threads configured the gateway only queues order
+        // entry, so it acks with the *_QUEUED statuses. A matching thread
+        // that then refuses the request sends a REJECT for it.
+        enum class AckStatus : uint8_t
+        {
+            ACCEPTED = 0,
+            CANCELLED = 1,
+            AMENDED = 2,
+            MASS_CANCEL_QUEUED = 3,
+            ORDER_QUEUED = 4,
+            CANCEL_QUEUED = 5,
+            AMEND_QUEUED = 6
+        };
+
+        enum class RejectReason : uint8_t
+        {
+            MALFORMED = 1,
+            UNSUPPORTED_VERSION = 2,
+            UNKNOWN_SYMBOL = 3,
+            INVALID_FIELD = 4,
+            UNKNOWN_ORDER = 5,
+            ENGINE_REJECTED = 6,
+            // The client order id still names a live order of the session.
+            DUPLICATE_ORDER = 7
+        };
+
+#pragma pack(push, 1)
+
+        struct Header
+        {
+            uint8_t version;
+            MessageType type;
+            // Size of the whole message, header included.
+            uint16_t length;
+        };
+
+        // Client to gateway. Side and order type use the engine's OrderSide
+        // and OrderType values.
+        struct NewOrder
+        {
+            Header header;
+            uint8_t side;
+            uint8_t order_type;
+            TimeInForce time_in_force;
+            uint8_t reserved;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+            Price price;
+            Quantity quantity;
+            // Epoch milliseconds; only read for GTT.
+            uint64_t expire_time;
+        };
+
+        struct Cancel
+        {
+            Header header;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+        };
+
+        struct Amend
+        {
+            Header header;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+            Price price;
+            Quantity quantity;
+        };
+
+        // INVALID_SYMBOL_ID for every symbol, ANY_SIDE for both sides.
+        struct MassCancel
+        {
+            Header header;
+            SymbolId symbol_id;
+            uint8_t side;
+        };
+
+        // Gateway to client.
+        struct Ack
+        {
+            Header header;
+            AckStatus status;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+            uint64_t timestamp;
+        };
+
+        struct Fill
+        {
+            Header header;
+            uint8_t is_maker;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+            uint64_t trade_id;
+            Price price;
+            Quantity quantity;
+            uint64_t timestamp;
+        };
+
+        struct Reject
+        {
+            Header header;
+            RejectReason reason;
+            // Type of the message being rejected.
+            MessageType request_type;
+            SymbolId symbol_id;
+            uint64_t client_order_id;
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(Header) == 4, "Header layout is part of the wire format");
+        static_assert(sizeof(NewOrder) == 44, "NewOrder layout is part of the wire format");
+        static_assert(sizeof(Cancel) == 16, "Cancel layout is part of the wire format");
+        static_assert(sizeof(Amend) == 32, "Amend layout is part of the wire format");
+        static_assert(sizeof(MassCancel) == 9, "MassCancel layout is part of the wire format");
+        static_assert(sizeof(Ack) == 25, "Ack layout is part of the wire format");
+        static_assert(sizeof(Fill) == 49, "Fill layout is part of the wire format");
+        static_assert(sizeof(Reject) == 18, "Reject layout is part of the wire format");
+
+        // Copies a frame into `message`. False unless the frame is exactly
+        // one T and its header agrees; callers pick T from header.type.
+        template <typename T>
+        bool read(std::string_view frame, T &message)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "wire messages are plain data");
+            if (frame.size() != sizeof(T))
+                return false;
+            std::memcpy(&message, frame.data(), sizeof(T));
+            return message.header.length == sizeof(T);
+        }
+
+        template <typename T>
+        T make(MessageType type)
+        {
+            T message{};
+            message.header.version = PROTOCOL_VERSION;
+            message.header.type = type;
+            message.header.length = sizeof(T);
+            return message;
+        }
+
+        template <typename T>
+        std::string_view bytes(const T &message)
+        {
+            return std::string_view(reinterpret_cast<const char *>(&message), sizeof(T));
+        }
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CLIENT_ORDER_MAP_HPP
+#define CLIENT_ORDER_MAP_HPP
+
+#include "core/order_types.hpp"
+#include <unordered_map>
+
+namespace GoQuant
+{
+
+    // A session's live orders by the id its client gave them. An id names
+    // one live order at a time: it cannot be taken again until the order
+    // holding it has finished and been released.
+    template <typename Id>
+    class ClientOrderMap
+    {
+    public:
+        bool contains(const Id &id) const { return orders_.count(id) != 0; }
+
+        // INVALID_ORDER_HANDLE when the id is not live.
+        OrderHandle find(const Id &id) const
+        {
+            auto it = orders_.find(id);
+            return it != orders_.end() ? it->second : INVALID_ORDER_HANDLE;
+        }
+
+        // Returns false, leaving the live order in place, if the id is taken.
+        bool insert(const Id &id, OrderHandle handle) { return orders_.emplace(id, handle).second; }
+
+        // Frees the id if it still names `handle`.
+        void release(const Id &id, OrderHandle handle)
+        {
+            auto it = orders_.find(id);
+            if (it != orders_.end() && it->second == handle)
+                orders_.erase(it);
+        }
+
+        size_t size() const { return orders_.size(); }
+
+    private:
+        std::unordered_map<Id, OrderHandle> orders_;
+    };
+
+}
+
+#endif
@@ -15,19 +15,43 @@ namespace GoQuant
     public:
         static OrderRequest parse_order_request(const std::string &json_str);
         static CancelRequest parse_cancel_request(const std::string &json_str);
+        static AmendRequest parse_amend_request(const std::string &json_str);
+        static MassCancelRequest parse_mass_cancel_request(const std::string &json_str);
         static MarketDataRequest parse_market_data_request(const std::string &json_str);
+        static BatchRequest parse_batch_request(const nlohmann::json &j);
+        static OrderType parse_order_type(const std::string &order_type);
+        static OrderSide parse_order_side(const std::string &side);
+        // Order::expire_time for a request's time in force; 0 for GTC.
+        static uint64_t resolve_expire_time(const std::string &time_in_force, uint64_t expire_time);
         static std::string serialize_order_response(const OrderResponse &response);
         static std::string serialize_error_response(const ErrorResponse &response);
-        static std::string serialize_trade(const Trade &trade);
+        static std::string serialize_batch_response(const std::vector<OrderResponse> &responses);
+        static std::string serialize_mass_cancel_response(const MassCancelRequest &request, bool accepted);
+        static std::string serialize_trade(const Trade &trade, const std::string &symbol,
+                                           const PriceScale &scale);
+        // Full-depth snapshot that an order_book_delta stream continues from.
         static std::string serialize_order_book_update(const std::string &symbol,
-                                                       const std::vector<std::pair<double, double>> &bids,
-                                                       const std::vector<std::pair<double, double>> &asks,
+                                                       const std::vector<std::pair<Price, Quantity>> &bids,
+                                                       const std::vector<std::pair<Price, Quantity>> &asks,
+                                                       const PriceScale &scale,
+                                                       uint64_t sequence,
                                                        uint64_t timestamp);
+        static std::string serialize_order_book_delta(const std::string &symbol,
+                                                      const std::vector<LevelDelta> &deltas,
+                                                      const PriceScale &scale,
+                                                      uint64_t sequence,
+                                                      uint64_t timestamp);
         static std::string serialize_bbo_update(const std::string &symbol,
-                                                double best_bid, double best_ask,
+                                                const BBO &bbo,
+                                                const PriceScale &scale,
                                                 uint64_t timestamp);
 
         static uint64_t get_current_timestamp();
+
+    private:
+        static OrderRequest order_request_from_json(const nlohmann::json &j);
+        static CancelRequest cancel_request_from_json(const nlohmann::json &j);
+        static nlohmann::json order_response_to_json(const OrderResponse &response);
     };
 
 }
@@ -0,0 +1,63 @@
+#ifndef MESSAGE_DECODER_HPP
+#define MESSAGE_DECODER_HPP
+
+#include "message_types.hpp"
+#include <cstdint>
+#include <string_view>
+
+namespace GoQuant
+{
+
+    enum class InboundType : uint8_t
+    {
+        UNKNOWN = 0,
+        ORDER = 1,
+        CANCEL = 2,
+        AMEND = 3,
+        MASS_CANCEL = 4,
+        BATCH = 5,
+        SUBSCRIBE = 6,
+        UNSUBSCRIBE = 7,
+        LOGON = 8,
+        SNAPSHOT = 9
+    };
+
+    // Top-level fields of one inbound frame. Strings are views into the
+    // frame and only live as long as it does; absent fields keep their
+    // defaults, matching what the JSON parser's value() lookups return.
+    struct InboundMessage
+    {
+        InboundType type = InboundType::UNKNOWN;
+        std::string_view symbol;
+        std::string_view order_type;
+        std::string_view side;
+        std::string_view order_id;
+        std::string_view time_in_force;
+        double quantity = 0.0;
+        double price = 0.0;
+        uint64_t expire_time = 0;
+    };
+
+    // Single-pass decoder for the order-entry messages. It walks the frame
+    // once, keeps the fields it knows as views and skips everything else,
+    // without building a DOM or allocating. Anything outside the fast path
+    // (escaped strings in a captured field, a field of the wrong JSON type,
+    // malformed input) makes decode() return false, and the caller falls
+    // back to the full JSON parser to decode or reject the frame.
+    class MessageDecoder
+    {
+    public:
+        static bool decode(std::string_view frame, InboundMessage &message);
+
+        // Copy the decoded fields into a request. The request's strings keep
+        // their capacity, so reusing one request per connection or thread
+        // does not allocate once warmed up.
+        static void fill(const InboundMessage &message, OrderRequest &request);
+        static void fill(const InboundMessage &message, CancelRequest &request);
+        static void fill(const InboundMessage &message, AmendRequest &request);
+        static void fill(const InboundMessage &message, MassCancelRequest &request);
+    };
+
+}
+
+#endif
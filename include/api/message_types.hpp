@@ -13,6 +13,10 @@ namespace GoQuant
         double quantity;
         double price;
         std::string order_id;
+        // "gtc" (default), "gtt" with expire_time in epoch milliseconds, or
+        // "gfd" for the end of the current UTC day.
+        std::string time_in_force;
+        uint64_t expire_time = 0;
 
         OrderRequest() = default;
         OrderRequest(const std::string &sym, const std::string &type,
@@ -29,6 +33,37 @@ namespace GoQuant
         CancelRequest(const std::string &sym, const std::string &id)
             : symbol(sym), order_id(id) {}
     };
+    // New price and total quantity for a resting order, applied as one
+    // cancel/replace by the engine.
+    struct AmendRequest
+    {
+        std::string symbol;
+        std::string order_id;
+        double quantity;
+        double price;
+
+        AmendRequest() = default;
+        AmendRequest(const std::string &sym, const std::string &id, double qty, double prc)
+            : symbol(sym), order_id(id), quantity(qty), price(prc) {}
+    };
+    // Cancels the sender's live orders. Empty symbol or side means all.
+    struct MassCancelRequest
+    {
+        std::string symbol;
+        std::string side;
+
+        MassCancelRequest() = default;
+        MassCancelRequest(const std::string &sym, const std::string &s)
+            : symbol(sym), side(s) {}
+    };
+    // Several orders and cancels in one frame. Cancels are applied before
+    // orders so a quote update can replace resting orders atomically from
+    // the client's point of view.
+    struct BatchRequest
+    {
+        std::vector<OrderRequest> orders;
+        std::vector<CancelRequest> cancels;
+    };
     struct MarketDataRequest
     {
         std::string symbol;
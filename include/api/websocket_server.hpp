@@ -3,15 +3,42 @@
 
 #include "core/matching_engine.hpp"
 #include "api/message_types.hpp"
+#include "api/message_decoder.hpp"
+#include "api/binary_protocol.hpp"
+#include "api/client_order_map.hpp"
+#include <nlohmann/json.hpp>
 #include <uwebsockets/App.h>
 #include <thread>
 #include <atomic>
 #include <unordered_map>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 namespace GoQuant
 {
 
+    // Per-connection state. Client order ids are only meaningful at the
+    // gateway; the engine and books work purely with OrderHandles.
+    struct PerSocketData
+    {
+        SessionId session_id = INVALID_SESSION_ID;
+        ClientOrderMap<std::string> orders;
+        // Set by a binary logon; binary orders are keyed by their numeric
+        // client order id.
+        bool binary = false;
+        ClientOrderMap<uint64_t> binary_orders;
+    };
+
+    using WebSocket = uWS::WebSocket<false, true, PerSocketData>;
+
+    enum class MarketDataChannel : uint8_t
+    {
+        BBO = 0,
+        DEPTH = 1,
+        TRADES = 2
+    };
+
     class WebSocketServer
     {
     public:
@@ -20,33 +47,90 @@ namespace GoQuant
 
         void start();
         void stop();
-        void broadcast_market_data(const std::string &symbol, const std::string &message);
+        // Publishes one encoded update to everyone subscribed to the channel
+        // on that symbol. The message is shared by all subscribers rather
+        // than copied per socket. Safe to call from any thread.
+        void broadcast_market_data(MarketDataChannel channel, SymbolId symbol_id, std::string message);
         void broadcast_trade(const Trade &trade);
+        // Sends FILL messages for a trade to the binary sessions that own
+        // either side and forgets orders it fills out. Safe to call from any
+        // thread.
+        void report_fill(const Trade &trade);
+        // Engine order events. ORDER_CLOSED drops the order's routes; a
+        // rejection from a matching thread goes to the session that sent the
+        // request. Safe to call from any thread.
+        void report_order_event(const EngineEvent &event);
 
     private:
         MatchingEngine &engine_;
         int port_;
         std::atomic<bool> running_{false};
+        std::atomic<SessionId> next_session_id_{1};
+        bool cancel_on_disconnect_ = true;
         std::thread server_thread_;
 
         std::unique_ptr<uWS::App> app_;
+        uWS::Loop *loop_ = nullptr;
 
-        std::unordered_map<std::string, std::unordered_set<uWS::WebSocket<false, true> *>> bbo_subscribers_;
-        std::unordered_map<std::string, std::unordered_set<uWS::WebSocket<false, true> *>> depth_subscribers_;
-        std::unordered_map<std::string, std::unordered_set<uWS::WebSocket<false, true> *>> trade_subscribers_;
-        std::mutex subscribers_mutex_;
+        // Live orders of every session by handle, for routing fills and
+        // releasing client ids. Only touched on the server thread; fills and
+        // order events are deferred onto it in the order the engine produced
+        // them, so an entry outlives every fill of its order. Entries go when
+        // a fill leaves the order at zero, on ORDER_CLOSED, or when the
+        // connection closes.
+        struct OrderOwner
+        {
+            WebSocket *ws;
+            // Binary sessions name orders by number, JSON sessions by string.
+            uint64_t client_order_id;
+            std::string order_id;
+            bool binary;
+        };
+        std::unordered_map<OrderHandle, OrderOwner> order_owners_;
+        std::atomic<int> binary_sessions_{0};
 
-        void run_server();
-        void handle_order_request(uWS::WebSocket<false, true> *ws, const std::string &message);
-        void handle_cancel_request(uWS::WebSocket<false, true> *ws, const std::string &message);
-        void handle_market_data_request(uWS::WebSocket<false, true> *ws, const std::string &message);
+        int active_connections_ = 0;
+        std::mutex connections_mutex_;
 
-        void send_message(uWS::WebSocket<false, true> *ws, const std::string &message);
+        // Decode scratch for the order-entry fast path. Frames are handled
+        // one at a time on the server thread, so one set is enough and the
+        // strings keep their capacity between frames.
+        InboundMessage inbound_;
+        OrderRequest order_request_;
+        CancelRequest cancel_request_;
+        AmendRequest amend_request_;
+        MassCancelRequest mass_cancel_request_;
+
+        void run_server();
+        void handle_message(WebSocket *ws, std::string_view message);
+        void handle_json_message(WebSocket *ws, std::string_view message);
+        void handle_order_request(WebSocket *ws, const OrderRequest &request);
+        void handle_cancel_request(WebSocket *ws, const CancelRequest &request);
+        void handle_amend_request(WebSocket *ws, const AmendRequest &request);
+        void handle_mass_cancel_request(WebSocket *ws, const MassCancelRequest &request);
+        void handle_logon_request(WebSocket *ws, const nlohmann::json &message);
+        void handle_binary_message(WebSocket *ws, std::string_view message);
+        void handle_binary_order(WebSocket *ws, const Binary::NewOrder &message);
+        void handle_binary_cancel(WebSocket *ws, const Binary::Cancel &message);
+        void handle_binary_amend(WebSocket *ws, const Binary::Amend &message);
+        void handle_binary_mass_cancel(WebSocket *ws, const Binary::MassCancel &message);
+        void deliver_fill(const Trade &trade);
+        void retire_order(OrderHandle handle);
+        void deliver_order_event(EngineEvent::Type type, OrderHandle handle, SymbolId symbol_id);
+        void release_orders(WebSocket *ws);
+        void handle_batch_request(WebSocket *ws, const nlohmann::json &message);
+        bool make_order(const OrderRequest &request, SessionId session, Order &order, ErrorResponse &error);
+        void handle_market_data_request(WebSocket *ws, const std::string &message);
+        void handle_unsubscribe_request(WebSocket *ws, const std::string &message);
+        void handle_snapshot_request(WebSocket *ws, const std::string &message);
+        void send_depth_snapshot(WebSocket *ws, SymbolId symbol_id);
+        bool resolve_subscription(WebSocket *ws, const MarketDataRequest &request, std::string &topic,
+                                  MarketDataChannel &channel, SymbolId &symbol_id);
 
-        void subscribe_bbo(uWS::WebSocket<false, true> *ws, const std::string &symbol);
-        void subscribe_depth(uWS::WebSocket<false, true> *ws, const std::string &symbol);
-        void subscribe_trades(uWS::WebSocket<false, true> *ws, const std::string &symbol);
-        void unsubscribe_all(uWS::WebSocket<false, true> *ws);
+        void send_message(WebSocket *ws, const std::string &message);
+        void send_binary_ack(WebSocket *ws, Binary::AckStatus status, SymbolId symbol_id, uint64_t client_order_id);
+        void send_binary_reject(WebSocket *ws, Binary::RejectReason reason, Binary::MessageType request_type,
+                                SymbolId symbol_id, uint64_t client_order_id);
     };
 
 }
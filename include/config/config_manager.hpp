@@ -1,6 +1,7 @@
 #ifndef CONFIG_MANAGER_HPP
 #define CONFIG_MANAGER_HPP
 
+#include "core/fixed_point.hpp"
 #include <nlohmann/json.hpp>
 #include <string>
 #include <mutex>
@@ -22,6 +23,16 @@ struct EngineConfig {
     double quantity_step = 0.001;
     bool enable_advanced_orders = true;
     int performance_stats_interval = 5;
+    int order_pool_size = 65536;
+    int level_pool_size = 4096;
+    int matching_threads = 0;
+    int matching_queue_size = 65536;
+    bool pin_matching_threads = false;
+    bool cancel_on_disconnect = true;
+    int expiry_check_interval_ms = 100;
+    int trigger_cascade_depth = 8;
+    int market_data_bbo_interval_ms = 0;
+    int market_data_depth_interval_ms = 5;
     
     nlohmann::json to_json() const;
     static EngineConfig from_json(const nlohmann::json& j);
@@ -35,11 +46,15 @@ struct SymbolConfig {
     double max_quantity;
     double price_tick;
     double quantity_step;
+    std::string book_type;
     
     SymbolConfig(const std::string& sym = "", double min_p = 0.0, double max_p = 1000000.0,
-                 double min_q = 0.001, double max_q = 10000.0, double tick = 0.01, double step = 0.001)
+                 double min_q = 0.001, double max_q = 10000.0, double tick = 0.01, double step = 0.001,
+                 const std::string& book = "map")
         : symbol(sym), min_price(min_p), max_price(max_p), min_quantity(min_q),
-          max_quantity(max_q), price_tick(tick), quantity_step(step) {}
+          max_quantity(max_q), price_tick(tick), quantity_step(step), book_type(book) {}
+    
+    PriceScale get_price_scale() const { return PriceScale(price_tick, quantity_step); }
     
     nlohmann::json to_json() const;
     static SymbolConfig from_json(const nlohmann::json& j);
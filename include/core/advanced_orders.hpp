@@ -2,8 +2,15 @@
 #define ADVANCED_ORDERS_HPP
 
 #include "order_types.hpp"
+#include "symbol_registry.hpp"
+#include "trailing_stops.hpp"
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace GoQuant
 {
@@ -20,42 +27,56 @@ namespace GoQuant
     {
         std::string order_id;
         std::string symbol;
+        SymbolId symbol_id;
         AdvancedOrderType advanced_type;
         OrderType order_type;
         OrderSide side;
-        double quantity;
-        double price;
-        double trigger_price;
-        double trailing_distance;
-        bool triggered;
+        Quantity quantity;
+        Price price;
+        Price trigger_price;
+        Price trailing_distance;
         uint64_t timestamp;
 
-        std::function<void(const AdvancedOrder &)> on_trigger;
-
-        AdvancedOrder(const std::string &id, const std::string &sym,
+        AdvancedOrder(const std::string &id, const std::string &sym, SymbolId sym_id,
                       AdvancedOrderType adv_type, OrderType ord_type, OrderSide s,
-                      double qty, double prc, double trigger_prc, double trail_dist = 0.0)
-            : order_id(id), symbol(sym), advanced_type(adv_type), order_type(ord_type),
+                      Quantity qty, Price prc, Price trigger_prc, Price trail_dist = 0)
+            : order_id(id), symbol(sym), symbol_id(sym_id), advanced_type(adv_type), order_type(ord_type),
               side(s), quantity(qty), price(prc), trigger_price(trigger_prc),
-              trailing_distance(trail_dist), triggered(false), timestamp(0) {}
+              trailing_distance(trail_dist), timestamp(0) {}
     };
 
     class AdvancedOrderManager
     {
     public:
-        AdvancedOrderManager();
+        // Symbols are resolved through the engine's registry; orders for
+        // names it does not know are refused.
+        explicit AdvancedOrderManager(const SymbolRegistry &symbols);
+
+        // Records the scale of the symbol's book, which log lines convert
+        // ticks and lots with.
+        void add_symbol(SymbolId symbol_id, const PriceScale &scale);
 
-        void add_stop_loss(const std::string &symbol, OrderSide side, double quantity,
-                           double trigger_price, double execution_price = 0.0);
-        void add_stop_limit(const std::string &symbol, OrderSide side, double quantity,
-                            double trigger_price, double limit_price);
-        void add_take_profit(const std::string &symbol, OrderSide side, double quantity,
-                             double trigger_price, double execution_price = 0.0);
-        void add_trailing_stop(const std::string &symbol, OrderSide side, double quantity,
-                               double trailing_distance, double initial_price = 0.0);
+        // Each add returns the new order's id, or an empty string if the
+        // order was refused.
+        std::string add_stop_loss(const std::string &symbol, OrderSide side, Quantity quantity,
+                                  Price trigger_price, Price execution_price = 0);
+        std::string add_stop_limit(const std::string &symbol, OrderSide side, Quantity quantity,
+                                   Price trigger_price, Price limit_price);
+        std::string add_take_profit(const std::string &symbol, OrderSide side, Quantity quantity,
+                                    Price trigger_price, Price execution_price = 0);
+        std::string add_trailing_stop(const std::string &symbol, OrderSide side, Quantity quantity,
+                                      Price trailing_distance, Price initial_price = 0);
 
-        void check_triggers(const std::string &symbol, double current_price);
-        void cancel_advanced_order(const std::string &order_id);
+        // Releases every order whose trigger the price has reached. Triggered
+        // orders are handed to the order callback after the manager's lock is
+        // dropped, so the callback may add or cancel advanced orders.
+        void check_triggers(SymbolId symbol_id, Price current_price);
+        // Same release, but the orders are appended to `released`, nearest
+        // trigger first, for the caller to enter itself. Returns the count.
+        size_t collect_triggered(SymbolId symbol_id, Price current_price, std::vector<Order> &released);
+        bool cancel_advanced_order(const std::string &order_id);
+
+        size_t get_order_count() const;
 
         void set_order_callback(std::function<void(const Order &)> callback)
         {
@@ -63,11 +84,71 @@ namespace GoQuant
         }
 
     private:
-        std::unordered_map<std::string, std::vector<AdvancedOrder>> advanced_orders_;
-        std::mutex orders_mutex_;
+        // Orders in a trigger book fire in book order up to the current
+        // price: ascending triggers for orders waiting on a rise, descending
+        // for orders waiting on a fall. Ties keep arrival order.
+        struct TriggerOrdering
+        {
+            bool descending;
+            bool operator()(Price a, Price b) const { return descending ? a > b : a < b; }
+        };
+        using TriggerBook = std::multimap<Price, AdvancedOrder, TriggerOrdering>;
+
+        enum class TriggerDirection
+        {
+            RISING = 0,
+            FALLING = 1,
+            TRAILING = 2
+        };
+
+        struct SymbolTriggers
+        {
+            // Buy stops and sell take-profits.
+            TriggerBook rising{TriggerOrdering{false}};
+            // Sell stops and buy take-profits.
+            TriggerBook falling{TriggerOrdering{true}};
+            // Trailing stops move their trigger with the price, so every
+            // update runs the ratchet kernel over them. Indexed by OrderSide.
+            TrailingStopBook trailing[2]{TrailingStopBook{OrderSide::BUY}, TrailingStopBook{OrderSide::SELL}};
+            PriceScale scale;
+        };
+
+        // Cold half of a trailing stop; `row` is its index in the owning
+        // TrailingStopBook.
+        struct TrailingSlot
+        {
+            AdvancedOrder order;
+            size_t row;
+        };
+
+        struct OrderLocation
+        {
+            SymbolId symbol_id;
+            TriggerDirection direction;
+            TriggerBook::iterator entry;
+            uint64_t trailing_slot;
+        };
+
+        const SymbolRegistry &symbols_;
+        // Indexed by SymbolId.
+        std::vector<SymbolTriggers> advanced_orders_;
+        std::unordered_map<std::string, OrderLocation> order_index_;
+        // Indexed by trailing-stop handle; freed handles are reused.
+        std::vector<TrailingSlot> trailing_slots_;
+        std::vector<uint64_t> free_trailing_slots_;
+        std::vector<size_t> fired_rows_;
+        mutable std::mutex orders_mutex_;
         std::function<void(const Order &)> order_callback_;
 
-        void trigger_order(const AdvancedOrder &advanced_order, double current_price);
+        std::string add_order(const std::string &symbol, AdvancedOrderType advanced_type, OrderType order_type,
+                              OrderSide side, Quantity quantity, Price price, Price trigger_price,
+                              Price trailing_distance = 0);
+        void take_crossed(TriggerBook &book, Price current_price, std::vector<AdvancedOrder> &fired);
+        uint64_t add_trailing(SymbolTriggers &triggers, AdvancedOrder &&order);
+        void check_trailing(TrailingStopBook &book, Price current_price, std::vector<AdvancedOrder> &fired);
+        void remove_trailing(TrailingStopBook &book, uint64_t slot);
+        void take_triggered(SymbolId symbol_id, Price current_price, std::vector<AdvancedOrder> &fired);
+        Order to_order(const AdvancedOrder &advanced_order) const;
         std::string generate_order_id();
     };
 
@@ -0,0 +1,71 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace GoQuant
+{
+
+    // Prices are carried as integer multiples of the symbol's price tick and
+    // quantities as integer multiples of its quantity step. Doubles only exist
+    // at the API edge (JSON, config, snapshots) and go through PriceScale.
+    using Price = int64_t;
+    using Quantity = int64_t;
+
+    struct PriceScale
+    {
+        double price_tick;
+        double quantity_step;
+
+        PriceScale(double tick = 0.01, double step = 0.001)
+            : price_tick(tick), quantity_step(step) {}
+
+        Price to_ticks(double price) const
+        {
+            return static_cast<Price>(std::llround(price / price_tick));
+        }
+
+        Quantity to_lots(double quantity) const
+        {
+            return static_cast<Quantity>(std::llround(quantity / quantity_step));
+        }
+
+        double to_price(Price ticks) const
+        {
+            return static_cast<double>(ticks) * price_tick;
+        }
+
+        double to_quantity(Quantity lots) const
+        {
+            return static_cast<double>(lots) * quantity_step;
+        }
+
+        bool is_on_tick(double price) const
+        {
+            return std::abs(to_price(to_ticks(price)) - price) < price_tick * 1e-6;
+        }
+
+        bool is_on_step(double quantity) const
+        {
+            return std::abs(to_quantity(to_lots(quantity)) - quantity) < quantity_step * 1e-6;
+        }
+
+        std::vector<std::pair<double, double>> to_decimal_levels(
+            const std::vector<std::pair<Price, Quantity>> &levels) const
+        {
+            std::vector<std::pair<double, double>> result;
+            result.reserve(levels.size());
+            for (const auto &[price, quantity] : levels)
+            {
+                result.emplace_back(to_price(price), to_quantity(quantity));
+            }
+            return result;
+        }
+    };
+
+}
+
+#endif
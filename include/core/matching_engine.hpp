@@ -2,52 +2,179 @@
 #define MATCHING_ENGINE_HPP
 
 #include "order_book.hpp"
+#include "matching_shard.hpp"
 #include "advanced_orders.hpp"
+#include "symbol_registry.hpp"
 #include "fees/fee_calculator.hpp"
 #include "utils/performance_counter.hpp"
-#include <unordered_map>
 #include <memory>
 #include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
 
 namespace GoQuant {
 
+// With matching_threads == 0 orders match inline on the caller's thread.
+// Otherwise each symbol is owned by one MatchingShard thread, submit/cancel
+// only enqueue, and trades reach the trade callback from a dispatcher
+// thread that drains the shards' outbound rings. Either way, stop and
+// take-profit orders are checked against every trade print and entered
+// by whichever thread did the matching (see TriggerCascade).
+//
+// Callbacks are wired first and start() called once after, before the
+// engine is shared with other threads; the callbacks are then read without
+// locking. In sharded mode commands submitted before start() wait in the
+// shard queues.
 class MatchingEngine {
 public:
     MatchingEngine();
+    explicit MatchingEngine(size_t matching_threads);
+    ~MatchingEngine();
     
-    bool submit_order(Order order);
-    bool cancel_order(const std::string& symbol, const std::string& order_id);
+    // Starts the matching and dispatcher threads in sharded mode and freezes
+    // the callbacks in either mode. Only the first call has any effect.
+    void start();
+    
+    // Assigns the order its handle; returns INVALID_ORDER_HANDLE on rejection.
+    // In sharded mode a valid handle means the order was queued for matching.
+    // The symbol is taken from order.symbol_id, or looked up by name when
+    // the id is unset.
+    OrderHandle submit_order(Order order);
+    bool cancel_order(SymbolId symbol_id, OrderHandle handle);
+    bool cancel_order(const std::string& symbol, OrderHandle handle);
+    // Cancel/replace of a resting order; see OrderBook::amend_order for the
+    // priority rules. In sharded mode true means the amend was queued.
+    bool amend_order(SymbolId symbol_id, OrderHandle handle, Price new_price, Quantity new_quantity);
+    
+    // Cancels a session's live orders in every book, or only in `symbol_id`
+    // and/or on `side`, with one command and one lock pass per book.
+    // Returns false for an unknown symbol. Never lost to a full shard queue,
+    // since cancel-on-disconnect relies on it.
+    bool cancel_session_orders(SessionId session, SymbolId symbol_id = INVALID_SYMBOL_ID,
+                               std::optional<OrderSide> side = std::nullopt);
+    
+    // Batch variants: one engine lookup pass, one lock acquisition and BBO
+    // publication per book, and one trade-batch callback per call. Results
+    // line up index for index with the input.
+    std::vector<OrderHandle> submit_orders(std::vector<Order> orders);
+    std::vector<bool> cancel_orders(const std::vector<std::pair<SymbolId, OrderHandle>>& cancels);
+    
+    // Expires GTT/GFD orders due at or before `now_ms` in every book. In
+    // sharded mode the work is queued to each book's matching thread, so it
+    // never races that book's matching.
+    void expire_orders(uint64_t now_ms);
+    
+    // Blocks until every queued command has matched and its events have
+    // been dispatched. Returns immediately in inline mode. Only meaningful
+    // after start().
+    void wait_until_idle() const;
+    bool is_sharded() const { return !shards_.empty(); }
     
     std::shared_ptr<OrderBook> get_order_book(const std::string& symbol);
-    void add_symbol(const std::string& symbol);
+    std::shared_ptr<OrderBook> get_order_book(SymbolId symbol_id);
+    // Registers the symbol if needed and returns its id.
+    SymbolId add_symbol(const std::string& symbol);
+    // Calls `listener` with every existing book and then with each book
+    // add_symbol creates, under the engine lock, so no book is missed or
+    // seen twice. The listener must not call back into the engine.
+    // nullptr removes it.
+    void set_book_listener(std::function<void(OrderBook&)> listener);
     
-    void set_trade_callback(std::function<void(const Trade&)> callback) {
-        trade_callback_ = callback;
-    }
+    const SymbolRegistry& get_symbol_registry() const { return symbols_; }
+    SymbolId get_symbol_id(const std::string& symbol) const { return symbols_.find(symbol); }
+    
+    // Both setters are refused once start() has run.
+    void set_trade_callback(std::function<void(const Trade&)> callback);
+    
+    // Receives every trade produced by one batch (or one dispatcher pass in
+    // sharded mode) in a single call, after the per-trade callbacks.
+    void set_trade_batch_callback(std::function<void(const std::vector<Trade>&)> callback);
+    
+    // Receives ORDER_CLOSED for every accepted order that leaves the book
+    // other than by filling out, after the trades that led to it. Called on
+    // the matching caller's thread inline and on the dispatcher when sharded.
+    // Sharded mode also reports the rejections of requests it had queued.
+    void set_order_event_callback(std::function<void(const EngineEvent&)> callback);
 
     AdvancedOrderManager& get_advanced_order_manager() { return advanced_order_manager_; }
     FeeCalculator& get_fee_calculator() { return fee_calculator_; }
     
-    void update_market_price(const std::string& symbol, double price);
+    // Checks stops against a mark price, on the book's matching thread in
+    // sharded mode.
+    void update_market_price(SymbolId symbol_id, Price price);
+    void update_market_price(const std::string& symbol, Price price);
     
     uint64_t get_orders_processed() const { return orders_processed_; }
     double get_throughput_ops() const;
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<OrderBook>> order_books_;
-    std::mutex engine_mutex_;
+    struct BookEntry {
+        std::shared_ptr<OrderBook> book;
+        MatchingShard* shard = nullptr;
+    };
+
+    // Indexed by SymbolId; only add_symbol grows it.
+    SymbolRegistry symbols_;
+    std::vector<BookEntry> books_;
+    mutable std::shared_mutex engine_mutex_;
     std::function<void(const Trade&)> trade_callback_;
+    std::function<void(const std::vector<Trade>&)> trade_batch_callback_;
+    std::function<void(const EngineEvent&)> order_event_callback_;
+    std::function<void(OrderBook&)> book_listener_;
     
     AdvancedOrderManager advanced_order_manager_;
     FeeCalculator fee_calculator_;
+    size_t trigger_cascade_depth_;
     ThroughputCounter throughput_counter_;
     std::atomic<uint64_t> orders_processed_{0};
+    std::atomic<OrderHandle> next_handle_{1};
+    bool started_ = false;
+    
+    // Declared before shards_, which hold a pointer to it.
+    EventSignal dispatch_signal_;
+    std::vector<std::unique_ptr<MatchingShard>> shards_;
+    std::thread dispatcher_thread_;
+    std::atomic<bool> dispatching_{false};
+    
+    void create_shards(size_t matching_threads);
+    bool events_pending() const;
+    SymbolId resolve_symbol(const Order& order) const;
+    bool find_entry(SymbolId symbol_id, BookEntry& entry) const;
+    void dispatch_loop();
+    bool dispatch_events();
+    void report_trade(const OrderBook& book, const Trade& trade);
+    void cascade_triggers(OrderBook& book, Price price, std::vector<Trade>& trades);
+    
+    std::vector<Trade> dispatched_trades_;
+    std::vector<uint64_t> dispatch_counts_;
     
     void on_trade_executed(const Trade& trade) {
         if (trade_callback_) {
             trade_callback_(trade);
         }
     }
+    
+    void on_trades_executed(const std::vector<Trade>& trades) {
+        if (trade_batch_callback_ && !trades.empty()) {
+            trade_batch_callback_(trades);
+        }
+    }
+    
+    void on_order_event(const EngineEvent& event) {
+        if (order_event_callback_) {
+            order_event_callback_(event);
+        }
+    }
+    
+    void report_closed(SymbolId symbol_id, OrderHandle handle) {
+        EngineEvent event;
+        event.type = EngineEvent::Type::ORDER_CLOSED;
+        event.handle = handle;
+        event.symbol_id = symbol_id;
+        on_order_event(event);
+    }
 };
 
 } 
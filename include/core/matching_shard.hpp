@@ -0,0 +1,146 @@
+#ifndef MATCHING_SHARD_HPP
+#define MATCHING_SHARD_HPP
+
+#include "order_book.hpp"
+#include "trigger_cascade.hpp"
+#include "utils/ring_buffer.hpp"
+#include "utils/event_signal.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace GoQuant {
+
+struct EngineCommand {
+    enum class Type : uint8_t {
+        SUBMIT = 0,
+        CANCEL = 1,
+        SUBMIT_BATCH = 2,
+        CANCEL_BATCH = 3,
+        AMEND = 4,
+        MASS_CANCEL = 5,
+        EXPIRE = 6,
+        TRIGGER = 7
+    };
+
+    Type type = Type::SUBMIT;
+    OrderBook* book = nullptr;
+    Order order;
+    OrderHandle handle = INVALID_ORDER_HANDLE;
+    // Target price and total quantity of an AMEND of `handle`; `price` is
+    // also the mark price a TRIGGER checks stops against.
+    Price price = 0;
+    Quantity quantity = 0;
+    // Owner and optional side filter of a MASS_CANCEL.
+    SessionId session = INVALID_SESSION_ID;
+    std::optional<OrderSide> side;
+    // Clock reading, in milliseconds, that an EXPIRE runs the book up to.
+    uint64_t now_ms = 0;
+    // Only populated for the batch variants; all entries target `book`.
+    std::vector<Order> orders;
+    std::vector<OrderHandle> handles;
+};
+
+// ORDER_CLOSED says an accepted order is gone for good: its submit or an
+// amend left nothing resting, or it was cancelled, mass cancelled or
+// expired. A resting order that fills out is only seen as a trade whose
+// leaves for that side are zero.
+struct EngineEvent {
+    enum class Type : uint8_t {
+        TRADE = 0,
+        ORDER_REJECTED = 1,
+        CANCEL_REJECTED = 2,
+        AMEND_REJECTED = 3,
+        ORDER_CLOSED = 4
+    };
+
+    Type type = Type::TRADE;
+    OrderHandle handle = INVALID_ORDER_HANDLE;
+    SymbolId symbol_id = INVALID_SYMBOL_ID;
+    Trade trade{};
+};
+
+// One matching thread and the books it owns. Any thread may enqueue
+// commands; only the shard thread ever mutates its books, and results go
+// out through a single-consumer ring drained by the engine's dispatcher.
+// With a trigger cascade, stops set off by a command's trades are entered
+// before the next command runs. `events_ready` is notified after every
+// command that published events, so the dispatcher can sleep while idle.
+class MatchingShard {
+public:
+    MatchingShard(size_t id, size_t queue_size, int cpu = -1,
+                  std::unique_ptr<TriggerCascade> cascade = nullptr, EventSignal* events_ready = nullptr);
+    ~MatchingShard();
+
+    MatchingShard(const MatchingShard&) = delete;
+    MatchingShard& operator=(const MatchingShard&) = delete;
+
+    void start();
+    // Processes everything already enqueued, then joins the thread.
+    void stop();
+
+    // Returns false when the ingress ring is full.
+    bool enqueue(EngineCommand&& command);
+    // For commands that must not be lost. One that finds the ring full is
+    // parked instead, and runs once everything enqueued before it has run
+    // and ahead of anything enqueued after.
+    void enqueue_or_park(EngineCommand&& command);
+    // Dispatcher side of the outbound ring. Events count as pending until
+    // acknowledged, which the dispatcher does after running its callbacks.
+    bool poll_event(EngineEvent& event);
+    void acknowledge_events(uint64_t count);
+    // True while published events are still waiting to be acknowledged.
+    bool has_pending_events() const;
+
+    // True once every enqueued command has been executed and every event
+    // it produced has been dispatched and acknowledged.
+    bool idle() const;
+
+    size_t get_id() const { return id_; }
+    uint64_t get_commands_processed() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    size_t id_;
+    int cpu_;
+    MpscRing<EngineCommand> inbound_;
+    SpscRing<EngineEvent> outbound_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> enqueued_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> events_published_{0};
+    std::atomic<uint64_t> events_consumed_{0};
+
+    // Parked commands with the ring position they run at. parked_count_
+    // lets the shard skip the lock while nothing is parked.
+    std::mutex parked_mutex_;
+    std::vector<std::pair<size_t, EngineCommand>> parked_;
+    std::atomic<size_t> parked_count_{0};
+    std::vector<EngineCommand> unparked_;
+
+    std::vector<Trade> trades_;
+    std::vector<bool> results_;
+    std::vector<OrderHandle> closed_;
+    std::unique_ptr<TriggerCascade> cascade_;
+    EventSignal* events_ready_;
+
+    void run();
+    bool run_parked();
+    void process(EngineCommand& command);
+    void execute(EngineCommand& command);
+    void publish(EngineEvent&& event);
+    void publish_trades(OrderHandle handle);
+    void run_cascade(OrderBook& book, Price price);
+    void publish_rejection(EngineEvent::Type type, OrderHandle handle, SymbolId symbol_id);
+    void publish_closed(OrderHandle handle, SymbolId symbol_id);
+    void pin_to_cpu();
+};
+
+}
+
+#endif
@@ -2,15 +2,20 @@
 #define ORDER_BOOK_HPP
 
 #include "order_types.hpp"
+#include "order_index.hpp"
+#include "session_index.hpp"
+#include "price_ladder.hpp"
 #include "trade.hpp"
+#include "utils/object_pool.hpp"
+#include "utils/dirty_set.hpp"
+#include "utils/seqlock.hpp"
+#include "utils/timing_wheel.hpp"
 #include <map>
 #include <vector>
 #include <memory>
 #include <mutex>
 #include <functional>
-#include <queue>
-#include <deque>
-#include <unordered_map>
+#include <optional>
 
 namespace GoQuant
 {
@@ -18,50 +23,155 @@ namespace GoQuant
     class OrderBook
     {
     public:
-        explicit OrderBook(const std::string &symbol);
+        explicit OrderBook(const std::string &symbol, const PriceScale &scale = PriceScale(),
+                           LadderType ladder_type = LadderType::MAP,
+                           size_t order_pool_size = 4096, size_t level_pool_size = 1024,
+                           SymbolId symbol_id = 0);
+        ~OrderBook();
 
         bool add_order(Order &order, TradeCallback trade_cb);
-        bool cancel_order(const std::string &order_id);
-        bool modify_order(const std::string &order_id, double new_quantity);
+        bool add_order(Order &order, std::vector<Trade> &trades);
+        bool cancel_order(OrderHandle handle);
 
-        double get_best_bid() const;
-        double get_best_ask() const;
-        std::string get_symbol() const { return symbol_; }
+        // Apply a run of orders or cancels under one lock acquisition and one
+        // BBO publication. Results line up index for index with the input.
+        void add_orders(std::vector<Order> &orders, std::vector<Trade> &trades, std::vector<bool> &accepted);
+        void cancel_orders(const std::vector<OrderHandle> &handles, std::vector<bool> &cancelled);
 
-        std::vector<std::pair<double, double>> get_bid_levels(size_t depth = 10) const;
-        std::vector<std::pair<double, double>> get_ask_levels(size_t depth = 10) const;
+        // Cancel/replace in one call. A size-down at the same price keeps the
+        // order's queue position; a reprice or size-up sends it to the back of
+        // its new level, matching first if the new price crosses. Amending to
+        // the filled quantity or below it removes the order or is refused.
+        bool amend_order(OrderHandle handle, Price new_price, Quantity new_quantity, TradeCallback trade_cb);
+        bool amend_order(OrderHandle handle, Price new_price, Quantity new_quantity, std::vector<Trade> &trades);
+        // Amend at the current price; never trades.
+        bool modify_order(OrderHandle handle, Quantity new_quantity);
+
+        // Cancels every live order of `session`, or only those on `side`, in
+        // one lock pass. Returns the number of orders removed and, when
+        // `removed` is given, appends their handles to it.
+        size_t cancel_session_orders(SessionId session, std::optional<OrderSide> side = std::nullopt,
+                                     std::vector<OrderHandle> *removed = nullptr);
+        size_t get_session_order_count(SessionId session) const;
+
+        // Expires every resting order whose expire_time is at or before
+        // `now_ms`. Must run on the thread that owns the book's matching.
+        // Returns the number of orders removed; `removed` as above.
+        size_t expire_orders(uint64_t now_ms, std::vector<OrderHandle> *removed = nullptr);
+        size_t get_pending_expiry_count() const;
+
+        // Lock-free snapshot of the top of book; never waits on matching.
+        BBO get_bbo() const { return bbo_.load(); }
+        Price get_best_bid() const { return get_bbo().bid_price; }
+        Price get_best_ask() const { return get_bbo().ask_price; }
+        const std::string &get_symbol() const { return symbol_; }
+        SymbolId get_symbol_id() const { return symbol_id_; }
+        const PriceScale &get_scale() const { return scale_; }
+        LadderType get_ladder_type() const { return ladder_type_; }
+
+        std::vector<std::pair<Price, Quantity>> get_bid_levels(size_t depth = 10) const;
+        std::vector<std::pair<Price, Quantity>> get_ask_levels(size_t depth = 10) const;
+
+        // Incremental depth. Once tracking is on, every level an operation
+        // touches is journalled with the quantity it had before its first
+        // touch. drain_depth_changes() turns the journal into one delta per
+        // level whose quantity actually differs, so any number of changes to
+        // a level between drains collapse into one, and bumps the depth
+        // sequence when it emits anything. Returns that sequence.
+        void enable_depth_tracking();
+        // After any operation that moves the top of book or leaves depth
+        // changes undrained, the book marks its symbol id in `changes`.
+        // nullptr detaches. The mark is made under the book lock, so a
+        // consumer that clears it before reading the book misses nothing.
+        void set_change_set(DirtySet *changes);
+        uint64_t drain_depth_changes(std::vector<LevelDelta> &deltas);
+        // Every level on both sides as of the last drain, and that drain's
+        // sequence. Changes made since are left out; the next drain reports
+        // them against exactly this state.
+        uint64_t get_depth_snapshot(std::vector<std::pair<Price, Quantity>> &bids,
+                                    std::vector<std::pair<Price, Quantity>> &asks) const;
+
+        // Rebuilds the full order view of a resting order from its hot record
+        // and its details. Returns false when the handle is not resting. The
+        // book does not keep client order ids; `order.handle` names it.
+        bool get_order(OrderHandle handle, Order &order) const;
+        bool has_order(OrderHandle handle) const;
 
         size_t get_total_orders() const { return order_lookup_.size(); }
+        PoolStats get_order_pool_stats() const;
+        PoolStats get_level_pool_stats() const;
 
     private:
         std::string symbol_;
-        std::map<double, std::deque<Order>> bids_;
-        std::map<double, std::deque<Order>> asks_;
+        SymbolId symbol_id_;
+        PriceScale scale_;
+        LadderType ladder_type_;
+        ObjectPool<OrderNode> order_pool_;
+        ObjectPool<OrderDetails> details_pool_;
+        LevelPool level_pool_;
+        std::unique_ptr<PriceLadder> bids_;
+        std::unique_ptr<PriceLadder> asks_;
 
-        struct OrderLocation
+        OrderIndex order_lookup_;
+        SessionIndex session_index_;
+        // Millisecond ticks keyed by OrderHandle; only orders with an
+        // expire_time are filed here.
+        TimingWheel expiry_wheel_;
+        uint64_t next_trade_id_;
+
+        mutable std::mutex book_mutex_;
+
+        SeqLock<BBO> bbo_;
+        BBO last_bbo_;
+
+        // Quantity of each level before its first touch since the last drain,
+        // in touch order. A level's `journaled` flag keeps it to one entry;
+        // a level erased and recreated between drains gets a second entry,
+        // which the drain folds into the first.
+        struct JournalEntry
         {
-            bool is_bid;
-            double price_level;
-            size_t order_index;
+            Price price;
+            Quantity before;
         };
-        std::unordered_map<std::string, OrderLocation> order_lookup_;
+        bool track_depth_ = false;
+        std::vector<JournalEntry> bid_journal_;
+        std::vector<JournalEntry> ask_journal_;
+        uint64_t depth_sequence_ = 0;
+        DirtySet *changes_ = nullptr;
 
-        mutable std::mutex book_mutex_;
+        bool process_order(Order &order, TradeCallback &trade_cb);
+        bool process_cancel(OrderHandle handle);
+        bool process_amend(OrderNode *node, Price new_price, Quantity new_quantity, const TradeCallback &trade_cb);
+        Order to_order(const OrderNode &node) const;
 
-        void match_order(Order &order, TradeCallback trade_cb);
-        bool try_match_market_order(Order &order, TradeCallback trade_cb);
-        bool try_match_limit_order(Order &order, TradeCallback trade_cb);
-        bool try_match_ioc_order(Order &order, TradeCallback trade_cb);
-        bool try_match_fok_order(Order &order, TradeCallback trade_cb);
+        // Returns true when the order was left resting on the book. The only
+        // runtime branch on side and type lives here; each combination then
+        // runs its own specialised loop.
+        bool match_order(Order &order, const TradeCallback &trade_cb);
+        template <OrderSide Side, OrderType Type>
+        bool match(Order &order, const TradeCallback &trade_cb);
+        template <OrderSide Side>
+        bool can_fill_completely(const Order &order) const;
+        template <OrderSide Side>
+        PriceLadder &same_side();
+        template <OrderSide Side>
+        PriceLadder &opposite_side();
+        void fill_level(Order &order, PriceLevel &level, const TradeCallback &trade_cb);
 
-        void execute_trade(Order &taker, Order &maker, double price,
-                           double quantity, TradeCallback trade_cb);
+        void execute_trade(Order &taker, OrderNode &maker_node, Price price,
+                           Quantity quantity, const TradeCallback &trade_cb);
 
-        void add_to_book(Order &order);
-        void remove_from_book(const std::string &order_id);
-        bool can_match_buy(double price) const;
-        bool can_match_sell(double price) const;
-        double get_matching_price(const Order &taker, const Order &maker) const;
+        void add_to_book(Order &order, PriceLadder &ladder);
+        void remove_from_book(OrderHandle handle);
+        void remove_node(OrderNode *node);
+        void release_node(OrderNode *node);
+        void publish_bbo();
+        void journal_level(OrderSide side, PriceLevel &level);
+        void collect_changes(OrderSide side, const PriceLadder &ladder, std::vector<JournalEntry> &journal,
+                             std::vector<LevelDelta> &deltas);
+        std::vector<std::pair<Price, Quantity>> collect_levels(const PriceLadder &ladder, size_t depth) const;
+        std::vector<std::pair<Price, Quantity>> drained_levels(OrderSide side, const PriceLadder &ladder,
+                                                               const std::vector<JournalEntry> &journal) const;
     };
 
 }
@@ -0,0 +1,143 @@
+#ifndef ORDER_INDEX_HPP
+#define ORDER_INDEX_HPP
+
+#include "price_ladder.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace GoQuant
+{
+
+    // Flat open-addressing map from OrderHandle to resting node. Linear
+    // probing with Fibonacci hashing; deletes backward-shift the probe run so
+    // there are no tombstones and lookups never degrade under cancel churn.
+    // Handle 0 (INVALID_ORDER_HANDLE) marks an empty slot.
+    class OrderIndex
+    {
+    public:
+        explicit OrderIndex(size_t expected_orders = 1024)
+            : size_(0)
+        {
+            size_t capacity = 16;
+            while (capacity < expected_orders * 2)
+            {
+                capacity <<= 1;
+            }
+            resize(capacity);
+        }
+
+        OrderNode *find(OrderHandle handle) const
+        {
+            for (size_t i = home(handle);; i = (i + 1) & mask_)
+            {
+                const Slot &slot = slots_[i];
+                if (slot.handle == handle)
+                    return slot.node;
+                if (slot.handle == INVALID_ORDER_HANDLE)
+                    return nullptr;
+            }
+        }
+
+        bool insert(OrderHandle handle, OrderNode *node)
+        {
+            if ((size_ + 1) * 2 > slots_.size())
+            {
+                resize(slots_.size() * 2);
+            }
+
+            size_t i = home(handle);
+            while (slots_[i].handle != INVALID_ORDER_HANDLE)
+            {
+                if (slots_[i].handle == handle)
+                    return false;
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = Slot{handle, node};
+            ++size_;
+            return true;
+        }
+
+        bool erase(OrderHandle handle)
+        {
+            size_t i = home(handle);
+            while (slots_[i].handle != handle)
+            {
+                if (slots_[i].handle == INVALID_ORDER_HANDLE)
+                    return false;
+                i = (i + 1) & mask_;
+            }
+
+            for (size_t j = (i + 1) & mask_; slots_[j].handle != INVALID_ORDER_HANDLE; j = (j + 1) & mask_)
+            {
+                size_t k = home(slots_[j].handle);
+                bool movable = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+                if (movable)
+                {
+                    slots_[i] = slots_[j];
+                    i = j;
+                }
+            }
+            slots_[i] = Slot{INVALID_ORDER_HANDLE, nullptr};
+            --size_;
+            return true;
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        template <typename Fn>
+        void for_each(Fn fn) const
+        {
+            for (const Slot &slot : slots_)
+            {
+                if (slot.handle != INVALID_ORDER_HANDLE)
+                    fn(slot.handle, slot.node);
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            OrderHandle handle;
+            OrderNode *node;
+        };
+
+        std::vector<Slot> slots_;
+        size_t mask_;
+        unsigned shift_;
+        size_t size_;
+
+        size_t home(OrderHandle handle) const
+        {
+            return static_cast<size_t>((handle * 0x9E3779B97F4A7C15ULL) >> shift_);
+        }
+
+        void resize(size_t capacity)
+        {
+            std::vector<Slot> old;
+            old.swap(slots_);
+            slots_.assign(capacity, Slot{INVALID_ORDER_HANDLE, nullptr});
+            mask_ = capacity - 1;
+            shift_ = 64;
+            for (size_t c = capacity; c > 1; c >>= 1)
+            {
+                --shift_;
+            }
+
+            for (const Slot &slot : old)
+            {
+                if (slot.handle == INVALID_ORDER_HANDLE)
+                    continue;
+                size_t i = home(slot.handle);
+                while (slots_[i].handle != INVALID_ORDER_HANDLE)
+                {
+                    i = (i + 1) & mask_;
+                }
+                slots_[i] = slot;
+            }
+        }
+    };
+
+}
+
+#endif
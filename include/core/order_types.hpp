@@ -1,14 +1,28 @@
 #ifndef ORDER_TYPES_HPP
 #define ORDER_TYPES_HPP
 
+#include "fixed_point.hpp"
 #include <string>
 #include <cstdint>
 #include <functional>
-#include <cmath>
 
 namespace GoQuant
 {
 
+    // Dense engine-assigned order identifier. Client order ids are mapped to
+    // handles at the gateway; the engine and books only ever see handles.
+    using OrderHandle = uint64_t;
+    constexpr OrderHandle INVALID_ORDER_HANDLE = 0;
+
+    // Dense engine-assigned symbol identifier; names only exist at the edges.
+    using SymbolId = uint32_t;
+    constexpr SymbolId INVALID_SYMBOL_ID = UINT32_MAX;
+
+    // Gateway connection that owns an order. Orders without a session are
+    // never touched by mass cancel.
+    using SessionId = uint32_t;
+    constexpr SessionId INVALID_SESSION_ID = 0;
+
     enum class OrderSide : uint8_t
     {
         BUY = 0,
@@ -37,36 +51,50 @@ namespace GoQuant
     struct Order
     {
         std::string order_id;
+        OrderHandle handle;
         std::string symbol;
+        // Resolved from `symbol` by the engine when left unset.
+        SymbolId symbol_id = INVALID_SYMBOL_ID;
+        SessionId session_id = INVALID_SESSION_ID;
         OrderType type;
         OrderSide side;
-        double quantity;
-        double filled_quantity;
-        double price;
+        Quantity quantity;
+        Quantity filled_quantity;
+        Price price;
         uint64_t timestamp;
         OrderStatus status;
-        double leaves_quantity;
+        Quantity leaves_quantity;
+        // Milliseconds since the epoch after which a resting order expires;
+        // 0 means good till cancelled.
+        uint64_t expire_time = 0;
 
         Order() = default;
 
         Order(const std::string &id, const std::string &sym, OrderType t,
-              OrderSide s, double qty, double prc, uint64_t ts)
-            : order_id(id), symbol(sym), type(t), side(s),
-              quantity(qty), filled_quantity(0.0), price(prc),
+              OrderSide s, Quantity qty, Price prc, uint64_t ts)
+            : order_id(id), handle(INVALID_ORDER_HANDLE), symbol(sym), type(t), side(s),
+              quantity(qty), filled_quantity(0), price(prc),
               timestamp(ts), status(OrderStatus::PENDING),
               leaves_quantity(qty) {}
 
         bool is_fully_filled() const
         {
-            return std::abs(leaves_quantity) < 1e-10;
+            return leaves_quantity == 0;
+        }
+
+        // For an accepted order after matching: whether any of it was left
+        // on the book. Only limit orders rest.
+        bool rests() const
+        {
+            return type == OrderType::LIMIT && leaves_quantity > 0;
         }
 
-        bool can_fill(double fill_qty) const
+        bool can_fill(Quantity fill_qty) const
         {
             return fill_qty <= leaves_quantity && status == OrderStatus::ACTIVE;
         }
 
-        void fill(double fill_qty, double fill_price)
+        void fill(Quantity fill_qty, Price fill_price)
         {
             filled_quantity += fill_qty;
             leaves_quantity -= fill_qty;
@@ -81,6 +109,35 @@ namespace GoQuant
         }
     };
 
+    // Top of book as published by OrderBook. Prices are 0 for an empty side;
+    // sequence increases by one on every change to any field.
+    struct BBO
+    {
+        Price bid_price = 0;
+        Quantity bid_quantity = 0;
+        Price ask_price = 0;
+        Quantity ask_quantity = 0;
+        uint64_t sequence = 0;
+    };
+
+    enum class LevelAction : uint8_t
+    {
+        ADD = 0,
+        UPDATE = 1,
+        DELETE = 2
+    };
+
+    // One price level's change in the incremental depth feed. quantity is
+    // the level's new total, so applying a delta is idempotent; it is 0 for
+    // DELETE.
+    struct LevelDelta
+    {
+        Price price;
+        Quantity quantity;
+        OrderSide side;
+        LevelAction action;
+    };
+
     struct Trade;
     using TradeCallback = std::function<void(const Trade &)>;
     using OrderUpdateCallback = std::function<void(const Order &)>;
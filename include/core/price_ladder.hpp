@@ -0,0 +1,246 @@
+#ifndef PRICE_LADDER_HPP
+#define PRICE_LADDER_HPP
+
+#include "order_types.hpp"
+#include "utils/object_pool.hpp"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace GoQuant
+{
+
+    enum class LadderType : uint8_t
+    {
+        MAP = 0,
+        DENSE = 1
+    };
+
+    LadderType parse_ladder_type(const std::string &name);
+
+    struct PriceLevel;
+    struct OrderNode;
+    struct TimerNode;
+
+    // The part of a resting order that matching reads and writes. Filled
+    // quantity is not stored: it is always details->quantity - leaves_quantity.
+    struct RestingOrder
+    {
+        OrderHandle handle;
+        Price price;
+        Quantity leaves_quantity;
+        OrderSide side;
+        OrderStatus status;
+
+        explicit RestingOrder(const Order &o)
+            : handle(o.handle), price(o.price), leaves_quantity(o.leaves_quantity),
+              side(o.side), status(o.status) {}
+
+        bool is_fully_filled() const { return leaves_quantity == 0; }
+
+        void fill(Quantity fill_qty)
+        {
+            leaves_quantity -= fill_qty;
+            status = leaves_quantity == 0 ? OrderStatus::FILLED : OrderStatus::PARTIALLY_FILLED;
+        }
+    };
+
+    static_assert(sizeof(RestingOrder) <= 32, "RestingOrder must stay within half a cache line");
+
+    // Identity and audit data for a resting order. Lives in its own pool and
+    // is only touched on modify, queries and removal, never by a fill. The
+    // session links belong to the book's SessionIndex and `expiry` to its
+    // expiry wheel. Client order ids stay with the gateway, which maps them
+    // to handles, so nothing here allocates.
+    struct OrderDetails
+    {
+        Quantity quantity;
+        uint64_t timestamp;
+        uint64_t expire_time;
+        OrderType type;
+        SessionId session;
+        OrderNode *node;
+        OrderDetails *session_prev;
+        OrderDetails *session_next;
+        TimerNode *expiry;
+
+        explicit OrderDetails(const Order &o)
+            : quantity(o.quantity), timestamp(o.timestamp), expire_time(o.expire_time),
+              type(o.type), session(o.session_id), node(nullptr), session_prev(nullptr), session_next(nullptr),
+              expiry(nullptr) {}
+    };
+
+    // Resting order linked into its level's FIFO. The book's lookup table
+    // points straight at the node, so unlinking never searches the queue.
+    struct OrderNode
+    {
+        RestingOrder order;
+        OrderNode *prev;
+        OrderNode *next;
+        PriceLevel *level;
+        OrderDetails *details;
+
+        explicit OrderNode(const Order &o, OrderDetails *d = nullptr)
+            : order(o), prev(nullptr), next(nullptr), level(nullptr), details(d) {}
+    };
+
+    static_assert(sizeof(OrderNode) <= 64, "OrderNode must fit in one cache line");
+
+    // total_quantity and order_count are kept in step with the queue on
+    // every add, fill, modify and cancel so depth reads never walk orders.
+    // `journaled` is owned by the book's depth journal.
+    struct PriceLevel
+    {
+        Price price;
+        OrderNode *head;
+        OrderNode *tail;
+        Quantity total_quantity;
+        uint32_t order_count;
+        bool journaled;
+
+        explicit PriceLevel(Price p)
+            : price(p), head(nullptr), tail(nullptr), total_quantity(0), order_count(0), journaled(false) {}
+
+        bool empty() const { return head == nullptr; }
+
+        void push_back(OrderNode *node)
+        {
+            total_quantity += node->order.leaves_quantity;
+            ++order_count;
+            node->level = this;
+            node->prev = tail;
+            node->next = nullptr;
+            if (tail)
+                tail->next = node;
+            else
+                head = node;
+            tail = node;
+        }
+
+        void unlink(OrderNode *node)
+        {
+            total_quantity -= node->order.leaves_quantity;
+            --order_count;
+            if (node->prev)
+                node->prev->next = node->next;
+            else
+                head = node->next;
+            if (node->next)
+                node->next->prev = node->prev;
+            else
+                tail = node->prev;
+            node->prev = nullptr;
+            node->next = nullptr;
+            node->level = nullptr;
+        }
+    };
+
+    using LevelPool = ObjectPool<PriceLevel>;
+
+    // One side of a book. Levels live in the book's LevelPool and never move,
+    // so callers may hold a PriceLevel* across inserts and erases of other
+    // levels.
+    class PriceLadder
+    {
+    public:
+        PriceLadder(bool is_bid, LevelPool &pool) : is_bid_(is_bid), pool_(pool) {}
+        virtual ~PriceLadder() = default;
+
+        PriceLadder(const PriceLadder &) = delete;
+        PriceLadder &operator=(const PriceLadder &) = delete;
+
+        virtual PriceLevel *find(Price price) const = 0;
+        virtual PriceLevel &get_or_insert(Price price) = 0;
+        virtual void erase(Price price) = 0;
+
+        // Best level, or nullptr when the side is empty.
+        virtual PriceLevel *best() const = 0;
+        // Next level behind `price` in priority order, or nullptr.
+        virtual PriceLevel *next(Price price) const = 0;
+
+        virtual size_t size() const = 0;
+        bool empty() const { return size() == 0; }
+        bool is_bid() const { return is_bid_; }
+
+        static std::unique_ptr<PriceLadder> create(LadderType type, bool is_bid, LevelPool &pool);
+
+    protected:
+        bool is_bid_;
+        LevelPool &pool_;
+
+        bool is_better(Price a, Price b) const { return is_bid_ ? a > b : a < b; }
+    };
+
+    // Ordered tree of levels: O(log n) for every operation.
+    class MapLadder : public PriceLadder
+    {
+    public:
+        MapLadder(bool is_bid, LevelPool &pool) : PriceLadder(is_bid, pool) {}
+        ~MapLadder() override;
+
+        PriceLevel *find(Price price) const override;
+        PriceLevel &get_or_insert(Price price) override;
+        void erase(Price price) override;
+        PriceLevel *best() const override;
+        PriceLevel *next(Price price) const override;
+        size_t size() const override { return levels_.size(); }
+
+    private:
+        std::map<Price, PriceLevel *> levels_;
+    };
+
+    // Tick-indexed window of WINDOW_TICKS slots kept around the touch, with a
+    // two-level occupancy bitmap so best/next are a couple of bit scans.
+    // Levels outside the window spill into an ordered overflow map and are
+    // pulled back in when the window is recentered.
+    class DenseLadder : public PriceLadder
+    {
+    public:
+        static constexpr size_t WINDOW_TICKS = 4096;
+
+        DenseLadder(bool is_bid, LevelPool &pool);
+        ~DenseLadder() override;
+
+        PriceLevel *find(Price price) const override;
+        PriceLevel &get_or_insert(Price price) override;
+        void erase(Price price) override;
+        PriceLevel *best() const override;
+        PriceLevel *next(Price price) const override;
+        size_t size() const override { return window_count_ + overflow_.size(); }
+
+        Price get_window_base() const { return base_; }
+        size_t get_overflow_levels() const { return overflow_.size(); }
+
+    private:
+        static constexpr size_t WORDS = WINDOW_TICKS / 64;
+        static_assert(WORDS <= 64, "summary bitmap is a single word");
+
+        Price base_;
+        size_t window_count_;
+        std::array<PriceLevel *, WINDOW_TICKS> slots_;
+        std::array<uint64_t, WORDS> words_;
+        uint64_t summary_;
+        std::map<Price, PriceLevel *> overflow_;
+
+        bool in_window(Price price) const
+        {
+            return price >= base_ && price < base_ + static_cast<Price>(WINDOW_TICKS);
+        }
+        size_t index_of(Price price) const { return static_cast<size_t>(price - base_); }
+
+        void set_bit(size_t idx);
+        void clear_bit(size_t idx);
+        long highest_below(size_t limit) const;
+        long lowest_from(size_t from) const;
+
+        PriceLevel *window_best() const;
+        PriceLevel *overflow_best() const;
+        void recenter(Price touch);
+        bool touch_drifted() const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef SESSION_INDEX_HPP
+#define SESSION_INDEX_HPP
+
+#include "price_ladder.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace GoQuant
+{
+
+    // Live orders of one book grouped by owning session, one intrusive list
+    // per side threaded through OrderDetails. Mass cancel walks exactly the
+    // orders it removes. Orders without a session are not indexed.
+    //
+    // Only sessions with resting orders have an entry, kept in a flat
+    // linear-probing table that is at most half full. An entry is dropped
+    // when its session's last order leaves, so the table tracks sessions
+    // with live orders rather than every session ever seen, and it only
+    // reallocates when that number reaches a new high.
+    class SessionIndex
+    {
+    public:
+        void link(OrderDetails *details, OrderSide side)
+        {
+            if (details->session == INVALID_SESSION_ID)
+                return;
+
+            Entry &entry = find_or_insert(details->session);
+            OrderDetails *&head = entry.heads[static_cast<size_t>(side)];
+            details->session_prev = nullptr;
+            details->session_next = head;
+            if (head)
+                head->session_prev = details;
+            head = details;
+            ++entry.count;
+        }
+
+        void unlink(OrderDetails *details, OrderSide side)
+        {
+            if (details->session == INVALID_SESSION_ID)
+                return;
+
+            size_t slot = find(details->session);
+            Entry &entry = table_[slot];
+            if (details->session_prev)
+                details->session_prev->session_next = details->session_next;
+            else
+                entry.heads[static_cast<size_t>(side)] = details->session_next;
+            if (details->session_next)
+                details->session_next->session_prev = details->session_prev;
+            details->session_prev = nullptr;
+            details->session_next = nullptr;
+            if (--entry.count == 0)
+                erase(slot);
+        }
+
+        OrderDetails *head(SessionId session, OrderSide side) const
+        {
+            size_t slot = find(session);
+            return slot != NOT_FOUND ? table_[slot].heads[static_cast<size_t>(side)] : nullptr;
+        }
+
+        size_t count(SessionId session) const
+        {
+            size_t slot = find(session);
+            return slot != NOT_FOUND ? table_[slot].count : 0;
+        }
+
+    private:
+        struct Entry
+        {
+            SessionId session = INVALID_SESSION_ID;
+            OrderDetails *heads[2] = {nullptr, nullptr};
+            size_t count = 0;
+        };
+
+        static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        std::vector<Entry> table_;
+        size_t size_ = 0;
+
+        // Gateway ids are sequential, so the identity spreads them evenly.
+        size_t home(SessionId session) const { return session & (table_.size() - 1); }
+
+        size_t find(SessionId session) const
+        {
+            if (table_.empty() || session == INVALID_SESSION_ID)
+                return NOT_FOUND;
+            for (size_t slot = home(session);; slot = (slot + 1) & (table_.size() - 1))
+            {
+                if (table_[slot].session == session)
+                    return slot;
+                if (table_[slot].session == INVALID_SESSION_ID)
+                    return NOT_FOUND;
+            }
+        }
+
+        Entry &find_or_insert(SessionId session)
+        {
+            size_t slot = find(session);
+            if (slot != NOT_FOUND)
+                return table_[slot];
+
+            if ((size_ + 1) * 2 > table_.size())
+                rehash(std::max(MIN_CAPACITY, table_.size() * 2));
+            slot = home(session);
+            while (table_[slot].session != INVALID_SESSION_ID)
+                slot = (slot + 1) & (table_.size() - 1);
+            table_[slot].session = session;
+            ++size_;
+            return table_[slot];
+        }
+
+        // Backward-shift deletion: pulls later members of the probe run
+        // into the hole, so lookups never need tombstones.
+        void erase(size_t slot)
+        {
+            size_t mask = table_.size() - 1;
+            size_t next = slot;
+            for (;;)
+            {
+                next = (next + 1) & mask;
+                if (table_[next].session == INVALID_SESSION_ID)
+                    break;
+                size_t wanted = home(table_[next].session);
+                // Stay put if the home slot lies cyclically in (slot, next].
+                if (((next - wanted) & mask) < ((next - slot) & mask))
+                    continue;
+                table_[slot] = table_[next];
+                slot = next;
+            }
+            table_[slot] = Entry{};
+            --size_;
+        }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<Entry> old(capacity);
+            old.swap(table_);
+            for (const Entry &entry : old)
+            {
+                if (entry.session == INVALID_SESSION_ID)
+                    continue;
+                size_t slot = home(entry.session);
+                while (table_[slot].session != INVALID_SESSION_ID)
+                    slot = (slot + 1) & (table_.size() - 1);
+                table_[slot] = entry;
+            }
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SYMBOL_REGISTRY_HPP
+#define SYMBOL_REGISTRY_HPP
+
+#include "order_types.hpp"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace GoQuant
+{
+
+    // Interns symbol names into dense SymbolIds, assigned in registration
+    // order starting at 0 and never reused. Everything behind the API
+    // boundary indexes vectors by id; the string map is only consulted when a
+    // request arrives carrying a name.
+    class SymbolRegistry
+    {
+    public:
+        // Returns the existing id for `symbol`, or assigns the next one.
+        SymbolId intern(const std::string &symbol)
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(symbol);
+            if (it != ids_.end())
+                return it->second;
+
+            SymbolId id = static_cast<SymbolId>(names_.size());
+            names_.push_back(symbol);
+            ids_.emplace(symbol, id);
+            return id;
+        }
+
+        // INVALID_SYMBOL_ID when the name was never registered.
+        SymbolId find(const std::string &symbol) const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(symbol);
+            return it != ids_.end() ? it->second : INVALID_SYMBOL_ID;
+        }
+
+        // Names are never removed and deque elements never move, so the
+        // reference stays valid for the registry's lifetime.
+        const std::string &name(SymbolId id) const
+        {
+            static const std::string unknown;
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            return id < names_.size() ? names_[id] : unknown;
+        }
+
+        bool contains(SymbolId id) const { return id < size(); }
+
+        size_t size() const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            return names_.size();
+        }
+
+    private:
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<std::string, SymbolId> ids_;
+        std::deque<std::string> names_;
+    };
+
+}
+
+#endif
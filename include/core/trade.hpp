@@ -1,33 +1,34 @@
 #ifndef TRADE_HPP
 #define TRADE_HPP
 
-#include <string>
+#include "order_types.hpp"
 #include <cstdint>
+#include <type_traits>
 
 namespace GoQuant
 {
 
+    // Fill record produced on the matching path. Plain data only: no strings
+    // are built per fill. Symbol names and client order ids are resolved when
+    // the record is serialized at the API edge.
     struct Trade
     {
-        std::string trade_id;
-        std::string symbol;
-        std::string maker_order_id;
-        std::string taker_order_id;
-        double price;
-        double quantity;
+        // Monotonic per symbol, starting at 1; (symbol_id, trade_id) is unique.
+        uint64_t trade_id;
+        OrderHandle maker_handle;
+        OrderHandle taker_handle;
+        Price price;
+        Quantity quantity;
+        // What each side has left after this fill; 0 means the order is done.
+        Quantity maker_leaves;
+        Quantity taker_leaves;
         uint64_t timestamp;
+        SymbolId symbol_id;
         bool is_buyer_maker;
-
-        Trade(const std::string &symbol, const std::string &maker_id,
-              const std::string &taker_id, double price, double qty,
-              uint64_t ts, bool is_buy_maker)
-            : symbol(symbol), maker_order_id(maker_id), taker_order_id(taker_id),
-              price(price), quantity(qty), timestamp(ts), is_buyer_maker(is_buy_maker)
-        {
-            trade_id = "TRADE_" + std::to_string(ts) + "_" + std::to_string(rand() % 10000);
-        }
     };
 
+    static_assert(std::is_trivially_copyable<Trade>::value, "Trade must stay plain data");
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,64 @@
+#ifndef TRAILING_STOPS_HPP
+#define TRAILING_STOPS_HPP
+
+#include "order_types.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace GoQuant
+{
+
+    // Trailing stops of one symbol and side, stored as parallel columns so
+    // a price update is a single pass over contiguous triggers and distances.
+    // Everything else about an order stays with the caller, keyed by handle.
+    // Buy-side stops ratchet their trigger up to price - distance and fire
+    // once the price falls to it; sell-side stops ratchet down to
+    // price + distance and fire once the price rises to it. Rows are
+    // addressed by index and removal swaps the last row into the hole, so
+    // callers track rows through the handle column.
+    class TrailingStopBook
+    {
+    public:
+        explicit TrailingStopBook(OrderSide side) : side_(side) {}
+
+        size_t add(Price trigger, Price distance, uint64_t handle)
+        {
+            triggers_.push_back(trigger);
+            distances_.push_back(distance);
+            handles_.push_back(handle);
+            return handles_.size() - 1;
+        }
+
+        // Moves the last row into `index`; while `index` is still below
+        // size(), handle(index) names the row that moved.
+        void remove(size_t index)
+        {
+            size_t last = handles_.size() - 1;
+            triggers_[index] = triggers_[last];
+            distances_[index] = distances_[last];
+            handles_[index] = handles_[last];
+            triggers_.pop_back();
+            distances_.pop_back();
+            handles_.pop_back();
+        }
+
+        // Ratchets every trigger against `price` and appends the indices of
+        // the rows that fired, in ascending order. Fired rows are left in
+        // place; remove them from the highest index down.
+        void update(Price price, std::vector<size_t> &fired);
+
+        Price trigger(size_t index) const { return triggers_[index]; }
+        uint64_t handle(size_t index) const { return handles_[index]; }
+        size_t size() const { return handles_.size(); }
+        bool empty() const { return handles_.empty(); }
+
+    private:
+        OrderSide side_;
+        std::vector<Price> triggers_;
+        std::vector<Price> distances_;
+        std::vector<uint64_t> handles_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef TRIGGER_CASCADE_HPP
+#define TRIGGER_CASCADE_HPP
+
+#include "advanced_orders.hpp"
+#include "order_book.hpp"
+#include <atomic>
+#include <vector>
+
+namespace GoQuant {
+
+// Enters stop and take-profit orders into their book on the thread that
+// owns it, right after the price that triggered them. Released orders go
+// into a FIFO instead of re-entering the engine, so a cascade runs in a
+// fixed order: generation by generation, and nearest trigger first within
+// one. Each order entered re-checks triggers at its last trade price, up
+// to `max_depth` generations per event; stops the limit leaves armed fire
+// on the next print or mark price.
+class TriggerCascade {
+public:
+    TriggerCascade(AdvancedOrderManager& manager, std::atomic<OrderHandle>& next_handle, size_t max_depth)
+        : manager_(manager), next_handle_(next_handle), max_depth_(max_depth) {}
+
+    // Releases the orders `price` triggers on `book` and everything they set
+    // off, appending the resulting trades. Returns the orders entered.
+    size_t run(OrderBook& book, Price price, std::vector<Trade>& trades);
+
+private:
+    AdvancedOrderManager& manager_;
+    std::atomic<OrderHandle>& next_handle_;
+    size_t max_depth_;
+    std::vector<Order> pending_;
+};
+
+}
+
+#endif
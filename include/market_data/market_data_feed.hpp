@@ -4,18 +4,30 @@
 #include "core/matching_engine.hpp"
 #include "api/websocket_server.hpp"
 #include "core/trade.hpp"
-#include <thread>
+#include "utils/dirty_set.hpp"
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 
 namespace GoQuant
 {
 
+    // Publishes BBO and depth changes as books report them. Books mark
+    // their symbol dirty when the touch or depth moves; the publisher thread
+    // wakes, visits only the dirty symbols and sends what changed. A channel
+    // publishes a symbol at most once per its minimum interval, and changes
+    // made in between are conflated into the next publish. Trades are sent
+    // as they happen. Symbols added to the engine while the feed runs are
+    // picked up as they are registered.
     class MarketDataFeed
     {
     public:
-        MarketDataFeed(MatchingEngine &engine, WebSocketServer &ws_server);
+        MarketDataFeed(MatchingEngine &engine, WebSocketServer &ws_server,
+                       std::chrono::milliseconds bbo_interval = std::chrono::milliseconds(0),
+                       std::chrono::milliseconds depth_interval = std::chrono::milliseconds(5));
         ~MarketDataFeed();
 
         void start();
@@ -23,17 +35,41 @@ namespace GoQuant
         void on_trade_executed(const Trade &trade);
 
     private:
+        using Clock = DirtySet::Clock;
+
+        // Publisher-thread state per symbol. A channel is pending while it
+        // has changes it has not published yet.
+        struct SymbolState
+        {
+            bool bbo_pending = false;
+            bool depth_pending = false;
+            bool waiting = false;
+            uint64_t bbo_sequence = 0;
+            Clock::time_point next_bbo{};
+            Clock::time_point next_depth{};
+        };
+
         MatchingEngine &engine_;
         WebSocketServer &ws_server_;
+        Clock::duration bbo_interval_;
+        Clock::duration depth_interval_;
+
+        std::unique_ptr<DirtySet> dirty_;
         std::atomic<bool> running_{false};
-        std::thread feed_thread_;
+        std::thread publisher_;
+
+        std::vector<SymbolState> states_;
+        std::vector<uint32_t> marked_;
+        std::vector<SymbolId> waiting_;
+        std::vector<LevelDelta> deltas_;
 
-        void run_feed();
-        void broadcast_bbo_update(const std::string &symbol);
-        void broadcast_depth_update(const std::string &symbol);
-        std::vector<std::string> get_active_symbols();
+        void attach_book(OrderBook &book);
+        void run_publisher();
+        Clock::time_point publish_due(Clock::time_point now);
+        void broadcast_bbo_update(SymbolId symbol_id, SymbolState &state);
+        void publish_depth_changes(SymbolId symbol_id);
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,9 +2,10 @@
 #define HEALTH_CHECK_HPP
 
 #include "core/matching_engine.hpp"
-#include <atomic>
+#include "utils/task_scheduler.hpp"
 #include <chrono>
 #include <string>
+#include <mutex>
 #include <unordered_map>
 
 namespace GoQuant {
@@ -23,19 +24,21 @@ public:
     HealthChecker(MatchingEngine& engine);
     
     HealthStatus check_health();
-    void start_continuous_check(int interval_seconds = 30);
+    // Runs the check as a periodic task on `scheduler`.
+    void start_continuous_check(TaskScheduler& scheduler, int interval_seconds = 30);
     void stop_continuous_check();
     
-    bool is_system_healthy() const { return last_status_.is_healthy; }
-    HealthStatus get_last_status() const { return last_status_; }
+    bool is_system_healthy() const { return get_last_status().is_healthy; }
+    HealthStatus get_last_status() const;
 
 private:
     MatchingEngine& engine_;
-    std::atomic<bool> running_{false};
-    std::thread health_thread_;
+    TaskScheduler* scheduler_ = nullptr;
+    TaskId task_ = INVALID_TASK_ID;
     HealthStatus last_status_;
+    mutable std::mutex status_mutex_;
     
-    void run_health_check(int interval_seconds);
+    void run_health_check();
     HealthStatus perform_health_check();
 };
 
@@ -0,0 +1,68 @@
+#ifndef DIRTY_SET_HPP
+#define DIRTY_SET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace GoQuant {
+
+// Ids with unpublished changes, marked by any number of producers and taken
+// by one consumer. Marking an id that is already marked is a single relaxed
+// load, so a busy producer pays for the lock and wakeup only once per
+// consumer pass however many changes it makes in between.
+//
+// Flags live in fixed-size chunks reached through a directory that is
+// filled in but never reallocated, so the set can grow while producers
+// mark it.
+class DirtySet {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit DirtySet(size_t capacity = 0);
+    ~DirtySet();
+
+    DirtySet(const DirtySet&) = delete;
+    DirtySet& operator=(const DirtySet&) = delete;
+
+    // Makes ids below `capacity` markable. Safe to call while other threads
+    // mark; capacity never shrinks and is capped at max_capacity().
+    void grow(size_t capacity);
+
+    // Ids at or past the capacity are ignored.
+    void mark(uint32_t id);
+
+    // Consumer only. Waits until something is marked, `deadline` passes or
+    // wake() is called, then appends the marked ids to `ids` in marking
+    // order and clears them. An id cleared here can be marked again while
+    // the consumer works on it, so no change is lost.
+    void wait_until(Clock::time_point deadline, std::vector<uint32_t>& ids);
+    void wake();
+
+    size_t capacity() const { return capacity_.load(std::memory_order_acquire); }
+    static constexpr size_t max_capacity() { return CHUNK_SIZE * MAX_CHUNKS; }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64;
+    static constexpr size_t MAX_CHUNKS = 1024;
+
+    struct alignas(64) Flag {
+        std::atomic<bool> set{false};
+    };
+
+    std::unique_ptr<std::atomic<Flag*>[]> chunks_;
+    std::atomic<size_t> capacity_{0};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<uint32_t> marked_;
+    bool woken_ = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef EVENT_SIGNAL_HPP
+#define EVENT_SIGNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace GoQuant {
+
+// Lets one polling consumer sleep once it has run dry, without taxing the
+// producers while it is awake. A producer publishes its work, then calls
+// notify(), which is a fence and a relaxed load unless the consumer has
+// announced that it is going to sleep. The consumer announces before it
+// re-checks for work, so either it sees the work or the producer sees the
+// announcement; a wakeup is never lost.
+class EventSignal {
+public:
+    EventSignal() = default;
+    EventSignal(const EventSignal&) = delete;
+    EventSignal& operator=(const EventSignal&) = delete;
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    // Consumer only. Returns once `ready()` holds or `timeout` elapses.
+    template <typename Predicate>
+    void wait_for(std::chrono::microseconds timeout, Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait_for(lock, timeout, ready);
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> sleeping_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include "utils/ring_buffer.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace GoQuant {
+
+enum class LogLevel : uint8_t {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4,
+    OFF = 5
+};
+
+// Statements below this level are compiled out entirely. Override with
+// -DGOQUANT_LOG_LEVEL=<0..5>.
+#ifndef GOQUANT_LOG_LEVEL
+#define GOQUANT_LOG_LEVEL 2
+#endif
+
+// Raw log argument. Strings are copied inline and truncated so a record
+// never points at memory the caller may free.
+struct LogArg {
+    enum class Type : uint8_t {
+        INT = 0,
+        UINT = 1,
+        DOUBLE = 2,
+        STRING = 3
+    };
+
+    static constexpr size_t MAX_STRING = 22;
+
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        char s[MAX_STRING + 1];
+    };
+};
+
+struct LogRecord {
+    static constexpr size_t MAX_ARGS = 6;
+
+    uint64_t timestamp_ns;
+    uint16_t format_id;
+    uint8_t arg_count;
+    LogArg args[MAX_ARGS];
+};
+
+// Asynchronous logger. The calling thread only copies a format id and its
+// raw arguments into its own SPSC ring; a background thread formats the
+// "{}" placeholders and writes the text. When a ring is full the record is
+// dropped and counted rather than blocking the caller.
+class Logger {
+public:
+    static Logger& instance();
+
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Called once per call site through the LOG_* macros.
+    static uint16_t register_format(LogLevel level, const char* format);
+
+    template <typename... Args>
+    void log(uint16_t format_id, const char*, const Args&... args) {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+
+        LogRecord record;
+        record.timestamp_ns = now_ns();
+        record.format_id = format_id;
+        record.arg_count = 0;
+        (pack(record, args), ...);
+
+        if (!local_ring().try_push(std::move(record))) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Blocks until everything logged before the call has been written.
+    void flush();
+
+    void set_output(std::FILE* output);
+    uint64_t get_dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MAX_FORMATS = 4096;
+    static constexpr size_t RING_CAPACITY = 8192;
+
+    struct Format {
+        LogLevel level;
+        const char* text;
+    };
+
+    struct ThreadBuffer {
+        SpscRing<LogRecord> ring{RING_CAPACITY};
+        std::atomic<bool> retired{false};
+    };
+
+    struct ThreadBufferHandle {
+        ThreadBuffer* buffer = nullptr;
+        ~ThreadBufferHandle();
+    };
+
+    Logger();
+
+    static std::array<Format, MAX_FORMATS> formats_;
+    static std::atomic<uint16_t> format_count_;
+
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::mutex buffers_mutex_;
+
+    std::atomic<std::FILE*> output_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> passes_{0};
+    std::atomic<bool> running_{true};
+    std::thread writer_thread_;
+
+    SpscRing<LogRecord>& local_ring();
+    void writer_loop();
+    bool drain_once(std::string& text);
+    void format_record(const LogRecord& record, std::string& text) const;
+
+    static uint64_t now_ns();
+
+    template <typename T>
+    static void pack(LogRecord& record, const T& value) {
+        LogArg& arg = record.args[record.arg_count++];
+        if constexpr (std::is_same<T, bool>::value) {
+            arg.type = LogArg::Type::STRING;
+            std::strcpy(arg.s, value ? "true" : "false");
+        } else if constexpr (std::is_enum<T>::value) {
+            arg.type = LogArg::Type::INT;
+            arg.i = static_cast<int64_t>(value);
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            arg.type = LogArg::Type::INT;
+            arg.i = value;
+        } else if constexpr (std::is_integral<T>::value) {
+            arg.type = LogArg::Type::UINT;
+            arg.u = value;
+        } else if constexpr (std::is_floating_point<T>::value) {
+            arg.type = LogArg::Type::DOUBLE;
+            arg.d = value;
+        } else {
+            pack_string(arg, string_data(value));
+        }
+    }
+
+    static const char* string_data(const std::string& value) { return value.c_str(); }
+    static const char* string_data(const char* value) { return value ? value : "(null)"; }
+
+    static void pack_string(LogArg& arg, const char* value) {
+        arg.type = LogArg::Type::STRING;
+        size_t length = std::strlen(value);
+        if (length > LogArg::MAX_STRING) {
+            length = LogArg::MAX_STRING;
+        }
+        std::memcpy(arg.s, value, length);
+        arg.s[length] = '\0';
+    }
+};
+
+}
+
+#define GOQUANT_LOG_FIRST_(first, ...) first
+#define GOQUANT_LOG_FIRST(...) GOQUANT_LOG_FIRST_(__VA_ARGS__, unused)
+
+#define GOQUANT_LOG(level, ...)                                                                 \
+    do {                                                                                        \
+        if constexpr (static_cast<int>(level) >= GOQUANT_LOG_LEVEL) {                           \
+            static const uint16_t goquant_format_id =                                           \
+                ::GoQuant::Logger::register_format(level, GOQUANT_LOG_FIRST(__VA_ARGS__));      \
+            ::GoQuant::Logger::instance().log(goquant_format_id, __VA_ARGS__);                  \
+        }                                                                                       \
+    } while (0)
+
+#define LOG_TRACE(...) GOQUANT_LOG(::GoQuant::LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) GOQUANT_LOG(::GoQuant::LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) GOQUANT_LOG(::GoQuant::LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...) GOQUANT_LOG(::GoQuant::LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) GOQUANT_LOG(::GoQuant::LogLevel::ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace GoQuant
+{
+
+    struct PoolStats
+    {
+        size_t in_use;
+        size_t capacity;
+        size_t high_water_mark;
+
+        PoolStats() : in_use(0), capacity(0), high_water_mark(0) {}
+    };
+
+    // Slab allocator for fixed-size objects. Memory is carved out of chunks
+    // that are never returned to the heap; freed slots go onto an intrusive
+    // freelist and are reused LIFO so recently touched memory stays hot.
+    // Not thread-safe: each pool belongs to a single owner (e.g. one book).
+    template <typename T>
+    class ObjectPool
+    {
+    public:
+        explicit ObjectPool(size_t initial_capacity = 1024, size_t chunk_size = 1024)
+            : chunk_size_(chunk_size > 0 ? chunk_size : 1), free_list_(nullptr)
+        {
+            if (initial_capacity > 0)
+            {
+                grow(initial_capacity);
+            }
+        }
+
+        ObjectPool(const ObjectPool &) = delete;
+        ObjectPool &operator=(const ObjectPool &) = delete;
+
+        template <typename... Args>
+        T *create(Args &&...args)
+        {
+            if (!free_list_)
+            {
+                grow(chunk_size_);
+            }
+
+            Slot *slot = free_list_;
+            free_list_ = slot->next;
+
+            T *obj = new (slot->storage) T(std::forward<Args>(args)...);
+
+            ++stats_.in_use;
+            if (stats_.in_use > stats_.high_water_mark)
+            {
+                stats_.high_water_mark = stats_.in_use;
+            }
+            return obj;
+        }
+
+        void destroy(T *obj)
+        {
+            if (!obj)
+                return;
+
+            obj->~T();
+            Slot *slot = reinterpret_cast<Slot *>(obj);
+            slot->next = free_list_;
+            free_list_ = slot;
+            --stats_.in_use;
+        }
+
+        const PoolStats &get_stats() const { return stats_; }
+
+    private:
+        union Slot
+        {
+            Slot *next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        size_t chunk_size_;
+        Slot *free_list_;
+        std::vector<std::unique_ptr<Slot[]>> chunks_;
+        PoolStats stats_;
+
+        void grow(size_t count)
+        {
+            chunks_.push_back(std::make_unique<Slot[]>(count));
+            Slot *chunk = chunks_.back().get();
+            for (size_t i = count; i-- > 0;)
+            {
+                chunk[i].next = free_list_;
+                free_list_ = &chunk[i];
+            }
+            stats_.capacity += count;
+        }
+    };
+
+}
+
+#endif
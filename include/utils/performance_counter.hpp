@@ -4,6 +4,8 @@
 #include <chrono>
 #include <atomic>
 #include <cstdint>
+#include <mutex>
+#include <vector>
 
 namespace GoQuant {
 
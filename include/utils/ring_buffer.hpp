@@ -0,0 +1,204 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace GoQuant
+{
+
+    namespace detail
+    {
+        inline size_t round_up_pow2(size_t n)
+        {
+            size_t capacity = 2;
+            while (capacity < n)
+            {
+                capacity <<= 1;
+            }
+            return capacity;
+        }
+    }
+
+    // Bounded single-producer/single-consumer queue. Each side caches the
+    // other side's index so the shared cache line is only read when the
+    // cached view says the ring is full (producer) or empty (consumer).
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        explicit SpscRing(size_t capacity)
+            : capacity_(detail::round_up_pow2(capacity)), mask_(capacity_ - 1),
+              slots_(new Slot[capacity_]), head_(0), tail_(0), cached_head_(0), cached_tail_(0) {}
+
+        ~SpscRing()
+        {
+            T item;
+            while (try_pop(item))
+            {
+            }
+        }
+
+        SpscRing(const SpscRing &) = delete;
+        SpscRing &operator=(const SpscRing &) = delete;
+
+        bool try_push(T &&item)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ == capacity_)
+            {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail - cached_head_ == capacity_)
+                    return false;
+            }
+
+            new (slots_[tail & mask_].storage) T(std::move(item));
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T &out)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_)
+            {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_)
+                    return false;
+            }
+
+            T *item = slots_[head & mask_].get();
+            out = std::move(*item);
+            item->~T();
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const
+        {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const { return capacity_; }
+
+    private:
+        struct Slot
+        {
+            alignas(T) unsigned char storage[sizeof(T)];
+            T *get() { return std::launder(reinterpret_cast<T *>(storage)); }
+        };
+
+        const size_t capacity_;
+        const size_t mask_;
+        std::unique_ptr<Slot[]> slots_;
+
+        alignas(64) std::atomic<size_t> head_;
+        alignas(64) std::atomic<size_t> tail_;
+        alignas(64) size_t cached_head_;
+        alignas(64) size_t cached_tail_;
+    };
+
+    // Bounded multi-producer/single-consumer queue. Every cell carries a
+    // sequence number that tells producers whether it is free for the lap
+    // they claimed and tells the consumer whether it has been published,
+    // so producers only contend on the tail CAS.
+    template <typename T>
+    class MpscRing
+    {
+    public:
+        explicit MpscRing(size_t capacity)
+            : capacity_(detail::round_up_pow2(capacity)), mask_(capacity_ - 1),
+              cells_(new Cell[capacity_]), head_(0), tail_(0)
+        {
+            for (size_t i = 0; i < capacity_; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~MpscRing()
+        {
+            T item;
+            while (try_pop(item))
+            {
+            }
+        }
+
+        MpscRing(const MpscRing &) = delete;
+        MpscRing &operator=(const MpscRing &) = delete;
+
+        bool try_push(T &&item)
+        {
+            size_t pos = tail_.load(std::memory_order_relaxed);
+            Cell *cell;
+            for (;;)
+            {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (cell->storage) T(std::move(item));
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Single consumer only.
+        bool try_pop(T &out)
+        {
+            Cell &cell = cells_[head_ & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != head_ + 1)
+                return false;
+
+            T *item = cell.get();
+            out = std::move(*item);
+            item->~T();
+            cell.sequence.store(head_ + capacity_, std::memory_order_release);
+            ++head_;
+            return true;
+        }
+
+        size_t capacity() const { return capacity_; }
+
+        // Positions claimed by producers so far; every push that has
+        // returned true lies below it.
+        size_t claimed() const { return tail_.load(std::memory_order_acquire); }
+        // Single consumer only. Positions popped so far.
+        size_t consumed() const { return head_; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+            T *get() { return std::launder(reinterpret_cast<T *>(storage)); }
+        };
+
+        const size_t capacity_;
+        const size_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+
+        alignas(64) size_t head_;
+        alignas(64) std::atomic<size_t> tail_;
+    };
+
+}
+
+#endif
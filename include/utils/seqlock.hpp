@@ -0,0 +1,83 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace GoQuant
+{
+
+    // Single-writer sequence lock for small trivially copyable records.
+    // The writer bumps the sequence to odd, stores the payload and bumps it
+    // back to even; readers copy the payload and retry if the sequence moved
+    // underneath them. Readers never block the writer. The payload is held
+    // in relaxed atomic words so concurrent copies are not data races.
+    template <typename T>
+    class SeqLock
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+    public:
+        SeqLock() : sequence_(0)
+        {
+            store(T{});
+            sequence_.store(0, std::memory_order_relaxed);
+        }
+
+        SeqLock(const SeqLock &) = delete;
+        SeqLock &operator=(const SeqLock &) = delete;
+
+        // Must only be called by one writer at a time.
+        void store(const T &value)
+        {
+            uint64_t seq = sequence_.load(std::memory_order_relaxed);
+            sequence_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            std::array<uint64_t, WORDS> buffer{};
+            std::memcpy(buffer.data(), &value, sizeof(T));
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                words_[i].store(buffer[i], std::memory_order_relaxed);
+            }
+
+            sequence_.store(seq + 2, std::memory_order_release);
+        }
+
+        T load() const
+        {
+            std::array<uint64_t, WORDS> buffer;
+            for (;;)
+            {
+                uint64_t before = sequence_.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+
+                for (size_t i = 0; i < WORDS; ++i)
+                {
+                    buffer[i] = words_[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence_.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+
+            T value;
+            std::memcpy(static_cast<void *>(&value), buffer.data(), sizeof(T));
+            return value;
+        }
+
+    private:
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        alignas(64) std::atomic<uint64_t> sequence_;
+        std::array<std::atomic<uint64_t>, WORDS> words_;
+    };
+
+}
+
+#endif
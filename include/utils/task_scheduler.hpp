@@ -0,0 +1,80 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include "timing_wheel.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace GoQuant {
+
+using TaskId = uint64_t;
+constexpr TaskId INVALID_TASK_ID = 0;
+
+// Runs the engine's periodic and delayed jobs from one thread, filed on a
+// TimingWheel of `tick`-sized steps. Tasks run one after another outside
+// the scheduler lock, so a task may schedule or cancel others (or itself);
+// a slow task delays the ones behind it rather than overlapping them.
+class TaskScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TaskScheduler(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    TaskId schedule_after(std::chrono::milliseconds delay, std::function<void()> task);
+    // Repeats every `interval` until cancelled, starting one interval from
+    // now. Runs missed while the scheduler was busy are skipped, not queued.
+    TaskId schedule_every(std::chrono::milliseconds interval, std::function<void()> task);
+    bool cancel(TaskId id);
+
+    // start() runs the scheduler on its own thread; run() on the caller's,
+    // until stop() is called from elsewhere.
+    void start();
+    void run();
+    void stop();
+
+    // Runs every task due at or before `now`; returns how many ran.
+    size_t run_due(Clock::time_point now);
+
+    size_t get_task_count() const;
+
+private:
+    struct Task {
+        std::shared_ptr<std::function<void()>> fn;
+        uint64_t interval_ticks;
+        uint64_t deadline;
+        TimerNode* timer;
+    };
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point epoch_;
+    TimingWheel wheel_;
+    std::unordered_map<TaskId, Task> tasks_;
+    TaskId next_id_ = 1;
+    std::vector<TaskId> due_;
+    std::vector<std::shared_ptr<std::function<void()>>> ready_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    void loop();
+    uint64_t ticks_since_epoch(Clock::time_point time) const;
+    TaskId add_task(std::chrono::milliseconds delay, uint64_t interval_ticks, std::function<void()> task);
+};
+
+}
+
+#endif
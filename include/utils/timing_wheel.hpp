@@ -0,0 +1,207 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include "object_pool.hpp"
+#include <cstdint>
+
+namespace GoQuant
+{
+
+    // A pending timer. Owned by the wheel; callers only keep the pointer to
+    // cancel it, and must drop it once the timer has fired.
+    struct TimerNode
+    {
+        TimerNode *prev;
+        TimerNode *next;
+        uint64_t deadline;
+        uint64_t key;
+        unsigned level;
+    };
+
+    // Hierarchical timing wheel over an abstract tick count. LEVELS wheels of
+    // 64 slots each cover 2^30 ticks ahead of the current tick; later
+    // deadlines park in the farthest slot and are re-filed as the wheel turns.
+    // Schedule and cancel are O(1). Advance visits one slot per tick while the
+    // lowest wheel holds timers and otherwise jumps straight to the next
+    // boundary where a higher-level slot cascades into the levels below.
+    // Not thread-safe: each wheel belongs to a single owner (e.g. one book).
+    class TimingWheel
+    {
+    public:
+        static constexpr unsigned SLOT_BITS = 6;
+        static constexpr unsigned LEVELS = 5;
+        static constexpr uint64_t SLOTS = uint64_t(1) << SLOT_BITS;
+        static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+        static constexpr uint64_t SPAN = uint64_t(1) << (SLOT_BITS * LEVELS);
+
+        explicit TimingWheel(uint64_t start_tick = 0, size_t initial_capacity = 1024)
+            : now_(start_tick), size_(0), counts_{}, pool_(initial_capacity, initial_capacity)
+        {
+            for (auto &level : slots_)
+            {
+                for (TimerNode &slot : level)
+                {
+                    slot.prev = slot.next = &slot;
+                }
+            }
+        }
+
+        TimingWheel(const TimingWheel &) = delete;
+        TimingWheel &operator=(const TimingWheel &) = delete;
+
+        // Deadlines at or before the current tick fire on the next advance.
+        TimerNode *schedule(uint64_t deadline, uint64_t key)
+        {
+            TimerNode *timer = pool_.create();
+            timer->deadline = deadline;
+            timer->key = key;
+            file(timer);
+            ++size_;
+            return timer;
+        }
+
+        void cancel(TimerNode *timer)
+        {
+            unlink(timer);
+            pool_.destroy(timer);
+            --size_;
+        }
+
+        // Fires, in deadline order, every timer due at or before `tick` by
+        // calling fn(key). The timer is already released when fn runs, so fn
+        // may schedule and cancel freely.
+        template <typename Fn>
+        size_t advance(uint64_t tick, Fn fn)
+        {
+            size_t fired = 0;
+            TimerNode due;
+
+            while (now_ <= tick)
+            {
+                if (size_ == 0)
+                {
+                    now_ = tick + 1;
+                    break;
+                }
+
+                uint64_t index = now_ & SLOT_MASK;
+                if (index == 0)
+                {
+                    for (unsigned level = 1; level < LEVELS; ++level)
+                    {
+                        uint64_t slot = (now_ >> (SLOT_BITS * level)) & SLOT_MASK;
+                        cascade(slots_[level][slot]);
+                        if (slot != 0)
+                            break;
+                    }
+                }
+
+                if (counts_[0] == 0)
+                {
+                    unsigned empty = 1;
+                    while (empty < LEVELS - 1 && counts_[empty] == 0)
+                    {
+                        ++empty;
+                    }
+                    uint64_t boundary = ((now_ >> (SLOT_BITS * empty)) + 1) << (SLOT_BITS * empty);
+                    now_ = boundary <= tick ? boundary : tick + 1;
+                    continue;
+                }
+
+                splice(slots_[0][index], due);
+                ++now_;
+
+                while (due.next != &due)
+                {
+                    TimerNode *timer = due.next;
+                    uint64_t key = timer->key;
+                    cancel(timer);
+                    ++fired;
+                    fn(key);
+                }
+            }
+
+            return fired;
+        }
+
+        // Next tick advance() will process.
+        uint64_t now() const { return now_; }
+        size_t size() const { return size_; }
+        PoolStats get_stats() const { return pool_.get_stats(); }
+
+    private:
+        TimerNode slots_[LEVELS][SLOTS];
+        uint64_t now_;
+        size_t size_;
+        // Timers filed on each level, including ones spliced out for firing
+        // or cascading that have not been unlinked yet.
+        size_t counts_[LEVELS];
+        ObjectPool<TimerNode> pool_;
+
+        void file(TimerNode *timer)
+        {
+            uint64_t deadline = timer->deadline < now_ ? now_ : timer->deadline;
+            uint64_t delta = deadline - now_;
+            if (delta >= SPAN)
+            {
+                deadline = now_ + SPAN - 1;
+                delta = SPAN - 1;
+            }
+
+            unsigned level = 0;
+            while (delta >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+            {
+                ++level;
+            }
+            timer->level = level;
+            ++counts_[level];
+            link(slots_[level][(deadline >> (SLOT_BITS * level)) & SLOT_MASK], timer);
+        }
+
+        void cascade(TimerNode &slot)
+        {
+            TimerNode pending;
+            splice(slot, pending);
+            while (pending.next != &pending)
+            {
+                TimerNode *timer = pending.next;
+                unlink(timer);
+                file(timer);
+            }
+        }
+
+        static void link(TimerNode &head, TimerNode *timer)
+        {
+            timer->prev = head.prev;
+            timer->next = &head;
+            head.prev->next = timer;
+            head.prev = timer;
+        }
+
+        void unlink(TimerNode *timer)
+        {
+            --counts_[timer->level];
+            timer->prev->next = timer->next;
+            timer->next->prev = timer->prev;
+            timer->prev = timer->next = timer;
+        }
+
+        // Moves every timer in `from` onto the empty list `to`.
+        static void splice(TimerNode &from, TimerNode &to)
+        {
+            if (from.next == &from)
+            {
+                to.prev = to.next = &to;
+                return;
+            }
+            to.next = from.next;
+            to.prev = from.prev;
+            to.next->prev = &to;
+            to.prev->next = &to;
+            from.prev = from.next = &from;
+        }
+    };
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "api/json_serializer.hpp"
 #include <chrono>
+#include <stdexcept>
 
 namespace GoQuant
 {
@@ -8,7 +9,11 @@ namespace GoQuant
 
     OrderRequest JsonSerializer::parse_order_request(const std::string &json_str)
     {
-        auto j = json::parse(json_str);
+        return order_request_from_json(json::parse(json_str));
+    }
+
+    OrderRequest JsonSerializer::order_request_from_json(const json &j)
+    {
         OrderRequest request;
 
         request.symbol = j.value("symbol", "");
@@ -17,13 +22,19 @@ namespace GoQuant
         request.quantity = j.value("quantity", 0.0);
         request.price = j.value("price", 0.0);
         request.order_id = j.value("order_id", "");
+        request.time_in_force = j.value("time_in_force", "");
+        request.expire_time = j.value("expire_time", uint64_t(0));
 
         return request;
     }
 
     CancelRequest JsonSerializer::parse_cancel_request(const std::string &json_str)
     {
-        auto j = json::parse(json_str);
+        return cancel_request_from_json(json::parse(json_str));
+    }
+
+    CancelRequest JsonSerializer::cancel_request_from_json(const json &j)
+    {
         CancelRequest request;
 
         request.symbol = j.value("symbol", "");
@@ -32,29 +43,155 @@ namespace GoQuant
         return request;
     }
 
+    AmendRequest JsonSerializer::parse_amend_request(const std::string &json_str)
+    {
+        auto j = json::parse(json_str);
+        AmendRequest request;
+
+        request.symbol = j.value("symbol", "");
+        request.order_id = j.value("order_id", "");
+        request.quantity = j.value("quantity", 0.0);
+        request.price = j.value("price", 0.0);
+
+        return request;
+    }
+
+    MassCancelRequest JsonSerializer::parse_mass_cancel_request(const std::string &json_str)
+    {
+        auto j = json::parse(json_str);
+        MassCancelRequest request;
+
+        request.symbol = j.value("symbol", "");
+        request.side = j.value("side", "");
+
+        return request;
+    }
+
     MarketDataRequest JsonSerializer::parse_market_data_request(const std::string &json_str)
     {
         auto j = json::parse(json_str);
         MarketDataRequest request;
 
         request.symbol = j.value("symbol", "");
-        request.type = j.value("type", "");
+        // "type" is the message type itself ("subscribe"/"unsubscribe").
+        request.type = j.value("subscription_type", "");
 
         return request;
     }
 
+    BatchRequest JsonSerializer::parse_batch_request(const json &j)
+    {
+        BatchRequest request;
+
+        auto orders = j.find("orders");
+        if (orders != j.end() && orders->is_array())
+        {
+            request.orders.reserve(orders->size());
+            for (const auto &order : *orders)
+            {
+                request.orders.push_back(order_request_from_json(order));
+            }
+        }
+
+        auto cancels = j.find("cancels");
+        if (cancels != j.end() && cancels->is_array())
+        {
+            request.cancels.reserve(cancels->size());
+            for (const auto &cancel : *cancels)
+            {
+                request.cancels.push_back(cancel_request_from_json(cancel));
+            }
+        }
+
+        return request;
+    }
+
+    OrderType JsonSerializer::parse_order_type(const std::string &order_type)
+    {
+        if (order_type == "market")
+            return OrderType::MARKET;
+        if (order_type == "limit")
+            return OrderType::LIMIT;
+        if (order_type == "ioc")
+            return OrderType::IOC;
+        if (order_type == "fok")
+            return OrderType::FOK;
+        throw std::invalid_argument("Unknown order type: " + order_type);
+    }
+
+    OrderSide JsonSerializer::parse_order_side(const std::string &side)
+    {
+        if (side == "buy")
+            return OrderSide::BUY;
+        if (side == "sell")
+            return OrderSide::SELL;
+        throw std::invalid_argument("Unknown order side: " + side);
+    }
+
+    uint64_t JsonSerializer::resolve_expire_time(const std::string &time_in_force, uint64_t expire_time)
+    {
+        if (time_in_force.empty() || time_in_force == "gtc")
+            return 0;
+        if (time_in_force == "gtt")
+        {
+            if (expire_time == 0)
+                throw std::invalid_argument("gtt order requires expire_time");
+            return expire_time;
+        }
+        if (time_in_force == "gfd")
+        {
+            constexpr uint64_t MS_PER_DAY = 24ULL * 60 * 60 * 1000;
+            uint64_t now_ms = get_current_timestamp() / 1000;
+            return (now_ms / MS_PER_DAY + 1) * MS_PER_DAY;
+        }
+        throw std::invalid_argument("Unknown time in force: " + time_in_force);
+    }
+
     std::string JsonSerializer::serialize_order_response(const OrderResponse &response)
     {
-        json j;
+        json j = order_response_to_json(response);
         j["type"] = "order_response";
+        j["timestamp"] = get_current_timestamp();
+
+        return j.dump();
+    }
+
+    std::string JsonSerializer::serialize_batch_response(const std::vector<OrderResponse> &responses)
+    {
+        json j;
+        j["type"] = "batch_response";
+        j["timestamp"] = get_current_timestamp();
+        j["results"] = json::array();
+        for (const auto &response : responses)
+        {
+            j["results"].push_back(order_response_to_json(response));
+        }
+
+        return j.dump();
+    }
+
+    std::string JsonSerializer::serialize_mass_cancel_response(const MassCancelRequest &request, bool accepted)
+    {
+        json j;
+        j["type"] = "mass_cancel_response";
+        j["symbol"] = request.symbol;
+        j["side"] = request.side;
+        j["status"] = accepted ? "accepted" : "rejected";
+        j["timestamp"] = get_current_timestamp();
+
+        return j.dump();
+    }
+
+    json JsonSerializer::order_response_to_json(const OrderResponse &response)
+    {
+        json j;
         j["order_id"] = response.order_id;
         j["status"] = response.status;
         j["message"] = response.message;
         j["filled_quantity"] = response.filled_quantity;
         j["average_price"] = response.average_price;
-        j["timestamp"] = get_current_timestamp();
 
-        return j.dump();
+        return j;
     }
 
     std::string JsonSerializer::serialize_error_response(const ErrorResponse &response)
@@ -68,38 +205,42 @@ namespace GoQuant
         return j.dump();
     }
 
-    std::string JsonSerializer::serialize_trade(const Trade &trade)
+    std::string JsonSerializer::serialize_trade(const Trade &trade, const std::string &symbol,
+                                               const PriceScale &scale)
     {
         json j;
         j["type"] = "trade";
         j["timestamp"] = trade.timestamp;
-        j["symbol"] = trade.symbol;
-        j["trade_id"] = trade.trade_id;
-        j["price"] = trade.price;
-        j["quantity"] = trade.quantity;
-        j["aggressor_side"] = trade.aggressor_side;
-        j["maker_order_id"] = trade.maker_order_id;
-        j["taker_order_id"] = trade.taker_order_id;
+        j["symbol"] = symbol;
+        j["trade_id"] = symbol + "-" + std::to_string(trade.trade_id);
+        j["price"] = scale.to_price(trade.price);
+        j["quantity"] = scale.to_quantity(trade.quantity);
+        j["aggressor_side"] = trade.is_buyer_maker ? "SELL" : "BUY";
+        j["maker_order_handle"] = trade.maker_handle;
+        j["taker_order_handle"] = trade.taker_handle;
 
         return j.dump();
     }
 
     std::string JsonSerializer::serialize_order_book_update(const std::string &symbol,
-                                                            const std::vector<std::pair<double, double>> &bids,
-                                                            const std::vector<std::pair<double, double>> &asks,
+                                                            const std::vector<std::pair<Price, Quantity>> &bids,
+                                                            const std::vector<std::pair<Price, Quantity>> &asks,
+                                                            const PriceScale &scale,
+                                                            uint64_t sequence,
                                                             uint64_t timestamp)
     {
         json j;
         j["type"] = "order_book";
         j["timestamp"] = timestamp;
         j["symbol"] = symbol;
+        j["sequence"] = sequence;
 
         json bids_array = json::array();
         for (const auto &[price, quantity] : bids)
         {
             json level = json::array();
-            level.push_back(price);
-            level.push_back(quantity);
+            level.push_back(scale.to_price(price));
+            level.push_back(scale.to_quantity(quantity));
             bids_array.push_back(level);
         }
         j["bids"] = bids_array;
@@ -109,8 +250,8 @@ namespace GoQuant
         for (const auto &[price, quantity] : asks)
         {
             json level = json::array();
-            level.push_back(price);
-            level.push_back(quantity);
+            level.push_back(scale.to_price(price));
+            level.push_back(scale.to_quantity(quantity));
             asks_array.push_back(level);
         }
         j["asks"] = asks_array;
@@ -118,17 +259,50 @@ namespace GoQuant
         return j.dump();
     }
 
+    std::string JsonSerializer::serialize_order_book_delta(const std::string &symbol,
+                                                           const std::vector<LevelDelta> &deltas,
+                                                           const PriceScale &scale,
+                                                           uint64_t sequence,
+                                                           uint64_t timestamp)
+    {
+        static const char *const actions[] = {"add", "update", "delete"};
+
+        json j;
+        j["type"] = "order_book_delta";
+        j["timestamp"] = timestamp;
+        j["symbol"] = symbol;
+        j["sequence"] = sequence;
+
+        json changes = json::array();
+        for (const LevelDelta &delta : deltas)
+        {
+            json change;
+            change["side"] = delta.side == OrderSide::BUY ? "bid" : "ask";
+            change["action"] = actions[static_cast<size_t>(delta.action)];
+            change["price"] = scale.to_price(delta.price);
+            change["quantity"] = scale.to_quantity(delta.quantity);
+            changes.push_back(change);
+        }
+        j["changes"] = changes;
+
+        return j.dump();
+    }
+
     std::string JsonSerializer::serialize_bbo_update(const std::string &symbol,
-                                                     double best_bid, double best_ask,
+                                                     const BBO &bbo,
+                                                     const PriceScale &scale,
                                                      uint64_t timestamp)
     {
         json j;
         j["type"] = "bbo";
         j["timestamp"] = timestamp;
         j["symbol"] = symbol;
-        j["best_bid"] = best_bid;
-        j["best_ask"] = best_ask;
-        j["spread"] = best_ask - best_bid;
+        j["sequence"] = bbo.sequence;
+        j["best_bid"] = scale.to_price(bbo.bid_price);
+        j["best_bid_size"] = scale.to_quantity(bbo.bid_quantity);
+        j["best_ask"] = scale.to_price(bbo.ask_price);
+        j["best_ask_size"] = scale.to_quantity(bbo.ask_quantity);
+        j["spread"] = scale.to_price(bbo.ask_price - bbo.bid_price);
 
         return j.dump();
     }
@@ -0,0 +1,318 @@
+#include "api/message_decoder.hpp"
+#include <charconv>
+
+namespace GoQuant
+{
+
+    namespace
+    {
+        constexpr int MAX_SKIP_DEPTH = 32;
+
+        bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+        // Forward-only reader over one frame. Every method leaves the cursor
+        // just past what it consumed and returns false on malformed input.
+        class Cursor
+        {
+        public:
+            explicit Cursor(std::string_view text) : pos_(text.data()), end_(text.data() + text.size()) {}
+
+            bool consume(char c)
+            {
+                skip_whitespace();
+                if (pos_ < end_ && *pos_ == c)
+                {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            bool at_end()
+            {
+                skip_whitespace();
+                return pos_ == end_;
+            }
+
+            // The view excludes the quotes and is not unescaped; `escaped`
+            // reports whether it contains a backslash sequence.
+            bool string(std::string_view &out, bool &escaped)
+            {
+                if (!consume('"'))
+                    return false;
+
+                const char *start = pos_;
+                escaped = false;
+                while (pos_ < end_)
+                {
+                    char c = *pos_;
+                    if (c == '"')
+                    {
+                        out = std::string_view(start, pos_ - start);
+                        ++pos_;
+                        return true;
+                    }
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        return false;
+                    if (c == '\\')
+                    {
+                        escaped = true;
+                        ++pos_;
+                        if (pos_ == end_)
+                            return false;
+                    }
+                    ++pos_;
+                }
+                return false;
+            }
+
+            // One JSON number token, checked against the JSON grammar so the
+            // fast path never accepts what the full parser would reject.
+            bool number(std::string_view &token, bool &integral)
+            {
+                skip_whitespace();
+                const char *start = pos_;
+                integral = true;
+
+                if (pos_ < end_ && *pos_ == '-')
+                    ++pos_;
+                if (pos_ == end_ || !is_digit(*pos_))
+                    return false;
+                if (*pos_ == '0')
+                    ++pos_;
+                else
+                    skip_digits();
+
+                if (pos_ < end_ && *pos_ == '.')
+                {
+                    integral = false;
+                    ++pos_;
+                    if (pos_ == end_ || !is_digit(*pos_))
+                        return false;
+                    skip_digits();
+                }
+                if (pos_ < end_ && (*pos_ == 'e' || *pos_ == 'E'))
+                {
+                    integral = false;
+                    ++pos_;
+                    if (pos_ < end_ && (*pos_ == '+' || *pos_ == '-'))
+                        ++pos_;
+                    if (pos_ == end_ || !is_digit(*pos_))
+                        return false;
+                    skip_digits();
+                }
+
+                token = std::string_view(start, pos_ - start);
+                return true;
+            }
+
+            bool skip_value(int depth)
+            {
+                if (depth > MAX_SKIP_DEPTH)
+                    return false;
+
+                skip_whitespace();
+                if (pos_ == end_)
+                    return false;
+
+                std::string_view token;
+                bool flag;
+                switch (*pos_)
+                {
+                case '"':
+                    return string(token, flag);
+                case '{':
+                    ++pos_;
+                    if (consume('}'))
+                        return true;
+                    do
+                    {
+                        if (!string(token, flag) || !consume(':') || !skip_value(depth + 1))
+                            return false;
+                    } while (consume(','));
+                    return consume('}');
+                case '[':
+                    ++pos_;
+                    if (consume(']'))
+                        return true;
+                    do
+                    {
+                        if (!skip_value(depth + 1))
+                            return false;
+                    } while (consume(','));
+                    return consume(']');
+                case 't':
+                    return literal("true");
+                case 'f':
+                    return literal("false");
+                case 'n':
+                    return literal("null");
+                default:
+                    return number(token, flag);
+                }
+            }
+
+        private:
+            const char *pos_;
+            const char *end_;
+
+            void skip_whitespace()
+            {
+                while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r'))
+                    ++pos_;
+            }
+
+            void skip_digits()
+            {
+                while (pos_ < end_ && is_digit(*pos_))
+                    ++pos_;
+            }
+
+            bool literal(std::string_view word)
+            {
+                if (static_cast<size_t>(end_ - pos_) < word.size() || std::string_view(pos_, word.size()) != word)
+                    return false;
+                pos_ += word.size();
+                return true;
+            }
+        };
+
+        bool read_string(Cursor &in, std::string_view &out)
+        {
+            bool escaped;
+            return in.string(out, escaped) && !escaped;
+        }
+
+        bool read_double(Cursor &in, double &out)
+        {
+            std::string_view token;
+            bool integral;
+            if (!in.number(token, integral))
+                return false;
+            auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+            return result.ec == std::errc() && result.ptr == token.data() + token.size();
+        }
+
+        // Only plain non-negative integers take the fast path; the full
+        // parser has its own rules for converting anything else.
+        bool read_unsigned(Cursor &in, uint64_t &out)
+        {
+            std::string_view token;
+            bool integral;
+            if (!in.number(token, integral) || !integral || token[0] == '-')
+                return false;
+            auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+            return result.ec == std::errc() && result.ptr == token.data() + token.size();
+        }
+
+        InboundType parse_type(std::string_view type)
+        {
+            if (type == "order")
+                return InboundType::ORDER;
+            if (type == "cancel")
+                return InboundType::CANCEL;
+            if (type == "amend")
+                return InboundType::AMEND;
+            if (type == "mass_cancel")
+                return InboundType::MASS_CANCEL;
+            if (type == "batch")
+                return InboundType::BATCH;
+            if (type == "subscribe")
+                return InboundType::SUBSCRIBE;
+            if (type == "unsubscribe")
+                return InboundType::UNSUBSCRIBE;
+            if (type == "logon")
+                return InboundType::LOGON;
+            if (type == "snapshot")
+                return InboundType::SNAPSHOT;
+            return InboundType::UNKNOWN;
+        }
+    }
+
+    bool MessageDecoder::decode(std::string_view frame, InboundMessage &message)
+    {
+        message = InboundMessage{};
+        Cursor in(frame);
+        std::string_view type;
+
+        if (!in.consume('{'))
+            return false;
+
+        if (!in.consume('}'))
+        {
+            do
+            {
+                std::string_view key;
+                if (!read_string(in, key) || !in.consume(':'))
+                    return false;
+
+                bool ok;
+                if (key == "type")
+                    ok = read_string(in, type);
+                else if (key == "symbol")
+                    ok = read_string(in, message.symbol);
+                else if (key == "order_type")
+                    ok = read_string(in, message.order_type);
+                else if (key == "side")
+                    ok = read_string(in, message.side);
+                else if (key == "order_id")
+                    ok = read_string(in, message.order_id);
+                else if (key == "time_in_force")
+                    ok = read_string(in, message.time_in_force);
+                else if (key == "quantity")
+                    ok = read_double(in, message.quantity);
+                else if (key == "price")
+                    ok = read_double(in, message.price);
+                else if (key == "expire_time")
+                    ok = read_unsigned(in, message.expire_time);
+                else
+                    ok = in.skip_value(0);
+
+                if (!ok)
+                    return false;
+            } while (in.consume(','));
+
+            if (!in.consume('}'))
+                return false;
+        }
+
+        if (!in.at_end())
+            return false;
+
+        message.type = parse_type(type);
+        return true;
+    }
+
+    void MessageDecoder::fill(const InboundMessage &message, OrderRequest &request)
+    {
+        request.symbol.assign(message.symbol);
+        request.order_type.assign(message.order_type);
+        request.side.assign(message.side);
+        request.quantity = message.quantity;
+        request.price = message.price;
+        request.order_id.assign(message.order_id);
+        request.time_in_force.assign(message.time_in_force);
+        request.expire_time = message.expire_time;
+    }
+
+    void MessageDecoder::fill(const InboundMessage &message, CancelRequest &request)
+    {
+        request.symbol.assign(message.symbol);
+        request.order_id.assign(message.order_id);
+    }
+
+    void MessageDecoder::fill(const InboundMessage &message, AmendRequest &request)
+    {
+        request.symbol.assign(message.symbol);
+        request.order_id.assign(message.order_id);
+        request.quantity = message.quantity;
+        request.price = message.price;
+    }
+
+    void MessageDecoder::fill(const InboundMessage &message, MassCancelRequest &request)
+    {
+        request.symbol.assign(message.symbol);
+        request.side.assign(message.side);
+    }
+
+}
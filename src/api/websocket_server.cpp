@@ -2,11 +2,38 @@
 #include "api/json_serializer.hpp"
 #include "utils/uuid_generator.hpp"
 #include "config/config_manager.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <sstream>
 
 namespace GoQuant {
 
+namespace {
+
+bool parse_channel(const std::string& name, MarketDataChannel& channel) {
+    if (name == "bbo") {
+        channel = MarketDataChannel::BBO;
+    } else if (name == "depth") {
+        channel = MarketDataChannel::DEPTH;
+    } else if (name == "trades") {
+        channel = MarketDataChannel::TRADES;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// One uWS topic per channel and symbol, e.g. "depth:3".
+std::string topic_name(MarketDataChannel channel, SymbolId symbol_id) {
+    static const char* const prefixes[] = {"bbo:", "depth:", "trades:"};
+    return prefixes[static_cast<size_t>(channel)] + std::to_string(symbol_id);
+}
+
+}
+
 WebSocketServer::WebSocketServer(MatchingEngine& engine, int port) 
     : engine_(engine), port_(port) {
     
@@ -14,46 +41,38 @@ WebSocketServer::WebSocketServer(MatchingEngine& engine, int port)
     if (port == 9001) {
         port_ = config.websocket_port;
     }
+    cancel_on_disconnect_ = config.cancel_on_disconnect;
     
     app_ = std::make_unique<uWS::App>();
+    loop_ = uWS::Loop::get();
     
     app_->ws<PerSocketData>("/*", {
         .idleTimeout = 120,
         .maxBackpressure = 1024 * 1024,
         .maxPayloadLength = 16 * 1024 * 1024,
         .open = [this](auto* ws) {
+            ws->getUserData()->session_id = next_session_id_++;
             std::lock_guard<std::mutex> lock(connections_mutex_);
             active_connections_++;
             std::cout << "Client connected. Total connections: " << active_connections_ << std::endl;
         },
         .message = [this](auto* ws, std::string_view message, uWS::OpCode opCode) {
-            try {
-                std::string msg_str(message);
-                auto j = nlohmann::json::parse(msg_str);
-                std::string message_type = j.value("type", "");
-                
-                if (message_type == "order") {
-                    handle_order_request(ws, msg_str);
-                } else if (message_type == "cancel") {
-                    handle_cancel_request(ws, msg_str);
-                } else if (message_type == "subscribe") {
-                    handle_market_data_request(ws, msg_str);
-                } else if (message_type == "unsubscribe") {
-                    handle_unsubscribe_request(ws, msg_str);
-                } else {
-                    ErrorResponse error{"invalid_message", "Unknown message type"};
-                    send_message(ws, JsonSerializer::serialize_error_response(error));
-                }
-            } catch (const std::exception& e) {
-                ErrorResponse error{"parse_error", e.what()};
-                send_message(ws, JsonSerializer::serialize_error_response(error));
+            if (opCode == uWS::OpCode::BINARY) {
+                handle_binary_message(ws, message);
+            } else {
+                handle_message(ws, message);
             }
         },
         .close = [this](auto* ws, int code, std::string_view message) {
             std::lock_guard<std::mutex> lock(connections_mutex_);
             active_connections_ = std::max(0, active_connections_ - 1);
             std::cout << "Client disconnected. Total connections: " << active_connections_ << std::endl;
-            unsubscribe_all(ws);
+            // uWS drops the socket from its topics on close.
+            release_orders(ws);
+            // Parked rather than dropped if a matching queue is full.
+            if (cancel_on_disconnect_) {
+                engine_.cancel_session_orders(ws->getUserData()->session_id);
+            }
         }
     });
     
@@ -82,34 +101,707 @@ WebSocketServer::WebSocketServer(MatchingEngine& engine, int port)
     });
 }
 
-void WebSocketServer::handle_unsubscribe_request(uWS::WebSocket<false, true>* ws, const std::string& message) {
+// Order entry is decoded straight off the frame in one pass; batches,
+// subscriptions, logons and anything the decoder declines go through the
+// JSON DOM.
+void WebSocketServer::handle_message(WebSocket* ws, std::string_view message) {
     try {
-        MarketDataRequest request = JsonSerializer::parse_market_data_request(message);
+        if (!MessageDecoder::decode(message, inbound_)) {
+            handle_json_message(ws, message);
+            return;
+        }
         
-        if (request.symbol.empty() || request.type.empty()) {
-            ErrorResponse error{"invalid_request", "Missing symbol or subscription type"};
+        switch (inbound_.type) {
+        case InboundType::ORDER:
+            MessageDecoder::fill(inbound_, order_request_);
+            handle_order_request(ws, order_request_);
+            break;
+        case InboundType::CANCEL:
+            MessageDecoder::fill(inbound_, cancel_request_);
+            handle_cancel_request(ws, cancel_request_);
+            break;
+        case InboundType::AMEND:
+            MessageDecoder::fill(inbound_, amend_request_);
+            handle_amend_request(ws, amend_request_);
+            break;
+        case InboundType::MASS_CANCEL:
+            MessageDecoder::fill(inbound_, mass_cancel_request_);
+            handle_mass_cancel_request(ws, mass_cancel_request_);
+            break;
+        case InboundType::BATCH:
+        case InboundType::SUBSCRIBE:
+        case InboundType::UNSUBSCRIBE:
+        case InboundType::LOGON:
+        case InboundType::SNAPSHOT:
+            handle_json_message(ws, message);
+            break;
+        case InboundType::UNKNOWN: {
+            ErrorResponse error{"invalid_message", "Unknown message type"};
+            send_message(ws, JsonSerializer::serialize_error_response(error));
+            break;
+        }
+        }
+    } catch (const std::exception& e) {
+        ErrorResponse error{"parse_error", e.what()};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+    }
+}
+
+void WebSocketServer::handle_json_message(WebSocket* ws, std::string_view message) {
+    std::string msg_str(message);
+    auto j = nlohmann::json::parse(msg_str);
+    std::string message_type = j.value("type", "");
+    
+    if (message_type == "order") {
+        handle_order_request(ws, JsonSerializer::parse_order_request(msg_str));
+    } else if (message_type == "cancel") {
+        handle_cancel_request(ws, JsonSerializer::parse_cancel_request(msg_str));
+    } else if (message_type == "amend") {
+        handle_amend_request(ws, JsonSerializer::parse_amend_request(msg_str));
+    } else if (message_type == "mass_cancel") {
+        handle_mass_cancel_request(ws, JsonSerializer::parse_mass_cancel_request(msg_str));
+    } else if (message_type == "batch") {
+        handle_batch_request(ws, j);
+    } else if (message_type == "subscribe") {
+        handle_market_data_request(ws, msg_str);
+    } else if (message_type == "unsubscribe") {
+        handle_unsubscribe_request(ws, msg_str);
+    } else if (message_type == "snapshot") {
+        handle_snapshot_request(ws, msg_str);
+    } else if (message_type == "logon") {
+        handle_logon_request(ws, j);
+    } else {
+        ErrorResponse error{"invalid_message", "Unknown message type"};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+    }
+}
+
+bool WebSocketServer::make_order(const OrderRequest& request, SessionId session, Order& order, ErrorResponse& error) {
+    auto book = engine_.get_order_book(request.symbol);
+    if (!book) {
+        error = ErrorResponse{"invalid_symbol", "Symbol not supported: " + request.symbol};
+        return false;
+    }
+    
+    const PriceScale& scale = book->get_scale();
+    if (!scale.is_on_step(request.quantity) || !scale.is_on_tick(request.price)) {
+        error = ErrorResponse{"invalid_request", "Price or quantity not aligned to tick/step size"};
+        return false;
+    }
+    
+    try {
+        std::string order_id = request.order_id.empty() ? UUIDGenerator::generate() : request.order_id;
+        order = Order(order_id, request.symbol,
+                      JsonSerializer::parse_order_type(request.order_type),
+                      JsonSerializer::parse_order_side(request.side),
+                      scale.to_lots(request.quantity), scale.to_ticks(request.price),
+                      JsonSerializer::get_current_timestamp());
+        order.symbol_id = book->get_symbol_id();
+        order.session_id = session;
+        order.expire_time = JsonSerializer::resolve_expire_time(request.time_in_force, request.expire_time);
+    } catch (const std::invalid_argument& e) {
+        error = ErrorResponse{"invalid_request", e.what()};
+        return false;
+    }
+    return true;
+}
+
+void WebSocketServer::handle_order_request(WebSocket* ws, const OrderRequest& request) {
+    Order order;
+    ErrorResponse error;
+    if (!make_order(request, ws->getUserData()->session_id, order, error)) {
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return;
+    }
+    auto& orders = ws->getUserData()->orders;
+    if (orders.contains(order.order_id)) {
+        OrderResponse response(order.order_id, "rejected", "Duplicate order id");
+        send_message(ws, JsonSerializer::serialize_order_response(response));
+        return;
+    }
+    
+    OrderHandle handle = engine_.submit_order(order);
+    bool accepted = handle != INVALID_ORDER_HANDLE;
+    if (accepted) {
+        order_owners_[handle] = OrderOwner{ws, 0, order.order_id, false};
+        if (order.type == OrderType::LIMIT) {
+            orders.insert(order.order_id, handle);
+        }
+    }
+    OrderResponse response(order.order_id, !accepted ? "rejected" : engine_.is_sharded() ? "queued" : "accepted");
+    send_message(ws, JsonSerializer::serialize_order_response(response));
+}
+
+void WebSocketServer::handle_cancel_request(WebSocket* ws, const CancelRequest& request) {
+    OrderHandle handle = ws->getUserData()->orders.find(request.order_id);
+    // The id is released by the order's ORDER_CLOSED or final fill, never
+    // here: after a refused cancel, e.g. for the wrong symbol, the order may
+    // still be live and must stay reachable.
+    bool cancelled = handle != INVALID_ORDER_HANDLE && engine_.cancel_order(request.symbol, handle);
+    OrderResponse response(request.order_id, !cancelled ? "rejected" : engine_.is_sharded() ? "queued" : "cancelled",
+                           cancelled ? "" : "Order not found");
+    send_message(ws, JsonSerializer::serialize_order_response(response));
+}
+
+void WebSocketServer::handle_amend_request(WebSocket* ws, const AmendRequest& request) {
+    OrderHandle handle = ws->getUserData()->orders.find(request.order_id);
+    auto book = engine_.get_order_book(request.symbol);
+    if (handle == INVALID_ORDER_HANDLE || !book) {
+        OrderResponse response(request.order_id, "rejected", "Order not found");
+        send_message(ws, JsonSerializer::serialize_order_response(response));
+        return;
+    }
+    
+    const PriceScale& scale = book->get_scale();
+    if (!scale.is_on_step(request.quantity) || !scale.is_on_tick(request.price)) {
+        ErrorResponse error{"invalid_request", "Price or quantity not aligned to tick/step size"};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return;
+    }
+    
+    bool amended = engine_.amend_order(book->get_symbol_id(), handle,
+                                       scale.to_ticks(request.price), scale.to_lots(request.quantity));
+    OrderResponse response(request.order_id, !amended ? "rejected" : engine_.is_sharded() ? "queued" : "amended",
+                           amended ? "" : "Amend refused");
+    send_message(ws, JsonSerializer::serialize_order_response(response));
+}
+
+// One request pulls every matching quote of this connection; the engine
+// turns it into a single command per book.
+void WebSocketServer::handle_mass_cancel_request(WebSocket* ws, const MassCancelRequest& request) {
+    SymbolId symbol_id = INVALID_SYMBOL_ID;
+    if (!request.symbol.empty()) {
+        symbol_id = engine_.get_symbol_id(request.symbol);
+        if (symbol_id == INVALID_SYMBOL_ID) {
+            ErrorResponse error{"invalid_symbol", "Symbol not supported: " + request.symbol};
             send_message(ws, JsonSerializer::serialize_error_response(error));
             return;
         }
+    }
+    
+    std::optional<OrderSide> side;
+    if (!request.side.empty()) {
+        try {
+            side = JsonSerializer::parse_order_side(request.side);
+        } catch (const std::invalid_argument& e) {
+            ErrorResponse error{"invalid_request", e.what()};
+            send_message(ws, JsonSerializer::serialize_error_response(error));
+            return;
+        }
+    }
+    
+    // Client ids of the cancelled orders are released by their ORDER_CLOSED.
+    bool accepted = engine_.cancel_session_orders(ws->getUserData()->session_id, symbol_id, side);
+    send_message(ws, JsonSerializer::serialize_mass_cancel_response(request, accepted));
+}
+
+// Decodes the whole frame once, applies all cancels and then all orders
+// through the engine's batch calls, and answers with a single frame. Entries
+// a matching thread refuses later are rejected one by one, like single
+// requests.
+void WebSocketServer::handle_batch_request(WebSocket* ws, const nlohmann::json& message) {
+    BatchRequest request = JsonSerializer::parse_batch_request(message);
+    auto& client_orders = ws->getUserData()->orders;
+    std::vector<OrderResponse> responses;
+    responses.reserve(request.cancels.size() + request.orders.size());
+    
+    std::vector<std::pair<SymbolId, OrderHandle>> cancels;
+    std::vector<size_t> cancel_slots;
+    for (const auto& cancel : request.cancels) {
+        responses.emplace_back(cancel.order_id, "rejected", "Order not found");
+        OrderHandle handle = client_orders.find(cancel.order_id);
+        if (handle != INVALID_ORDER_HANDLE) {
+            cancels.emplace_back(engine_.get_symbol_id(cancel.symbol), handle);
+            cancel_slots.push_back(responses.size() - 1);
+        }
+    }
+    
+    std::vector<bool> cancelled = engine_.cancel_orders(cancels);
+    for (size_t i = 0; i < cancelled.size(); ++i) {
+        if (cancelled[i]) {
+            responses[cancel_slots[i]] = OrderResponse(responses[cancel_slots[i]].order_id,
+                                                       engine_.is_sharded() ? "queued" : "cancelled");
+        }
+    }
+    
+    std::vector<Order> orders;
+    std::vector<size_t> order_slots;
+    orders.reserve(request.orders.size());
+    for (const auto& order_request : request.orders) {
+        Order order;
+        ErrorResponse error;
+        if (!make_order(order_request, ws->getUserData()->session_id, order, error)) {
+            responses.emplace_back(order_request.order_id, "rejected", error.message);
+            continue;
+        }
+        bool duplicate = client_orders.contains(order.order_id) ||
+                         std::any_of(orders.begin(), orders.end(),
+                                     [&](const Order& queued) { return queued.order_id == order.order_id; });
+        if (duplicate) {
+            responses.emplace_back(order.order_id, "rejected", "Duplicate order id");
+            continue;
+        }
+        responses.emplace_back(order.order_id, "rejected");
+        order_slots.push_back(responses.size() - 1);
+        orders.push_back(std::move(order));
+    }
+    
+    std::vector<bool> rests(orders.size());
+    for (size_t i = 0; i < orders.size(); ++i) {
+        rests[i] = orders[i].type == OrderType::LIMIT;
+    }
+    
+    std::vector<OrderHandle> handles = engine_.submit_orders(std::move(orders));
+    for (size_t i = 0; i < handles.size(); ++i) {
+        OrderResponse& response = responses[order_slots[i]];
+        if (handles[i] == INVALID_ORDER_HANDLE) {
+            continue;
+        }
+        response.status = engine_.is_sharded() ? "queued" : "accepted";
+        order_owners_[handles[i]] = OrderOwner{ws, 0, response.order_id, false};
+        if (rests[i]) {
+            client_orders.insert(response.order_id, handles[i]);
+        }
+    }
+    
+    send_message(ws, JsonSerializer::serialize_batch_response(responses));
+}
+
+// Switches the connection to binary order entry and tells the client the
+// symbol ids and scales the binary messages are expressed in.
+void WebSocketServer::handle_logon_request(WebSocket* ws, const nlohmann::json& message) {
+    std::string protocol = message.value("protocol", "json");
+    int version = message.value("version", 0);
+    PerSocketData* data = ws->getUserData();
+    
+    if (protocol == "binary") {
+        if (version != Binary::PROTOCOL_VERSION) {
+            ErrorResponse error{"unsupported_version", "Binary protocol version " +
+                                std::to_string(Binary::PROTOCOL_VERSION) + " required"};
+            send_message(ws, JsonSerializer::serialize_error_response(error));
+            return;
+        }
+        if (!data->binary) {
+            data->binary = true;
+            binary_sessions_++;
+        }
+    } else if (protocol != "json") {
+        ErrorResponse error{"invalid_request", "Unknown protocol: " + protocol};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return;
+    }
+    
+    nlohmann::json response;
+    response["type"] = "logon_ack";
+    response["protocol"] = data->binary ? "binary" : "json";
+    response["version"] = data->binary ? Binary::PROTOCOL_VERSION : 0;
+    response["symbols"] = nlohmann::json::array();
+    const SymbolRegistry& symbols = engine_.get_symbol_registry();
+    for (SymbolId symbol_id = 0; symbol_id < symbols.size(); ++symbol_id) {
+        auto book = engine_.get_order_book(symbol_id);
+        if (!book) {
+            continue;
+        }
+        response["symbols"].push_back({{"symbol", book->get_symbol()},
+                                       {"symbol_id", symbol_id},
+                                       {"tick_size", book->get_scale().price_tick},
+                                       {"step_size", book->get_scale().quantity_step}});
+    }
+    send_message(ws, response.dump());
+}
+
+void WebSocketServer::handle_binary_message(WebSocket* ws, std::string_view message) {
+    if (!ws->getUserData()->binary) {
+        ErrorResponse error{"protocol_error", "Binary frames require a binary logon"};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return;
+    }
+    
+    Binary::Header header;
+    if (message.size() < sizeof(header)) {
+        send_binary_reject(ws, Binary::RejectReason::MALFORMED, Binary::MessageType{}, INVALID_SYMBOL_ID, 0);
+        return;
+    }
+    std::memcpy(&header, message.data(), sizeof(header));
+    if (header.version != Binary::PROTOCOL_VERSION) {
+        send_binary_reject(ws, Binary::RejectReason::UNSUPPORTED_VERSION, header.type, INVALID_SYMBOL_ID, 0);
+        return;
+    }
+    
+    bool decoded = false;
+    switch (header.type) {
+    case Binary::MessageType::NEW_ORDER: {
+        Binary::NewOrder order;
+        if ((decoded = Binary::read(message, order))) {
+            handle_binary_order(ws, order);
+        }
+        break;
+    }
+    case Binary::MessageType::CANCEL: {
+        Binary::Cancel cancel;
+        if ((decoded = Binary::read(message, cancel))) {
+            handle_binary_cancel(ws, cancel);
+        }
+        break;
+    }
+    case Binary::MessageType::AMEND: {
+        Binary::Amend amend;
+        if ((decoded = Binary::read(message, amend))) {
+            handle_binary_amend(ws, amend);
+        }
+        break;
+    }
+    case Binary::MessageType::MASS_CANCEL: {
+        Binary::MassCancel mass_cancel;
+        if ((decoded = Binary::read(message, mass_cancel))) {
+            handle_binary_mass_cancel(ws, mass_cancel);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    
+    if (!decoded) {
+        send_binary_reject(ws, Binary::RejectReason::MALFORMED, header.type, INVALID_SYMBOL_ID, 0);
+    }
+}
+
+void WebSocketServer::handle_binary_order(WebSocket* ws, const Binary::NewOrder& message) {
+    auto book = engine_.get_order_book(message.symbol_id);
+    if (!book) {
+        send_binary_reject(ws, Binary::RejectReason::UNKNOWN_SYMBOL, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    
+    uint64_t expire_time = 0;
+    bool valid = message.side <= static_cast<uint8_t>(OrderSide::SELL) &&
+                 message.order_type <= static_cast<uint8_t>(OrderType::FOK) && message.quantity > 0 &&
+                 message.price >= 0;
+    switch (message.time_in_force) {
+    case Binary::TimeInForce::GTC:
+        break;
+    case Binary::TimeInForce::GTT:
+        expire_time = message.expire_time;
+        valid = valid && expire_time != 0;
+        break;
+    case Binary::TimeInForce::GFD:
+        expire_time = JsonSerializer::resolve_expire_time("gfd", 0);
+        break;
+    default:
+        valid = false;
+        break;
+    }
+    if (!valid) {
+        send_binary_reject(ws, Binary::RejectReason::INVALID_FIELD, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    
+    PerSocketData* data = ws->getUserData();
+    if (data->binary_orders.contains(message.client_order_id)) {
+        send_binary_reject(ws, Binary::RejectReason::DUPLICATE_ORDER, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    
+    Order order(std::to_string(message.client_order_id), book->get_symbol(),
+                static_cast<OrderType>(message.order_type), static_cast<OrderSide>(message.side),
+                message.quantity, message.price, JsonSerializer::get_current_timestamp());
+    order.symbol_id = message.symbol_id;
+    order.session_id = data->session_id;
+    order.expire_time = expire_time;
+    
+    OrderHandle handle = engine_.submit_order(std::move(order));
+    if (handle == INVALID_ORDER_HANDLE) {
+        send_binary_reject(ws, Binary::RejectReason::ENGINE_REJECTED, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    
+    // Fills and the close of this order are deferred onto this thread, so
+    // registering the owner after submit still catches what it did inline.
+    // Only a resting order can be cancelled or amended by client id.
+    order_owners_[handle] = OrderOwner{ws, message.client_order_id, {}, true};
+    if (message.order_type == static_cast<uint8_t>(OrderType::LIMIT)) {
+        data->binary_orders.insert(message.client_order_id, handle);
+    }
+    send_binary_ack(ws, engine_.is_sharded() ? Binary::AckStatus::ORDER_QUEUED : Binary::AckStatus::ACCEPTED,
+                    message.symbol_id, message.client_order_id);
+}
+
+void WebSocketServer::handle_binary_cancel(WebSocket* ws, const Binary::Cancel& message) {
+    OrderHandle handle = ws->getUserData()->binary_orders.find(message.client_order_id);
+    if (handle == INVALID_ORDER_HANDLE || !engine_.cancel_order(message.symbol_id, handle)) {
+        send_binary_reject(ws, Binary::RejectReason::UNKNOWN_ORDER, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    // The routes go with the ORDER_CLOSED that follows, after any fill
+    // still queued for delivery.
+    send_binary_ack(ws, engine_.is_sharded() ? Binary::AckStatus::CANCEL_QUEUED : Binary::AckStatus::CANCELLED,
+                    message.symbol_id, message.client_order_id);
+}
+
+void WebSocketServer::handle_binary_amend(WebSocket* ws, const Binary::Amend& message) {
+    OrderHandle handle = ws->getUserData()->binary_orders.find(message.client_order_id);
+    if (handle == INVALID_ORDER_HANDLE) {
+        send_binary_reject(ws, Binary::RejectReason::UNKNOWN_ORDER, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    if (message.quantity <= 0 || message.price <= 0 ||
+        !engine_.amend_order(message.symbol_id, handle, message.price, message.quantity)) {
+        send_binary_reject(ws, Binary::RejectReason::ENGINE_REJECTED, message.header.type,
+                           message.symbol_id, message.client_order_id);
+        return;
+    }
+    send_binary_ack(ws, engine_.is_sharded() ? Binary::AckStatus::AMEND_QUEUED : Binary::AckStatus::AMENDED,
+                    message.symbol_id, message.client_order_id);
+}
+
+void WebSocketServer::handle_binary_mass_cancel(WebSocket* ws, const Binary::MassCancel& message) {
+    if (message.side != Binary::ANY_SIDE && message.side > static_cast<uint8_t>(OrderSide::SELL)) {
+        send_binary_reject(ws, Binary::RejectReason::INVALID_FIELD, message.header.type, message.symbol_id, 0);
+        return;
+    }
+    
+    std::optional<OrderSide> side;
+    if (message.side != Binary::ANY_SIDE) {
+        side = static_cast<OrderSide>(message.side);
+    }
+    
+    PerSocketData* data = ws->getUserData();
+    if (!engine_.cancel_session_orders(data->session_id, message.symbol_id, side)) {
+        send_binary_reject(ws, Binary::RejectReason::ENGINE_REJECTED, message.header.type, message.symbol_id, 0);
+        return;
+    }
+    send_binary_ack(ws, Binary::AckStatus::MASS_CANCEL_QUEUED, message.symbol_id, 0);
+}
+
+// Without binary sessions a fill only matters here when it ends an order.
+void WebSocketServer::report_fill(const Trade& trade) {
+    if (!loop_ || (binary_sessions_.load(std::memory_order_relaxed) == 0 && trade.maker_leaves != 0 &&
+                   trade.taker_leaves != 0)) {
+        return;
+    }
+    loop_->defer([this, trade]() { deliver_fill(trade); });
+}
+
+void WebSocketServer::report_order_event(const EngineEvent& event) {
+    if (!loop_) {
+        return;
+    }
+    loop_->defer([this, type = event.type, handle = event.handle, symbol_id = event.symbol_id]() {
+        deliver_order_event(type, handle, symbol_id);
+    });
+}
+
+// A rejection reaches the session whose request was acked as queued. One
+// for an order the gateway no longer tracks is dropped: the order already
+// ended, which its final fill or ORDER_CLOSED settled, or its connection
+// is gone.
+void WebSocketServer::deliver_order_event(EngineEvent::Type type, OrderHandle handle, SymbolId symbol_id) {
+    Binary::MessageType request_type;
+    Binary::RejectReason reason;
+    const char* text;
+    switch (type) {
+    case EngineEvent::Type::ORDER_REJECTED:
+        request_type = Binary::MessageType::NEW_ORDER;
+        reason = Binary::RejectReason::ENGINE_REJECTED;
+        text = "Rejected by matching engine";
+        break;
+    case EngineEvent::Type::CANCEL_REJECTED:
+        request_type = Binary::MessageType::CANCEL;
+        reason = Binary::RejectReason::UNKNOWN_ORDER;
+        text = "Order not found";
+        break;
+    case EngineEvent::Type::AMEND_REJECTED:
+        request_type = Binary::MessageType::AMEND;
+        reason = Binary::RejectReason::ENGINE_REJECTED;
+        text = "Amend refused";
+        break;
+    case EngineEvent::Type::ORDER_CLOSED:
+        retire_order(handle);
+        return;
+    default:
+        return;
+    }
+    
+    auto it = order_owners_.find(handle);
+    if (it == order_owners_.end()) {
+        return;
+    }
+    const OrderOwner& owner = it->second;
+    if (owner.binary) {
+        send_binary_reject(owner.ws, reason, request_type, symbol_id, owner.client_order_id);
+    } else {
+        OrderResponse response(owner.order_id, "rejected", text);
+        send_message(owner.ws, JsonSerializer::serialize_order_response(response));
+    }
+    if (type == EngineEvent::Type::ORDER_REJECTED) {
+        retire_order(handle);
+    }
+}
+
+void WebSocketServer::deliver_fill(const Trade& trade) {
+    for (OrderHandle handle : {trade.maker_handle, trade.taker_handle}) {
+        auto it = order_owners_.find(handle);
+        if (it == order_owners_.end()) {
+            continue;
+        }
         
-        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        bool is_maker = handle == trade.maker_handle;
+        if (it->second.binary) {
+            Binary::Fill fill = Binary::make<Binary::Fill>(Binary::MessageType::FILL);
+            fill.is_maker = is_maker;
+            fill.symbol_id = trade.symbol_id;
+            fill.client_order_id = it->second.client_order_id;
+            fill.trade_id = trade.trade_id;
+            fill.price = trade.price;
+            fill.quantity = trade.quantity;
+            fill.timestamp = trade.timestamp;
+            it->second.ws->send(Binary::bytes(fill), uWS::OpCode::BINARY);
+        }
         
-        if (request.type == "bbo") {
-            auto it = bbo_subscribers_.find(request.symbol);
-            if (it != bbo_subscribers_.end()) {
-                it->second.erase(ws);
-            }
-        } else if (request.type == "depth") {
-            auto it = depth_subscribers_.find(request.symbol);
-            if (it != depth_subscribers_.end()) {
-                it->second.erase(ws);
-            }
-        } else if (request.type == "trades") {
-            auto it = trade_subscribers_.find(request.symbol);
-            if (it != trade_subscribers_.end()) {
-                it->second.erase(ws);
-            }
+        if ((is_maker ? trade.maker_leaves : trade.taker_leaves) == 0) {
+            retire_order(handle);
+        }
+    }
+}
+
+// Drops the routes of an order that can no longer fill. The client id is
+// only released if it still names this order.
+void WebSocketServer::retire_order(OrderHandle handle) {
+    auto it = order_owners_.find(handle);
+    if (it == order_owners_.end()) {
+        return;
+    }
+    PerSocketData* data = it->second.ws->getUserData();
+    if (it->second.binary) {
+        data->binary_orders.release(it->second.client_order_id, handle);
+    } else {
+        data->orders.release(it->second.order_id, handle);
+    }
+    order_owners_.erase(it);
+}
+
+// Drops the routes of a closing connection.
+void WebSocketServer::release_orders(WebSocket* ws) {
+    for (auto it = order_owners_.begin(); it != order_owners_.end();) {
+        it = it->second.ws == ws ? order_owners_.erase(it) : std::next(it);
+    }
+    if (ws->getUserData()->binary) {
+        binary_sessions_--;
+    }
+}
+
+void WebSocketServer::send_binary_ack(WebSocket* ws, Binary::AckStatus status, SymbolId symbol_id,
+                                      uint64_t client_order_id) {
+    Binary::Ack ack = Binary::make<Binary::Ack>(Binary::MessageType::ACK);
+    ack.status = status;
+    ack.symbol_id = symbol_id;
+    ack.client_order_id = client_order_id;
+    ack.timestamp = JsonSerializer::get_current_timestamp();
+    ws->send(Binary::bytes(ack), uWS::OpCode::BINARY);
+}
+
+void WebSocketServer::send_binary_reject(WebSocket* ws, Binary::RejectReason reason, Binary::MessageType request_type,
+                                         SymbolId symbol_id, uint64_t client_order_id) {
+    Binary::Reject reject = Binary::make<Binary::Reject>(Binary::MessageType::REJECT);
+    reject.reason = reason;
+    reject.request_type = request_type;
+    reject.symbol_id = symbol_id;
+    reject.client_order_id = client_order_id;
+    ws->send(Binary::bytes(reject), uWS::OpCode::BINARY);
+}
+
+void WebSocketServer::send_message(WebSocket* ws, const std::string& message) {
+    ws->send(message, uWS::OpCode::TEXT);
+}
+
+// Market data fans out through uWS topics: each update is published once
+// and uWS frames it once for all of the topic's subscribers. Subscribing
+// and unsubscribing only touch the topic tree on the server thread, so
+// they never contend with publishers.
+void WebSocketServer::broadcast_market_data(MarketDataChannel channel, SymbolId symbol_id, std::string message) {
+    if (!loop_) {
+        return;
+    }
+    auto payload = std::make_shared<const std::string>(std::move(message));
+    loop_->defer([this, topic = topic_name(channel, symbol_id), payload]() {
+        app_->publish(topic, *payload, uWS::OpCode::TEXT);
+    });
+}
+
+bool WebSocketServer::resolve_subscription(WebSocket* ws, const MarketDataRequest& request, std::string& topic,
+                                           MarketDataChannel& channel, SymbolId& symbol_id) {
+    if (request.symbol.empty() || request.type.empty()) {
+        ErrorResponse error{"invalid_request", "Missing symbol or subscription type"};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return false;
+    }
+    
+    symbol_id = engine_.get_symbol_id(request.symbol);
+    if (symbol_id == INVALID_SYMBOL_ID) {
+        ErrorResponse error{"invalid_symbol", "Symbol not supported: " + request.symbol};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return false;
+    }
+    
+    if (!parse_channel(request.type, channel)) {
+        ErrorResponse error{"invalid_request", "Unknown subscription type: " + request.type};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+        return false;
+    }
+    
+    topic = topic_name(channel, symbol_id);
+    return true;
+}
+
+void WebSocketServer::handle_market_data_request(WebSocket* ws, const std::string& message) {
+    try {
+        MarketDataRequest request = JsonSerializer::parse_market_data_request(message);
+        std::string topic;
+        MarketDataChannel channel;
+        SymbolId symbol_id;
+        if (!resolve_subscription(ws, request, topic, channel, symbol_id)) {
+            return;
+        }
+        ws->subscribe(topic);
+        
+        nlohmann::json response;
+        response["type"] = "subscribe_ack";
+        response["symbol"] = request.symbol;
+        response["subscription_type"] = request.type;
+        response["timestamp"] = JsonSerializer::get_current_timestamp();
+        
+        send_message(ws, response.dump());
+        
+        // Deltas are published on this thread too, so the snapshot reaches
+        // the socket before any delta. Deltas at or below its sequence that
+        // were already queued are reflected in it.
+        if (channel == MarketDataChannel::DEPTH) {
+            send_depth_snapshot(ws, symbol_id);
+        }
+        
+    } catch (const std::exception& e) {
+        ErrorResponse error{"subscribe_error", e.what()};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+    }
+}
+
+void WebSocketServer::handle_unsubscribe_request(WebSocket* ws, const std::string& message) {
+    try {
+        MarketDataRequest request = JsonSerializer::parse_market_data_request(message);
+        std::string topic;
+        MarketDataChannel channel;
+        SymbolId symbol_id;
+        if (!resolve_subscription(ws, request, topic, channel, symbol_id)) {
+            return;
         }
+        ws->unsubscribe(topic);
         
         nlohmann::json response;
         response["type"] = "unsubscribe_ack";
@@ -125,4 +817,36 @@ void WebSocketServer::handle_unsubscribe_request(uWS::WebSocket<false, true>* ws
     }
 }
 
-} 
\ No newline at end of file
+// A client that sees a gap in order_book_delta sequences asks for a fresh
+// snapshot and drops deltas at or below its sequence.
+void WebSocketServer::handle_snapshot_request(WebSocket* ws, const std::string& message) {
+    try {
+        MarketDataRequest request = JsonSerializer::parse_market_data_request(message);
+        SymbolId symbol_id = engine_.get_symbol_id(request.symbol);
+        if (symbol_id == INVALID_SYMBOL_ID) {
+            ErrorResponse error{"invalid_symbol", "Symbol not supported: " + request.symbol};
+            send_message(ws, JsonSerializer::serialize_error_response(error));
+            return;
+        }
+        send_depth_snapshot(ws, symbol_id);
+        
+    } catch (const std::exception& e) {
+        ErrorResponse error{"snapshot_error", e.what()};
+        send_message(ws, JsonSerializer::serialize_error_response(error));
+    }
+}
+
+void WebSocketServer::send_depth_snapshot(WebSocket* ws, SymbolId symbol_id) {
+    auto book = engine_.get_order_book(symbol_id);
+    if (!book) {
+        return;
+    }
+    
+    std::vector<std::pair<Price, Quantity>> bids;
+    std::vector<std::pair<Price, Quantity>> asks;
+    uint64_t sequence = book->get_depth_snapshot(bids, asks);
+    send_message(ws, JsonSerializer::serialize_order_book_update(book->get_symbol(), bids, asks, book->get_scale(),
+                                                                 sequence, JsonSerializer::get_current_timestamp()));
+}
+
+}
\ No newline at end of file
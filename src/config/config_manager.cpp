@@ -118,11 +118,13 @@ void ConfigManager::validate_order(const std::string& symbol, double price, doub
         throw std::runtime_error("Quantity out of range for symbol: " + symbol);
     }
     
-    if (std::fmod(price, config.price_tick) != 0.0) {
+    PriceScale scale = config.get_price_scale();
+    
+    if (!scale.is_on_tick(price)) {
         throw std::runtime_error("Price must be multiple of tick size: " + std::to_string(config.price_tick));
     }
     
-    if (std::fmod(quantity, config.quantity_step) != 0.0) {
+    if (!scale.is_on_step(quantity)) {
         throw std::runtime_error("Quantity must be multiple of step size: " + std::to_string(config.quantity_step));
     }
 }
@@ -162,6 +164,16 @@ nlohmann::json EngineConfig::to_json() const {
     j["quantity_step"] = quantity_step;
     j["enable_advanced_orders"] = enable_advanced_orders;
     j["performance_stats_interval"] = performance_stats_interval;
+    j["order_pool_size"] = order_pool_size;
+    j["level_pool_size"] = level_pool_size;
+    j["matching_threads"] = matching_threads;
+    j["matching_queue_size"] = matching_queue_size;
+    j["pin_matching_threads"] = pin_matching_threads;
+    j["cancel_on_disconnect"] = cancel_on_disconnect;
+    j["expiry_check_interval_ms"] = expiry_check_interval_ms;
+    j["trigger_cascade_depth"] = trigger_cascade_depth;
+    j["market_data_bbo_interval_ms"] = market_data_bbo_interval_ms;
+    j["market_data_depth_interval_ms"] = market_data_depth_interval_ms;
     return j;
 }
 
@@ -180,6 +192,16 @@ EngineConfig EngineConfig::from_json(const nlohmann::json& j) {
     config.quantity_step = j.value("quantity_step", 0.001);
     config.enable_advanced_orders = j.value("enable_advanced_orders", true);
     config.performance_stats_interval = j.value("performance_stats_interval", 5);
+    config.order_pool_size = j.value("order_pool_size", 65536);
+    config.level_pool_size = j.value("level_pool_size", 4096);
+    config.matching_threads = j.value("matching_threads", 0);
+    config.matching_queue_size = j.value("matching_queue_size", 65536);
+    config.pin_matching_threads = j.value("pin_matching_threads", false);
+    config.cancel_on_disconnect = j.value("cancel_on_disconnect", true);
+    config.expiry_check_interval_ms = j.value("expiry_check_interval_ms", 100);
+    config.trigger_cascade_depth = j.value("trigger_cascade_depth", 8);
+    config.market_data_bbo_interval_ms = j.value("market_data_bbo_interval_ms", 0);
+    config.market_data_depth_interval_ms = j.value("market_data_depth_interval_ms", 5);
     return config;
 }
 
@@ -192,6 +214,7 @@ nlohmann::json SymbolConfig::to_json() const {
     j["max_quantity"] = max_quantity;
     j["price_tick"] = price_tick;
     j["quantity_step"] = quantity_step;
+    j["book_type"] = book_type;
     return j;
 }
 
@@ -203,7 +226,8 @@ SymbolConfig SymbolConfig::from_json(const nlohmann::json& j) {
         j.value("min_quantity", 0.001),
         j.value("max_quantity", 10000.0),
         j.value("price_tick", 0.01),
-        j.value("quantity_step", 0.001)
+        j.value("quantity_step", 0.001),
+        j.value("book_type", "map")
     );
 }
 
@@ -1,195 +1,290 @@
 #include "core/advanced_orders.hpp"
+#include "utils/logger.hpp"
 #include "utils/uuid_generator.hpp"
-#include <iostream>
+#include <chrono>
 
 namespace GoQuant
 {
 
-    AdvancedOrderManager::AdvancedOrderManager() {}
+    namespace
+    {
+        const char *advanced_type_name(AdvancedOrderType type)
+        {
+            switch (type)
+            {
+            case AdvancedOrderType::STOP_LOSS:
+                return "STOP_LOSS";
+            case AdvancedOrderType::STOP_LIMIT:
+                return "STOP_LIMIT";
+            case AdvancedOrderType::TAKE_PROFIT:
+                return "TAKE_PROFIT";
+            case AdvancedOrderType::TRAILING_STOP:
+                return "TRAILING_STOP";
+            }
+            return "UNKNOWN";
+        }
+    }
+
+    AdvancedOrderManager::AdvancedOrderManager(const SymbolRegistry &symbols) : symbols_(symbols) {}
 
-    void AdvancedOrderManager::add_stop_loss(const std::string &symbol, OrderSide side,
-                                             double quantity, double trigger_price,
-                                             double execution_price)
+    void AdvancedOrderManager::add_symbol(SymbolId symbol_id, const PriceScale &scale)
     {
         std::lock_guard<std::mutex> lock(orders_mutex_);
+        if (symbol_id >= advanced_orders_.size())
+        {
+            advanced_orders_.resize(symbol_id + 1);
+        }
+        advanced_orders_[symbol_id].scale = scale;
+    }
 
-        std::string order_id = generate_order_id();
+    std::string AdvancedOrderManager::add_stop_loss(const std::string &symbol, OrderSide side,
+                                                    Quantity quantity, Price trigger_price,
+                                                    Price execution_price)
+    {
         OrderType ord_type = (execution_price > 0) ? OrderType::LIMIT : OrderType::MARKET;
-        double price = (execution_price > 0) ? execution_price : 0.0;
-
-        AdvancedOrder order(order_id, symbol, AdvancedOrderType::STOP_LOSS,
-                            ord_type, side, quantity, price, trigger_price);
+        Price price = (execution_price > 0) ? execution_price : 0;
+        return add_order(symbol, AdvancedOrderType::STOP_LOSS, ord_type, side, quantity, price, trigger_price);
+    }
 
-        advanced_orders_[symbol].push_back(order);
+    std::string AdvancedOrderManager::add_stop_limit(const std::string &symbol, OrderSide side,
+                                                     Quantity quantity, Price trigger_price,
+                                                     Price limit_price)
+    {
+        return add_order(symbol, AdvancedOrderType::STOP_LIMIT, OrderType::LIMIT, side, quantity,
+                  limit_price, trigger_price);
+    }
 
-        std::cout << "Added STOP_LOSS: " << symbol << " " << quantity
-                  << " @ trigger " << trigger_price << std::endl;
+    std::string AdvancedOrderManager::add_take_profit(const std::string &symbol, OrderSide side,
+                                                      Quantity quantity, Price trigger_price,
+                                                      Price execution_price)
+    {
+        OrderType ord_type = (execution_price > 0) ? OrderType::LIMIT : OrderType::MARKET;
+        Price price = (execution_price > 0) ? execution_price : 0;
+        return add_order(symbol, AdvancedOrderType::TAKE_PROFIT, ord_type, side, quantity, price, trigger_price);
     }
 
-    void AdvancedOrderManager::add_stop_limit(const std::string &symbol, OrderSide side,
-                                              double quantity, double trigger_price,
-                                              double limit_price)
+    std::string AdvancedOrderManager::add_trailing_stop(const std::string &symbol, OrderSide side,
+                                                        Quantity quantity, Price trailing_distance,
+                                                        Price initial_price)
     {
-        std::lock_guard<std::mutex> lock(orders_mutex_);
+        return add_order(symbol, AdvancedOrderType::TRAILING_STOP, OrderType::MARKET, side, quantity,
+                  0, initial_price, trailing_distance);
+    }
 
-        std::string order_id = generate_order_id();
-        AdvancedOrder order(order_id, symbol, AdvancedOrderType::STOP_LIMIT,
-                            OrderType::LIMIT, side, quantity, limit_price, trigger_price);
+    std::string AdvancedOrderManager::add_order(const std::string &symbol, AdvancedOrderType advanced_type,
+                                                OrderType order_type, OrderSide side, Quantity quantity,
+                                                Price price, Price trigger_price, Price trailing_distance)
+    {
+        SymbolId symbol_id = symbols_.find(symbol);
+        if (symbol_id == INVALID_SYMBOL_ID)
+        {
+            LOG_WARN("Rejected {}: Symbol {} not supported", advanced_type_name(advanced_type), symbol);
+            return "";
+        }
 
-        advanced_orders_[symbol].push_back(order);
+        AdvancedOrder order(generate_order_id(), symbol, symbol_id, advanced_type, order_type, side,
+                            quantity, price, trigger_price, trailing_distance);
+        std::string order_id = order.order_id;
 
-        std::cout << "Added STOP_LIMIT: " << symbol << " " << quantity
-                  << " @ trigger " << trigger_price << " limit " << limit_price << std::endl;
-    }
+        // Stops fire on a move through the trigger in the direction that
+        // hurts the position; take-profits on a move in its favour.
+        TriggerDirection direction;
+        switch (advanced_type)
+        {
+        case AdvancedOrderType::TAKE_PROFIT:
+            direction = side == OrderSide::BUY ? TriggerDirection::FALLING : TriggerDirection::RISING;
+            break;
+        case AdvancedOrderType::TRAILING_STOP:
+            direction = TriggerDirection::TRAILING;
+            break;
+        default:
+            direction = side == OrderSide::BUY ? TriggerDirection::RISING : TriggerDirection::FALLING;
+            break;
+        }
 
-    void AdvancedOrderManager::add_take_profit(const std::string &symbol, OrderSide side,
-                                               double quantity, double trigger_price,
-                                               double execution_price)
-    {
         std::lock_guard<std::mutex> lock(orders_mutex_);
 
-        std::string order_id = generate_order_id();
-        OrderType ord_type = (execution_price > 0) ? OrderType::LIMIT : OrderType::MARKET;
-        double price = (execution_price > 0) ? execution_price : 0.0;
-
-        AdvancedOrder order(order_id, symbol, AdvancedOrderType::TAKE_PROFIT,
-                            ord_type, side, quantity, price, trigger_price);
+        if (symbol_id >= advanced_orders_.size())
+        {
+            advanced_orders_.resize(symbol_id + 1);
+        }
 
-        advanced_orders_[symbol].push_back(order);
+        SymbolTriggers &triggers = advanced_orders_[symbol_id];
+        OrderLocation location{symbol_id, direction, {}, 0};
+        switch (direction)
+        {
+        case TriggerDirection::RISING:
+            location.entry = triggers.rising.emplace(trigger_price, std::move(order));
+            break;
+        case TriggerDirection::FALLING:
+            location.entry = triggers.falling.emplace(trigger_price, std::move(order));
+            break;
+        case TriggerDirection::TRAILING:
+            location.trailing_slot = add_trailing(triggers, std::move(order));
+            break;
+        }
+        order_index_.emplace(order_id, location);
 
-        std::cout << "Added TAKE_PROFIT: " << symbol << " " << quantity
-                  << " @ trigger " << trigger_price << std::endl;
+        LOG_INFO("Added {}: {} {} @ trigger {} trail {}", advanced_type_name(advanced_type), symbol,
+                 triggers.scale.to_quantity(quantity), triggers.scale.to_price(trigger_price),
+                 triggers.scale.to_price(trailing_distance));
+        return order_id;
     }
 
-    void AdvancedOrderManager::add_trailing_stop(const std::string &symbol, OrderSide side,
-                                                 double quantity, double trailing_distance,
-                                                 double initial_price)
+    void AdvancedOrderManager::check_triggers(SymbolId symbol_id, Price current_price)
     {
-        std::lock_guard<std::mutex> lock(orders_mutex_);
+        std::vector<AdvancedOrder> fired;
+        take_triggered(symbol_id, current_price, fired);
 
-        std::string order_id = generate_order_id();
-        AdvancedOrder order(order_id, symbol, AdvancedOrderType::TRAILING_STOP,
-                            OrderType::MARKET, side, quantity, 0.0, initial_price, trailing_distance);
+        if (!order_callback_)
+            return;
 
-        advanced_orders_[symbol].push_back(order);
+        for (const AdvancedOrder &order : fired)
+        {
+            order_callback_(to_order(order));
+        }
+    }
 
-        std::cout << "Added TRAILING_STOP: " << symbol << " " << quantity
-                  << " @ trail " << trailing_distance << std::endl;
+    size_t AdvancedOrderManager::collect_triggered(SymbolId symbol_id, Price current_price,
+                                                   std::vector<Order> &released)
+    {
+        std::vector<AdvancedOrder> fired;
+        take_triggered(symbol_id, current_price, fired);
+
+        for (const AdvancedOrder &order : fired)
+        {
+            released.push_back(to_order(order));
+        }
+        return fired.size();
     }
 
-    void AdvancedOrderManager::check_triggers(const std::string &symbol, double current_price)
+    void AdvancedOrderManager::take_triggered(SymbolId symbol_id, Price current_price,
+                                              std::vector<AdvancedOrder> &fired)
     {
         std::lock_guard<std::mutex> lock(orders_mutex_);
 
-        auto it = advanced_orders_.find(symbol);
-        if (it == advanced_orders_.end())
+        if (symbol_id >= advanced_orders_.size())
             return;
 
-        auto &orders = it->second;
-        for (auto order_it = orders.begin(); order_it != orders.end();)
+        SymbolTriggers &triggers = advanced_orders_[symbol_id];
+        size_t first = fired.size();
+        take_crossed(triggers.rising, current_price, fired);
+        take_crossed(triggers.falling, current_price, fired);
+        check_trailing(triggers.trailing[0], current_price, fired);
+        check_trailing(triggers.trailing[1], current_price, fired);
+
+        for (size_t i = first; i < fired.size(); ++i)
         {
-            AdvancedOrder &order = *order_it;
+            LOG_INFO("Advanced order triggered: {} @ {}", fired[i].order_id, triggers.scale.to_price(current_price));
+        }
+    }
 
-            if (order.triggered)
-            {
-                ++order_it;
-                continue;
-            }
+    // Everything in book order up to the current price has been crossed;
+    // the first order short of it ends the walk.
+    void AdvancedOrderManager::take_crossed(TriggerBook &book, Price current_price,
+                                            std::vector<AdvancedOrder> &fired)
+    {
+        auto crossed_end = book.upper_bound(current_price);
+        for (auto it = book.begin(); it != crossed_end; ++it)
+        {
+            order_index_.erase(it->second.order_id);
+            fired.push_back(std::move(it->second));
+        }
+        book.erase(book.begin(), crossed_end);
+    }
 
-            bool should_trigger = false;
+    uint64_t AdvancedOrderManager::add_trailing(SymbolTriggers &triggers, AdvancedOrder &&order)
+    {
+        TrailingStopBook &book = triggers.trailing[static_cast<size_t>(order.side)];
+        uint64_t slot;
+        if (free_trailing_slots_.empty())
+        {
+            slot = trailing_slots_.size();
+            trailing_slots_.push_back(TrailingSlot{std::move(order), 0});
+        }
+        else
+        {
+            slot = free_trailing_slots_.back();
+            free_trailing_slots_.pop_back();
+            trailing_slots_[slot].order = std::move(order);
+        }
 
-            switch (order.advanced_type)
-            {
-            case AdvancedOrderType::STOP_LOSS:
-                if (order.side == OrderSide::BUY)
-                {
-                    should_trigger = current_price >= order.trigger_price;
-                }
-                else
-                {
-                    should_trigger = current_price <= order.trigger_price;
-                }
-                break;
+        const AdvancedOrder &stored = trailing_slots_[slot].order;
+        trailing_slots_[slot].row = book.add(stored.trigger_price, stored.trailing_distance, slot);
+        return slot;
+    }
 
-            case AdvancedOrderType::STOP_LIMIT:
-                if (order.side == OrderSide::BUY)
-                {
-                    should_trigger = current_price >= order.trigger_price;
-                }
-                else
-                {
-                    should_trigger = current_price <= order.trigger_price;
-                }
-                break;
+    void AdvancedOrderManager::check_trailing(TrailingStopBook &book, Price current_price,
+                                              std::vector<AdvancedOrder> &fired)
+    {
+        if (book.empty())
+            return;
 
-            case AdvancedOrderType::TAKE_PROFIT:
-                if (order.side == OrderSide::BUY)
-                {
-                    should_trigger = current_price <= order.trigger_price;
-                }
-                else
-                {
-                    should_trigger = current_price >= order.trigger_price;
-                }
-                break;
+        fired_rows_.clear();
+        book.update(current_price, fired_rows_);
 
-            case AdvancedOrderType::TRAILING_STOP:
-                if (order.side == OrderSide::BUY)
-                {
-                    double new_trigger = current_price - order.trailing_distance;
-                    if (new_trigger > order.trigger_price)
-                    {
-                        order.trigger_price = new_trigger;
-                    }
-                    should_trigger = current_price <= order.trigger_price;
-                }
-                else
-                {
-                    double new_trigger = current_price + order.trailing_distance;
-                    if (new_trigger < order.trigger_price)
-                    {
-                        order.trigger_price = new_trigger;
-                    }
-                    should_trigger = current_price >= order.trigger_price;
-                }
-                break;
-            }
+        // Highest row first, so the swap-in on removal only ever moves a
+        // row that did not fire.
+        for (auto row = fired_rows_.rbegin(); row != fired_rows_.rend(); ++row)
+        {
+            uint64_t slot = book.handle(*row);
+            AdvancedOrder &order = trailing_slots_[slot].order;
+            order.trigger_price = book.trigger(*row);
+            order_index_.erase(order.order_id);
+            fired.push_back(std::move(order));
+            remove_trailing(book, slot);
+        }
+    }
 
-            if (should_trigger)
-            {
-                trigger_order(order, current_price);
-                order_it = orders.erase(order_it);
-            }
-            else
-            {
-                ++order_it;
-            }
+    void AdvancedOrderManager::remove_trailing(TrailingStopBook &book, uint64_t slot)
+    {
+        size_t row = trailing_slots_[slot].row;
+        book.remove(row);
+        if (row < book.size())
+        {
+            trailing_slots_[book.handle(row)].row = row;
         }
+        free_trailing_slots_.push_back(slot);
     }
 
-    void AdvancedOrderManager::cancel_advanced_order(const std::string &order_id)
+    bool AdvancedOrderManager::cancel_advanced_order(const std::string &order_id)
     {
         std::lock_guard<std::mutex> lock(orders_mutex_);
 
-        for (auto &[symbol, orders] : advanced_orders_)
+        auto it = order_index_.find(order_id);
+        if (it == order_index_.end())
+            return false;
+
+        OrderLocation location = it->second;
+        order_index_.erase(it);
+
+        SymbolTriggers &triggers = advanced_orders_[location.symbol_id];
+        switch (location.direction)
         {
-            for (auto it = orders.begin(); it != orders.end(); ++it)
-            {
-                if (it->order_id == order_id)
-                {
-                    orders.erase(it);
-                    std::cout << "Cancelled advanced order: " << order_id << std::endl;
-                    return;
-                }
-            }
+        case TriggerDirection::RISING:
+            triggers.rising.erase(location.entry);
+            break;
+        case TriggerDirection::FALLING:
+            triggers.falling.erase(location.entry);
+            break;
+        case TriggerDirection::TRAILING:
+            remove_trailing(triggers.trailing[static_cast<size_t>(trailing_slots_[location.trailing_slot].order.side)],
+                            location.trailing_slot);
+            break;
         }
+
+        LOG_INFO("Cancelled advanced order: {}", order_id);
+        return true;
     }
 
-    void AdvancedOrderManager::trigger_order(const AdvancedOrder &advanced_order, double current_price)
+    size_t AdvancedOrderManager::get_order_count() const
     {
-        if (!order_callback_)
-            return;
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        return order_index_.size();
+    }
 
+    Order AdvancedOrderManager::to_order(const AdvancedOrder &advanced_order) const
+    {
         uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
                                  std::chrono::system_clock::now().time_since_epoch())
                                  .count();
@@ -197,11 +292,8 @@ namespace GoQuant
         Order order(advanced_order.order_id, advanced_order.symbol,
                     advanced_order.order_type, advanced_order.side,
                     advanced_order.quantity, advanced_order.price, timestamp);
-
-        std::cout << "Advanced order triggered: " << advanced_order.order_id
-                  << " @ " << current_price << std::endl;
-
-        order_callback_(order);
+        order.symbol_id = advanced_order.symbol_id;
+        return order;
     }
 
     std::string AdvancedOrderManager::generate_order_id()
@@ -1,72 +1,589 @@
 #include "core/matching_engine.hpp"
-#include <iostream>
+#include "config/config_manager.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
 
 namespace GoQuant {
 
-MatchingEngine::MatchingEngine() : fee_calculator_(FeeStructure(0.001, 0.002)) {
+namespace {
+constexpr size_t NO_BATCH = static_cast<size_t>(-1);
+// Empty dispatcher passes before it sleeps until a shard publishes. The
+// wait is bounded only as a safety net; shards wake it.
+constexpr int POLLS_BEFORE_SLEEP = 64;
+constexpr std::chrono::milliseconds DISPATCH_IDLE_WAIT(100);
+}
+
+MatchingEngine::MatchingEngine()
+    : MatchingEngine(ConfigManager::get_instance().get_engine_config().matching_threads) {}
+
+MatchingEngine::MatchingEngine(size_t matching_threads)
+    : advanced_order_manager_(symbols_), fee_calculator_(FeeStructure(0.001, 0.002)),
+      trigger_cascade_depth_(std::max(1, ConfigManager::get_instance().get_engine_config().trigger_cascade_depth)) {
+    create_shards(matching_threads);
+    
     add_symbol("BTC-USDT");
     add_symbol("ETH-USDT");
+}
+
+MatchingEngine::~MatchingEngine() {
+    for (auto& shard : shards_) {
+        shard->stop();
+    }
+    dispatching_ = false;
+    dispatch_signal_.notify();
+    if (dispatcher_thread_.joinable()) {
+        dispatcher_thread_.join();
+    }
+    dispatch_events();
+}
+
+void MatchingEngine::create_shards(size_t matching_threads) {
+    if (matching_threads == 0) {
+        return;
+    }
+    
+    EngineConfig config = ConfigManager::get_instance().get_engine_config();
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
     
-    advanced_order_manager_.set_order_callback([this](const Order& order) {
-        this->submit_order(order);
-    });
+    for (size_t i = 0; i < matching_threads; ++i) {
+        // Leave CPU 0 to the OS and the gateway threads.
+        int cpu = config.pin_matching_threads ? static_cast<int>((i + 1) % cpus) : -1;
+        shards_.push_back(std::make_unique<MatchingShard>(
+            i, config.matching_queue_size, cpu,
+            std::make_unique<TriggerCascade>(advanced_order_manager_, next_handle_, trigger_cascade_depth_),
+            &dispatch_signal_));
+    }
+    dispatch_counts_.assign(shards_.size(), 0);
 }
 
-bool MatchingEngine::submit_order(Order order) {
-    std::lock_guard<std::mutex> lock(engine_mutex_);
+void MatchingEngine::start() {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    if (shards_.empty()) {
+        return;
+    }
     
-    auto book_it = order_books_.find(order.symbol);
-    if (book_it == order_books_.end()) {
-        std::cout << "Error: Symbol " << order.symbol << " not supported" << std::endl;
+    for (auto& shard : shards_) {
+        shard->start();
+    }
+    dispatching_ = true;
+    dispatcher_thread_ = std::thread(&MatchingEngine::dispatch_loop, this);
+    LOG_INFO("Matching engine running {} matching threads", shards_.size());
+}
+
+void MatchingEngine::set_trade_callback(std::function<void(const Trade&)> callback) {
+    if (started_) {
+        LOG_ERROR("Trade callback must be set before the matching engine starts");
+        return;
+    }
+    trade_callback_ = std::move(callback);
+}
+
+void MatchingEngine::set_trade_batch_callback(std::function<void(const std::vector<Trade>&)> callback) {
+    if (started_) {
+        LOG_ERROR("Trade batch callback must be set before the matching engine starts");
+        return;
+    }
+    trade_batch_callback_ = std::move(callback);
+}
+
+void MatchingEngine::set_order_event_callback(std::function<void(const EngineEvent&)> callback) {
+    if (started_) {
+        LOG_ERROR("Order event callback must be set before the matching engine starts");
+        return;
+    }
+    order_event_callback_ = std::move(callback);
+}
+
+SymbolId MatchingEngine::resolve_symbol(const Order& order) const {
+    return order.symbol_id != INVALID_SYMBOL_ID ? order.symbol_id : symbols_.find(order.symbol);
+}
+
+bool MatchingEngine::find_entry(SymbolId symbol_id, BookEntry& entry) const {
+    std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+    if (symbol_id >= books_.size()) {
         return false;
     }
+    entry = books_[symbol_id];
+    return true;
+}
+
+OrderHandle MatchingEngine::submit_order(Order order) {
+    order.symbol_id = resolve_symbol(order);
+    BookEntry entry;
+    if (!find_entry(order.symbol_id, entry)) {
+        LOG_WARN("Symbol {} not supported", order.symbol);
+        return INVALID_ORDER_HANDLE;
+    }
     
-    book_it->second->set_trade_callback([this](const Trade& trade) {
-        on_trade_executed(trade);
-    });
+    order.handle = next_handle_++;
     
     throughput_counter_.increment();
     orders_processed_++;
     
+    if (entry.shard) {
+        OrderHandle handle = order.handle;
+        EngineCommand command;
+        command.type = EngineCommand::Type::SUBMIT;
+        command.book = entry.book.get();
+        command.order = std::move(order);
+        if (!entry.shard->enqueue(std::move(command))) {
+            LOG_WARN("Matching queue full for {}", entry.book->get_symbol());
+            return INVALID_ORDER_HANDLE;
+        }
+        return handle;
+    }
+    
     std::vector<Trade> trades;
-    bool success = book_it->second->add_order(order, trades);
+    bool success = entry.book->add_order(order, trades);
+    if (!trades.empty()) {
+        cascade_triggers(*entry.book, trades.back().price, trades);
+    }
     
     for (const auto& trade : trades) {
-        std::cout << "EXECUTED: " << trade.symbol << " " << trade.quantity 
-                  << " @ " << trade.price << " (" << trade.aggressor_side << ")" << std::endl;
-        on_trade_executed(trade);
+        report_trade(*entry.book, trade);
+    }
+    on_trades_executed(trades);
+    if (success && !order.rests()) {
+        report_closed(order.symbol_id, order.handle);
+    }
+    
+    return success ? order.handle : INVALID_ORDER_HANDLE;
+}
+
+std::vector<OrderHandle> MatchingEngine::submit_orders(std::vector<Order> orders) {
+    struct BookBatch {
+        BookEntry entry;
+        std::vector<Order> orders;
+        std::vector<size_t> positions;
+    };
+    
+    std::vector<OrderHandle> handles(orders.size(), INVALID_ORDER_HANDLE);
+    std::vector<BookBatch> batches;
+    std::vector<size_t> batch_of;
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+        batch_of.assign(books_.size(), NO_BATCH);
+        for (size_t i = 0; i < orders.size(); ++i) {
+            SymbolId symbol_id = resolve_symbol(orders[i]);
+            if (symbol_id >= books_.size()) {
+                LOG_WARN("Symbol {} not supported", orders[i].symbol);
+                continue;
+            }
+            
+            size_t& slot = batch_of[symbol_id];
+            if (slot == NO_BATCH) {
+                slot = batches.size();
+                batches.push_back(BookBatch{books_[symbol_id], {}, {}});
+            }
+            BookBatch& batch = batches[slot];
+            
+            orders[i].symbol_id = symbol_id;
+            orders[i].handle = next_handle_++;
+            handles[i] = orders[i].handle;
+            batch.orders.push_back(std::move(orders[i]));
+            batch.positions.push_back(i);
+        }
+    }
+    
+    throughput_counter_.increment(orders.size());
+    orders_processed_ += orders.size();
+    
+    std::vector<Trade> trades;
+    std::vector<bool> accepted;
+    for (BookBatch& batch : batches) {
+        if (batch.entry.shard) {
+            EngineCommand command;
+            command.type = EngineCommand::Type::SUBMIT_BATCH;
+            command.book = batch.entry.book.get();
+            command.orders = std::move(batch.orders);
+            if (!batch.entry.shard->enqueue(std::move(command))) {
+                LOG_WARN("Matching queue full for {}", batch.entry.book->get_symbol());
+                for (size_t pos : batch.positions) {
+                    handles[pos] = INVALID_ORDER_HANDLE;
+                }
+            }
+            continue;
+        }
+        
+        size_t first_trade = trades.size();
+        batch.entry.book->add_orders(batch.orders, trades, accepted);
+        for (size_t i = 0; i < accepted.size(); ++i) {
+            if (!accepted[i]) {
+                handles[batch.positions[i]] = INVALID_ORDER_HANDLE;
+            }
+        }
+        if (trades.size() > first_trade) {
+            cascade_triggers(*batch.entry.book, trades.back().price, trades);
+        }
+        for (size_t i = first_trade; i < trades.size(); ++i) {
+            report_trade(*batch.entry.book, trades[i]);
+        }
+        for (size_t i = 0; i < accepted.size(); ++i) {
+            if (accepted[i] && !batch.orders[i].rests()) {
+                report_closed(batch.orders[i].symbol_id, batch.orders[i].handle);
+            }
+        }
     }
+    on_trades_executed(trades);
     
-    return success;
+    return handles;
 }
 
-bool MatchingEngine::cancel_order(const std::string& symbol, const std::string& order_id) {
-    std::lock_guard<std::mutex> lock(engine_mutex_);
+std::vector<bool> MatchingEngine::cancel_orders(const std::vector<std::pair<SymbolId, OrderHandle>>& cancels) {
+    struct BookBatch {
+        BookEntry entry;
+        std::vector<OrderHandle> handles;
+        std::vector<size_t> positions;
+    };
     
-    auto book_it = order_books_.find(symbol);
-    if (book_it == order_books_.end()) {
+    std::vector<bool> results(cancels.size(), false);
+    std::vector<BookBatch> batches;
+    std::vector<size_t> batch_of;
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+        batch_of.assign(books_.size(), NO_BATCH);
+        for (size_t i = 0; i < cancels.size(); ++i) {
+            SymbolId symbol_id = cancels[i].first;
+            if (symbol_id >= books_.size()) {
+                continue;
+            }
+            
+            size_t& slot = batch_of[symbol_id];
+            if (slot == NO_BATCH) {
+                slot = batches.size();
+                batches.push_back(BookBatch{books_[symbol_id], {}, {}});
+            }
+            batches[slot].handles.push_back(cancels[i].second);
+            batches[slot].positions.push_back(i);
+        }
+    }
+    
+    std::vector<bool> cancelled;
+    for (BookBatch& batch : batches) {
+        if (batch.entry.shard) {
+            EngineCommand command;
+            command.type = EngineCommand::Type::CANCEL_BATCH;
+            command.book = batch.entry.book.get();
+            command.handles = std::move(batch.handles);
+            bool queued = batch.entry.shard->enqueue(std::move(command));
+            for (size_t pos : batch.positions) {
+                results[pos] = queued;
+            }
+            continue;
+        }
+        
+        batch.entry.book->cancel_orders(batch.handles, cancelled);
+        for (size_t i = 0; i < cancelled.size(); ++i) {
+            results[batch.positions[i]] = cancelled[i];
+            if (cancelled[i]) {
+                report_closed(batch.entry.book->get_symbol_id(), batch.handles[i]);
+            }
+        }
+    }
+    
+    return results;
+}
+
+bool MatchingEngine::cancel_order(const std::string& symbol, OrderHandle handle) {
+    return cancel_order(symbols_.find(symbol), handle);
+}
+
+bool MatchingEngine::cancel_order(SymbolId symbol_id, OrderHandle handle) {
+    BookEntry entry;
+    if (!find_entry(symbol_id, entry)) {
+        return false;
+    }
+    
+    if (entry.shard) {
+        EngineCommand command;
+        command.type = EngineCommand::Type::CANCEL;
+        command.book = entry.book.get();
+        command.handle = handle;
+        return entry.shard->enqueue(std::move(command));
+    }
+    
+    if (!entry.book->cancel_order(handle)) {
+        return false;
+    }
+    report_closed(symbol_id, handle);
+    return true;
+}
+
+bool MatchingEngine::amend_order(SymbolId symbol_id, OrderHandle handle, Price new_price, Quantity new_quantity) {
+    BookEntry entry;
+    if (!find_entry(symbol_id, entry)) {
         return false;
     }
     
-    return book_it->second->cancel_order(order_id);
+    if (entry.shard) {
+        EngineCommand command;
+        command.type = EngineCommand::Type::AMEND;
+        command.book = entry.book.get();
+        command.handle = handle;
+        command.price = new_price;
+        command.quantity = new_quantity;
+        return entry.shard->enqueue(std::move(command));
+    }
+    
+    std::vector<Trade> trades;
+    bool amended = entry.book->amend_order(handle, new_price, new_quantity, trades);
+    if (!trades.empty()) {
+        cascade_triggers(*entry.book, trades.back().price, trades);
+    }
+    
+    for (const auto& trade : trades) {
+        report_trade(*entry.book, trade);
+    }
+    on_trades_executed(trades);
+    if (amended && !entry.book->has_order(handle)) {
+        report_closed(symbol_id, handle);
+    }
+    
+    return amended;
+}
+
+bool MatchingEngine::cancel_session_orders(SessionId session, SymbolId symbol_id, std::optional<OrderSide> side) {
+    std::vector<BookEntry> entries;
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+        if (symbol_id == INVALID_SYMBOL_ID) {
+            entries = books_;
+        } else if (symbol_id < books_.size()) {
+            entries.push_back(books_[symbol_id]);
+        } else {
+            return false;
+        }
+    }
+    
+    std::vector<OrderHandle> closed;
+    for (const BookEntry& entry : entries) {
+        if (entry.shard) {
+            EngineCommand command;
+            command.type = EngineCommand::Type::MASS_CANCEL;
+            command.book = entry.book.get();
+            command.session = session;
+            command.side = side;
+            entry.shard->enqueue_or_park(std::move(command));
+            continue;
+        }
+        
+        closed.clear();
+        entry.book->cancel_session_orders(session, side, order_event_callback_ ? &closed : nullptr);
+        for (OrderHandle handle : closed) {
+            report_closed(entry.book->get_symbol_id(), handle);
+        }
+    }
+    
+    return true;
+}
+
+void MatchingEngine::expire_orders(uint64_t now_ms) {
+    std::vector<BookEntry> entries;
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+        entries = books_;
+    }
+    
+    std::vector<OrderHandle> closed;
+    for (const BookEntry& entry : entries) {
+        if (entry.shard) {
+            EngineCommand command;
+            command.type = EngineCommand::Type::EXPIRE;
+            command.book = entry.book.get();
+            command.now_ms = now_ms;
+            if (!entry.shard->enqueue(std::move(command))) {
+                LOG_WARN("Matching queue full for {}; expiry deferred", entry.book->get_symbol());
+            }
+            continue;
+        }
+        
+        closed.clear();
+        size_t expired = entry.book->expire_orders(now_ms, order_event_callback_ ? &closed : nullptr);
+        if (expired > 0) {
+            LOG_INFO("EXPIRED: {} orders on {}", expired, entry.book->get_symbol());
+        }
+        for (OrderHandle handle : closed) {
+            report_closed(entry.book->get_symbol_id(), handle);
+        }
+    }
+}
+
+void MatchingEngine::wait_until_idle() const {
+    for (const auto& shard : shards_) {
+        while (!shard->idle()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Polls while events keep coming, then yields for a few empty passes and
+// finally sleeps until a shard signals that it published something.
+void MatchingEngine::dispatch_loop() {
+    int empty_polls = 0;
+    while (dispatching_.load(std::memory_order_relaxed)) {
+        if (dispatch_events()) {
+            empty_polls = 0;
+        } else if (++empty_polls < POLLS_BEFORE_SLEEP) {
+            std::this_thread::yield();
+        } else {
+            dispatch_signal_.wait_for(DISPATCH_IDLE_WAIT, [this] {
+                return !dispatching_.load(std::memory_order_relaxed) || events_pending();
+            });
+            empty_polls = 0;
+        }
+    }
+}
+
+bool MatchingEngine::events_pending() const {
+    for (const auto& shard : shards_) {
+        if (shard->has_pending_events()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MatchingEngine::dispatch_events() {
+    std::vector<uint64_t>& polled = dispatch_counts_;
+    std::fill(polled.begin(), polled.end(), 0);
+    EngineEvent event;
+    dispatched_trades_.clear();
+    
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        while (shards_[i]->poll_event(event)) {
+            ++polled[i];
+            switch (event.type) {
+            case EngineEvent::Type::TRADE:
+                if (auto book = get_order_book(event.symbol_id)) {
+                    report_trade(*book, event.trade);
+                }
+                dispatched_trades_.push_back(event.trade);
+                break;
+            case EngineEvent::Type::ORDER_REJECTED:
+                LOG_INFO("REJECTED: order handle {}", event.handle);
+                on_order_event(event);
+                break;
+            case EngineEvent::Type::CANCEL_REJECTED:
+                LOG_INFO("CANCEL REJECTED: order handle {}", event.handle);
+                on_order_event(event);
+                break;
+            case EngineEvent::Type::AMEND_REJECTED:
+                LOG_INFO("AMEND REJECTED: order handle {}", event.handle);
+                on_order_event(event);
+                break;
+            case EngineEvent::Type::ORDER_CLOSED:
+                on_order_event(event);
+                break;
+            }
+        }
+    }
+    on_trades_executed(dispatched_trades_);
+    
+    bool any = false;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (polled[i] > 0) {
+            shards_[i]->acknowledge_events(polled[i]);
+            any = true;
+        }
+    }
+    return any;
+}
+
+// Inline counterpart of the shard's cascade. Inline callers may match
+// concurrently, so each call gets its own queue.
+void MatchingEngine::cascade_triggers(OrderBook& book, Price price, std::vector<Trade>& trades) {
+    TriggerCascade cascade(advanced_order_manager_, next_handle_, trigger_cascade_depth_);
+    cascade.run(book, price, trades);
+}
+
+void MatchingEngine::report_trade(const OrderBook& book, const Trade& trade) {
+    const PriceScale& scale = book.get_scale();
+    LOG_INFO("EXECUTED: {} {} @ {} ({})", book.get_symbol(), scale.to_quantity(trade.quantity),
+             scale.to_price(trade.price), trade.is_buyer_maker ? "SELL" : "BUY");
+    on_trade_executed(trade);
 }
 
 std::shared_ptr<OrderBook> MatchingEngine::get_order_book(const std::string& symbol) {
-    std::lock_guard<std::mutex> lock(engine_mutex_);
-    auto it = order_books_.find(symbol);
-    return (it != order_books_.end()) ? it->second : nullptr;
+    return get_order_book(symbols_.find(symbol));
+}
+
+std::shared_ptr<OrderBook> MatchingEngine::get_order_book(SymbolId symbol_id) {
+    std::shared_lock<std::shared_mutex> lock(engine_mutex_);
+    return symbol_id < books_.size() ? books_[symbol_id].book : nullptr;
+}
+
+// Ids are only interned here, under the engine lock, so a symbol's id is
+// always its index in books_.
+SymbolId MatchingEngine::add_symbol(const std::string& symbol) {
+    std::unique_lock<std::shared_mutex> lock(engine_mutex_);
+    SymbolId symbol_id = symbols_.intern(symbol);
+    if (symbol_id < books_.size()) {
+        return symbol_id;
+    }
+    
+    SymbolConfig config = ConfigManager::get_instance().get_symbol_config(symbol);
+    EngineConfig engine_config = ConfigManager::get_instance().get_engine_config();
+    BookEntry entry;
+    entry.book = std::make_shared<OrderBook>(
+        symbol, config.get_price_scale(), parse_ladder_type(config.book_type),
+        engine_config.order_pool_size, engine_config.level_pool_size, symbol_id);
+    if (!shards_.empty()) {
+        entry.shard = shards_[symbol_id % shards_.size()].get();
+    }
+    books_.push_back(entry);
+    advanced_order_manager_.add_symbol(symbol_id, entry.book->get_scale());
+    if (book_listener_) {
+        book_listener_(*entry.book);
+    }
+    
+    if (entry.shard) {
+        LOG_INFO("Added symbol: {} (matching thread {})", symbol, entry.shard->get_id());
+    } else {
+        LOG_INFO("Added symbol: {}", symbol);
+    }
+    return symbol_id;
 }
 
-void MatchingEngine::add_symbol(const std::string& symbol) {
-    std::lock_guard<std::mutex> lock(engine_mutex_);
-    if (order_books_.find(symbol) == order_books_.end()) {
-        order_books_[symbol] = std::make_shared<OrderBook>(symbol);
-        std::cout << "Added symbol: " << symbol << std::endl;
+void MatchingEngine::set_book_listener(std::function<void(OrderBook&)> listener) {
+    std::unique_lock<std::shared_mutex> lock(engine_mutex_);
+    book_listener_ = std::move(listener);
+    if (book_listener_) {
+        for (const BookEntry& entry : books_) {
+            book_listener_(*entry.book);
+        }
+    }
+}
+
+void MatchingEngine::update_market_price(SymbolId symbol_id, Price price) {
+    BookEntry entry;
+    if (!find_entry(symbol_id, entry)) {
+        return;
+    }
+    
+    if (entry.shard) {
+        EngineCommand command;
+        command.type = EngineCommand::Type::TRIGGER;
+        command.book = entry.book.get();
+        command.price = price;
+        if (!entry.shard->enqueue(std::move(command))) {
+            LOG_WARN("Matching queue full for {}; trigger check skipped", entry.book->get_symbol());
+        }
+        return;
+    }
+    
+    std::vector<Trade> trades;
+    cascade_triggers(*entry.book, price, trades);
+    for (const auto& trade : trades) {
+        report_trade(*entry.book, trade);
     }
+    on_trades_executed(trades);
 }
 
-void MatchingEngine::update_market_price(const std::string& symbol, double price) {
-    advanced_order_manager_.check_triggers(symbol, price);
+void MatchingEngine::update_market_price(const std::string& symbol, Price price) {
+    update_market_price(symbols_.find(symbol), price);
 }
 
 double MatchingEngine::get_throughput_ops() const {
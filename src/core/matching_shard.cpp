@@ -0,0 +1,288 @@
+#include "core/matching_shard.hpp"
+#include "utils/logger.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace GoQuant {
+
+namespace {
+constexpr int SPIN_BEFORE_YIELD = 1024;
+}
+
+MatchingShard::MatchingShard(size_t id, size_t queue_size, int cpu, std::unique_ptr<TriggerCascade> cascade,
+                             EventSignal* events_ready)
+    : id_(id), cpu_(cpu), inbound_(queue_size), outbound_(queue_size), cascade_(std::move(cascade)),
+      events_ready_(events_ready) {
+    trades_.reserve(64);
+}
+
+MatchingShard::~MatchingShard() {
+    stop();
+}
+
+void MatchingShard::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&MatchingShard::run, this);
+}
+
+void MatchingShard::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool MatchingShard::enqueue(EngineCommand&& command) {
+    // Count first so the shard never sees more completions than enqueues.
+    enqueued_.fetch_add(1, std::memory_order_acq_rel);
+    if (!inbound_.try_push(std::move(command))) {
+        enqueued_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+    return true;
+}
+
+void MatchingShard::enqueue_or_park(EngineCommand&& command) {
+    enqueued_.fetch_add(1, std::memory_order_acq_rel);
+    if (inbound_.try_push(std::move(command))) {
+        return;
+    }
+    
+    LOG_WARN("Matching shard {}: queue full, parking command", id_);
+    std::lock_guard<std::mutex> lock(parked_mutex_);
+    parked_.emplace_back(inbound_.claimed(), std::move(command));
+    parked_count_.store(parked_.size(), std::memory_order_release);
+}
+
+bool MatchingShard::poll_event(EngineEvent& event) {
+    return outbound_.try_pop(event);
+}
+
+void MatchingShard::acknowledge_events(uint64_t count) {
+    events_consumed_.fetch_add(count, std::memory_order_release);
+}
+
+bool MatchingShard::has_pending_events() const {
+    return events_consumed_.load(std::memory_order_acquire) != events_published_.load(std::memory_order_acquire);
+}
+
+bool MatchingShard::idle() const {
+    return completed_.load(std::memory_order_acquire) == enqueued_.load(std::memory_order_acquire) &&
+           events_consumed_.load(std::memory_order_acquire) == events_published_.load(std::memory_order_acquire);
+}
+
+void MatchingShard::run() {
+    pin_to_cpu();
+
+    EngineCommand command;
+    int idle_spins = 0;
+    // Keep draining after stop() until every accepted command has run.
+    while (running_.load(std::memory_order_relaxed) ||
+           completed_.load(std::memory_order_relaxed) != enqueued_.load(std::memory_order_acquire)) {
+        if (parked_count_.load(std::memory_order_acquire) != 0 && run_parked()) {
+            idle_spins = 0;
+        } else if (inbound_.try_pop(command)) {
+            process(command);
+            idle_spins = 0;
+        } else if (++idle_spins > SPIN_BEFORE_YIELD) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Runs the parked commands whose ring position has been reached; returns
+// whether any ran.
+bool MatchingShard::run_parked() {
+    unparked_.clear();
+    {
+        std::lock_guard<std::mutex> lock(parked_mutex_);
+        size_t position = inbound_.consumed();
+        size_t kept = 0;
+        for (size_t i = 0; i < parked_.size(); ++i) {
+            if (parked_[i].first <= position) {
+                unparked_.push_back(std::move(parked_[i].second));
+            } else {
+                if (kept != i) {
+                    parked_[kept] = std::move(parked_[i]);
+                }
+                ++kept;
+            }
+        }
+        parked_.resize(kept);
+        parked_count_.store(kept, std::memory_order_release);
+    }
+    
+    for (EngineCommand& command : unparked_) {
+        process(command);
+    }
+    return !unparked_.empty();
+}
+
+void MatchingShard::process(EngineCommand& command) {
+    uint64_t published = events_published_.load(std::memory_order_relaxed);
+    execute(command);
+    completed_.fetch_add(1, std::memory_order_release);
+    if (events_ready_ && events_published_.load(std::memory_order_relaxed) != published) {
+        events_ready_->notify();
+    }
+}
+
+void MatchingShard::execute(EngineCommand& command) {
+    OrderBook& book = *command.book;
+
+    switch (command.type) {
+    case EngineCommand::Type::SUBMIT: {
+        trades_.clear();
+        bool accepted = book.add_order(command.order, trades_);
+        publish_trades(command.order.handle);
+        if (!accepted) {
+            publish_rejection(EngineEvent::Type::ORDER_REJECTED, command.order.handle, book.get_symbol_id());
+        } else if (!command.order.rests()) {
+            publish_closed(command.order.handle, book.get_symbol_id());
+        }
+        if (!trades_.empty()) {
+            run_cascade(book, trades_.back().price);
+        }
+        break;
+    }
+    case EngineCommand::Type::CANCEL:
+        if (book.cancel_order(command.handle)) {
+            publish_closed(command.handle, book.get_symbol_id());
+        } else {
+            publish_rejection(EngineEvent::Type::CANCEL_REJECTED, command.handle, book.get_symbol_id());
+        }
+        break;
+    case EngineCommand::Type::AMEND: {
+        trades_.clear();
+        bool amended = book.amend_order(command.handle, command.price, command.quantity, trades_);
+        publish_trades(command.handle);
+        if (!amended) {
+            publish_rejection(EngineEvent::Type::AMEND_REJECTED, command.handle, book.get_symbol_id());
+        } else if (!book.has_order(command.handle)) {
+            publish_closed(command.handle, book.get_symbol_id());
+        }
+        if (!trades_.empty()) {
+            run_cascade(book, trades_.back().price);
+        }
+        break;
+    }
+    case EngineCommand::Type::MASS_CANCEL:
+        closed_.clear();
+        book.cancel_session_orders(command.session, command.side, &closed_);
+        for (OrderHandle handle : closed_) {
+            publish_closed(handle, book.get_symbol_id());
+        }
+        break;
+    case EngineCommand::Type::EXPIRE: {
+        closed_.clear();
+        size_t expired = book.expire_orders(command.now_ms, &closed_);
+        if (expired > 0) {
+            LOG_INFO("EXPIRED: {} orders on {}", expired, book.get_symbol());
+        }
+        for (OrderHandle handle : closed_) {
+            publish_closed(handle, book.get_symbol_id());
+        }
+        break;
+    }
+    case EngineCommand::Type::TRIGGER:
+        run_cascade(book, command.price);
+        break;
+    case EngineCommand::Type::SUBMIT_BATCH:
+        trades_.clear();
+        book.add_orders(command.orders, trades_, results_);
+        publish_trades(INVALID_ORDER_HANDLE);
+        for (size_t i = 0; i < command.orders.size(); ++i) {
+            if (!results_[i]) {
+                publish_rejection(EngineEvent::Type::ORDER_REJECTED, command.orders[i].handle, book.get_symbol_id());
+            } else if (!command.orders[i].rests()) {
+                publish_closed(command.orders[i].handle, book.get_symbol_id());
+            }
+        }
+        if (!trades_.empty()) {
+            run_cascade(book, trades_.back().price);
+        }
+        break;
+    case EngineCommand::Type::CANCEL_BATCH:
+        book.cancel_orders(command.handles, results_);
+        for (size_t i = 0; i < command.handles.size(); ++i) {
+            if (results_[i]) {
+                publish_closed(command.handles[i], book.get_symbol_id());
+            } else {
+                publish_rejection(EngineEvent::Type::CANCEL_REJECTED, command.handles[i], book.get_symbol_id());
+            }
+        }
+        break;
+    }
+}
+
+void MatchingShard::publish_trades(OrderHandle handle) {
+    for (const Trade& trade : trades_) {
+        EngineEvent event;
+        event.type = EngineEvent::Type::TRADE;
+        event.handle = handle;
+        event.symbol_id = trade.symbol_id;
+        event.trade = trade;
+        publish(std::move(event));
+    }
+}
+
+// Trades from triggered orders carry no command handle; their takers are
+// identified by the trade itself.
+void MatchingShard::run_cascade(OrderBook& book, Price price) {
+    if (!cascade_) {
+        return;
+    }
+    trades_.clear();
+    cascade_->run(book, price, trades_);
+    publish_trades(INVALID_ORDER_HANDLE);
+}
+
+void MatchingShard::publish_rejection(EngineEvent::Type type, OrderHandle handle, SymbolId symbol_id) {
+    EngineEvent event;
+    event.type = type;
+    event.handle = handle;
+    event.symbol_id = symbol_id;
+    publish(std::move(event));
+}
+
+void MatchingShard::publish_closed(OrderHandle handle, SymbolId symbol_id) {
+    EngineEvent event;
+    event.type = EngineEvent::Type::ORDER_CLOSED;
+    event.handle = handle;
+    event.symbol_id = symbol_id;
+    publish(std::move(event));
+}
+
+// Trades must never be dropped, so a full outbound ring stalls matching
+// until the dispatcher catches up. The dispatcher may be asleep with one
+// command's events still unannounced, so wake it before waiting.
+void MatchingShard::publish(EngineEvent&& event) {
+    events_published_.fetch_add(1, std::memory_order_relaxed);
+    while (!outbound_.try_push(std::move(event))) {
+        if (events_ready_) {
+            events_ready_->notify();
+        }
+        std::this_thread::yield();
+    }
+}
+
+void MatchingShard::pin_to_cpu() {
+    if (cpu_ < 0) {
+        return;
+    }
+#if defined(__linux__)
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu_, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+        LOG_ERROR("Matching shard {}: failed to pin to CPU {}", id_, cpu_);
+    }
+#endif
+}
+
+}
@@ -1,186 +1,316 @@
 #include "core/order_book.hpp"
+#include "utils/logger.hpp"
 #include <algorithm>
-#include <iostream>
-#include <iomanip>
+#include <chrono>
 
 namespace GoQuant
 {
 
-    OrderBook::OrderBook(const std::string &symbol) : symbol_(symbol) {}
+    namespace
+    {
+        // Whether a taker limited to `limit` may trade against a level at `level_price`.
+        template <OrderSide Side>
+        struct SideTraits;
+
+        template <>
+        struct SideTraits<OrderSide::BUY>
+        {
+            static bool crosses(Price limit, Price level_price) { return limit >= level_price; }
+        };
+
+        template <>
+        struct SideTraits<OrderSide::SELL>
+        {
+            static bool crosses(Price limit, Price level_price) { return limit <= level_price; }
+        };
+
+        // What an order type does before, during and after the match loop.
+        template <OrderType Type>
+        struct OrderTypePolicy;
+
+        template <>
+        struct OrderTypePolicy<OrderType::MARKET>
+        {
+            static constexpr bool PRICE_LIMITED = false;
+            static constexpr bool RESTS = false;
+            static constexpr bool ALL_OR_NONE = false;
+        };
+
+        template <>
+        struct OrderTypePolicy<OrderType::LIMIT>
+        {
+            static constexpr bool PRICE_LIMITED = true;
+            static constexpr bool RESTS = true;
+            static constexpr bool ALL_OR_NONE = false;
+        };
+
+        template <>
+        struct OrderTypePolicy<OrderType::IOC>
+        {
+            static constexpr bool PRICE_LIMITED = true;
+            static constexpr bool RESTS = false;
+            static constexpr bool ALL_OR_NONE = false;
+        };
+
+        template <>
+        struct OrderTypePolicy<OrderType::FOK>
+        {
+            static constexpr bool PRICE_LIMITED = true;
+            static constexpr bool RESTS = false;
+            static constexpr bool ALL_OR_NONE = true;
+        };
+    }
+
+    OrderBook::OrderBook(const std::string &symbol, const PriceScale &scale, LadderType ladder_type,
+                         size_t order_pool_size, size_t level_pool_size, SymbolId symbol_id)
+        : symbol_(symbol), symbol_id_(symbol_id), scale_(scale), ladder_type_(ladder_type),
+          order_pool_(order_pool_size, order_pool_size),
+          details_pool_(order_pool_size, order_pool_size),
+          level_pool_(level_pool_size, level_pool_size),
+          bids_(PriceLadder::create(ladder_type, true, level_pool_)),
+          asks_(PriceLadder::create(ladder_type, false, level_pool_)),
+          order_lookup_(order_pool_size),
+          expiry_wheel_(std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count()),
+          next_trade_id_(1) {}
+
+    OrderBook::~OrderBook()
+    {
+        order_lookup_.for_each([this](OrderHandle, OrderNode *node)
+                               {
+            details_pool_.destroy(node->details);
+            order_pool_.destroy(node); });
+    }
+
+    bool OrderBook::add_order(Order &order, std::vector<Trade> &trades)
+    {
+        return add_order(order, [&trades](const Trade &trade)
+                         { trades.push_back(trade); });
+    }
 
     bool OrderBook::add_order(Order &order, TradeCallback trade_cb)
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
+        bool accepted = process_order(order, trade_cb);
+        publish_bbo();
+        return accepted;
+    }
+
+    void OrderBook::add_orders(std::vector<Order> &orders, std::vector<Trade> &trades,
+                               std::vector<bool> &accepted)
+    {
+        TradeCallback collect = [&trades](const Trade &trade)
+        { trades.push_back(trade); };
+
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        accepted.clear();
+        accepted.reserve(orders.size());
+        for (Order &order : orders)
+        {
+            accepted.push_back(process_order(order, collect));
+        }
+        publish_bbo();
+    }
+
+    bool OrderBook::process_order(Order &order, TradeCallback &trade_cb)
+    {
+        if (order.handle == INVALID_ORDER_HANDLE)
+        {
+            LOG_WARN("Rejected order {}: Missing order handle", order.order_id);
+            return false;
+        }
+
+        if (order_lookup_.find(order.handle))
+        {
+            LOG_WARN("Rejected order {}: Duplicate order handle {}", order.order_id, order.handle);
+            return false;
+        }
 
         if (order.quantity <= 0)
         {
-            std::cout << "Rejected order " << order.order_id << ": Invalid quantity" << std::endl;
+            LOG_WARN("Rejected order {}: Invalid quantity", order.order_id);
             return false;
         }
 
         if (order.type == OrderType::LIMIT && order.price <= 0)
         {
-            std::cout << "Rejected order " << order.order_id << ": Invalid price for limit order" << std::endl;
+            LOG_WARN("Rejected order {}: Invalid price for limit order", order.order_id);
             return false;
         }
 
-        std::cout << "Processing order: " << order.order_id
-                  << " " << (order.side == OrderSide::BUY ? "BUY" : "SELL")
-                  << " " << order.quantity << " @ "
-                  << (order.type == OrderType::MARKET ? "MARKET" : std::to_string(order.price))
-                  << std::endl;
+        LOG_DEBUG("Processing order {} {} {} {} @ {}", order.handle, symbol_,
+                  order.side == OrderSide::BUY ? "BUY" : "SELL",
+                  scale_.to_quantity(order.quantity), scale_.to_price(order.price));
 
         order.status = OrderStatus::ACTIVE;
-        match_order(order, trade_cb);
 
-        if (!order.is_fully_filled() && order.type == OrderType::LIMIT)
+        if (match_order(order, trade_cb))
         {
-            add_to_book(order);
-            std::cout << "Order resting in book: " << order.order_id
-                      << " Leaves: " << order.leaves_quantity << std::endl;
+            LOG_DEBUG("Order resting in book: {} Leaves: {}", order.handle, scale_.to_quantity(order.leaves_quantity));
         }
         else if (order.is_fully_filled())
         {
-            std::cout << "Order fully filled: " << order.order_id << std::endl;
+            LOG_DEBUG("Order fully filled: {}", order.handle);
         }
         else
         {
-            std::cout << "Order cancelled/expired: " << order.order_id << std::endl;
+            LOG_DEBUG("Order cancelled/expired: {}", order.handle);
         }
 
         return true;
     }
 
-    void OrderBook::match_order(Order &order, TradeCallback trade_cb)
+    bool OrderBook::match_order(Order &order, const TradeCallback &trade_cb)
     {
+        const bool buy = order.side == OrderSide::BUY;
+
         switch (order.type)
         {
         case OrderType::MARKET:
-            try_match_market_order(order, trade_cb);
-            break;
+            return buy ? match<OrderSide::BUY, OrderType::MARKET>(order, trade_cb)
+                       : match<OrderSide::SELL, OrderType::MARKET>(order, trade_cb);
         case OrderType::LIMIT:
-            try_match_limit_order(order, trade_cb);
-            break;
+            return buy ? match<OrderSide::BUY, OrderType::LIMIT>(order, trade_cb)
+                       : match<OrderSide::SELL, OrderType::LIMIT>(order, trade_cb);
         case OrderType::IOC:
-            try_match_ioc_order(order, trade_cb);
-            break;
+            return buy ? match<OrderSide::BUY, OrderType::IOC>(order, trade_cb)
+                       : match<OrderSide::SELL, OrderType::IOC>(order, trade_cb);
         case OrderType::FOK:
-            try_match_fok_order(order, trade_cb);
-            break;
+            return buy ? match<OrderSide::BUY, OrderType::FOK>(order, trade_cb)
+                       : match<OrderSide::SELL, OrderType::FOK>(order, trade_cb);
         }
+        return false;
     }
 
-    bool OrderBook::try_match_market_order(Order &order, TradeCallback trade_cb)
+    template <OrderSide Side, OrderType Type>
+    bool OrderBook::match(Order &order, const TradeCallback &trade_cb)
     {
-        auto &opposite_book = (order.side == OrderSide::BUY) ? asks_ : bids_;
+        using Policy = OrderTypePolicy<Type>;
+        PriceLadder &opposite = opposite_side<Side>();
 
-        while (!opposite_book.empty() && !order.is_fully_filled())
+        if constexpr (Policy::ALL_OR_NONE)
         {
-            auto best_level = opposite_book.begin();
-
-            while (!best_level->second.empty() && !order.is_fully_filled())
+            if (!can_fill_completely<Side>(order))
             {
-                Order &maker_order = best_level->second.front();
-                std::string maker_id = maker_order.order_id;
-
-                double fill_quantity = std::min(order.leaves_quantity, maker_order.leaves_quantity);
-                double fill_price = maker_order.price;
+                order.status = OrderStatus::REJECTED;
+                return false;
+            }
+        }
 
-                execute_trade(order, maker_order, fill_price, fill_quantity, trade_cb);
+        while (!order.is_fully_filled())
+        {
+            PriceLevel *level = opposite.best();
+            if (!level)
+                break;
 
-                if (maker_order.is_fully_filled())
-                {
-                    remove_from_book(maker_id);
+            if constexpr (Policy::PRICE_LIMITED)
+            {
+                if (!SideTraits<Side>::crosses(order.price, level->price))
                     break;
-                }
+            }
+
+            fill_level(order, *level, trade_cb);
+            if (level->empty())
+                opposite.erase(level->price);
+        }
+
+        if constexpr (Policy::RESTS)
+        {
+            if (!order.is_fully_filled())
+            {
+                add_to_book(order, same_side<Side>());
+                return true;
             }
         }
 
-        return order.is_fully_filled();
+        return false;
     }
 
-    bool OrderBook::try_match_limit_order(Order &order, TradeCallback trade_cb)
+    template <OrderSide Side>
+    bool OrderBook::can_fill_completely(const Order &order) const
     {
-        auto &opposite_book = (order.side == OrderSide::BUY) ? asks_ : bids_;
+        const PriceLadder &opposite = Side == OrderSide::BUY ? *asks_ : *bids_;
+        Quantity total_available = 0;
 
-        while (!opposite_book.empty() && !order.is_fully_filled())
+        for (PriceLevel *level = opposite.best(); level; level = opposite.next(level->price))
         {
-            auto best_level = opposite_book.begin();
-            double best_price = best_level->first;
-
-            bool can_match = (order.side == OrderSide::BUY && order.price >= best_price) ||
-                             (order.side == OrderSide::SELL && order.price <= best_price);
-
-            if (!can_match)
+            if (!SideTraits<Side>::crosses(order.price, level->price))
                 break;
 
-            while (!best_level->second.empty() && !order.is_fully_filled())
-            {
-                Order &maker_order = best_level->second.front();
-                std::string maker_id = maker_order.order_id;
-
-                double fill_quantity = std::min(order.leaves_quantity, maker_order.leaves_quantity);
-                double fill_price = maker_order.price;
-
-                execute_trade(order, maker_order, fill_price, fill_quantity, trade_cb);
-
-                if (maker_order.is_fully_filled())
-                {
-                    remove_from_book(maker_id);
-                    break;
-                }
-            }
+            total_available += level->total_quantity;
+            if (total_available >= order.leaves_quantity)
+                return true;
         }
 
-        return !order.is_fully_filled();
+        return false;
     }
 
-    bool OrderBook::try_match_ioc_order(Order &order, TradeCallback trade_cb)
+    template <OrderSide Side>
+    PriceLadder &OrderBook::same_side()
     {
-        try_match_limit_order(order, trade_cb);
-        return false;
+        if constexpr (Side == OrderSide::BUY)
+            return *bids_;
+        else
+            return *asks_;
     }
 
-    bool OrderBook::try_match_fok_order(Order &order, TradeCallback trade_cb)
+    template <OrderSide Side>
+    PriceLadder &OrderBook::opposite_side()
     {
-        auto &opposite_book = (order.side == OrderSide::BUY) ? asks_ : bids_;
-        double total_available = 0.0;
+        if constexpr (Side == OrderSide::BUY)
+            return *asks_;
+        else
+            return *bids_;
+    }
 
-        for (const auto &[price, orders] : opposite_book)
+    // Walks one crossing level in time priority. Filled makers are retired
+    // as we go; the caller erases the level once it is empty.
+    void OrderBook::fill_level(Order &order, PriceLevel &level, const TradeCallback &trade_cb)
+    {
+        OrderNode *maker_node = level.head;
+
+        while (maker_node && !order.is_fully_filled())
         {
-            if ((order.side == OrderSide::BUY && price > order.price) ||
-                (order.side == OrderSide::SELL && price < order.price))
-            {
-                break;
-            }
+            OrderNode *next = maker_node->next;
+            RestingOrder &maker_order = maker_node->order;
+
+            Quantity fill_quantity = std::min(order.leaves_quantity, maker_order.leaves_quantity);
+            execute_trade(order, *maker_node, maker_order.price, fill_quantity, trade_cb);
 
-            for (const auto &o : orders)
+            if (maker_order.is_fully_filled())
             {
-                total_available += o.leaves_quantity;
-                if (total_available >= order.quantity)
-                {
-                    return try_match_limit_order(order, trade_cb);
-                }
+                level.unlink(maker_node);
+                release_node(maker_node);
             }
-        }
 
-        order.status = OrderStatus::REJECTED;
-        return false;
+            maker_node = next;
+        }
     }
 
-    void OrderBook::execute_trade(Order &taker, Order &maker, double price,
-                                  double quantity, TradeCallback trade_cb)
+    void OrderBook::execute_trade(Order &taker, OrderNode &maker_node, Price price,
+                                  Quantity quantity, const TradeCallback &trade_cb)
     {
+        RestingOrder &maker = maker_node.order;
+        journal_level(maker.side, *maker_node.level);
         taker.fill(quantity, price);
-        maker.fill(quantity, price);
-
-        bool is_buyer_maker = (maker.side == OrderSide::BUY);
-        Trade trade(symbol_, maker.order_id, taker.order_id, price, quantity,
-                    std::chrono::system_clock::now().time_since_epoch().count(),
-                    is_buyer_maker);
-
-        std::cout << "TRADE: " << symbol_ << " " << quantity << " @ " << price
-                  << " (Maker: " << maker.order_id << ", Taker: " << taker.order_id << ")" << std::endl;
+        maker.fill(quantity);
+        maker_node.level->total_quantity -= quantity;
+
+        Trade trade;
+        trade.trade_id = next_trade_id_++;
+        trade.maker_handle = maker.handle;
+        trade.taker_handle = taker.handle;
+        trade.price = price;
+        trade.quantity = quantity;
+        trade.maker_leaves = maker.leaves_quantity;
+        trade.taker_leaves = taker.leaves_quantity;
+        trade.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+        trade.symbol_id = symbol_id_;
+        trade.is_buyer_maker = (maker.side == OrderSide::BUY);
+
+        LOG_DEBUG("TRADE: {} {} @ {} (Maker: {}, Taker: {})", symbol_, scale_.to_quantity(quantity),
+                  scale_.to_price(price), maker.handle, taker.handle);
 
         if (trade_cb)
         {
@@ -188,170 +318,453 @@ namespace GoQuant
         }
     }
 
-    void OrderBook::add_to_book(Order &order)
+    void OrderBook::add_to_book(Order &order, PriceLadder &ladder)
     {
-        auto &book = (order.side == OrderSide::BUY) ? bids_ : asks_;
-        auto &level = book[order.price];
+        PriceLevel &level = ladder.get_or_insert(order.price);
+        journal_level(order.side, level);
+
+        OrderDetails *details = details_pool_.create(order);
+        OrderNode *node = order_pool_.create(order, details);
+        details->node = node;
+        level.push_back(node);
+        order_lookup_.insert(order.handle, node);
+        session_index_.link(details, order.side);
+        if (order.expire_time != 0)
+        {
+            details->expiry = expiry_wheel_.schedule(order.expire_time, order.handle);
+        }
+    }
 
-        level.push_back(order);
+    void OrderBook::remove_from_book(OrderHandle handle)
+    {
+        OrderNode *node = order_lookup_.find(handle);
+        if (!node)
+            return;
 
-        OrderLocation loc;
-        loc.is_bid = (order.side == OrderSide::BUY);
-        loc.price_level = order.price;
-        loc.order_index = level.size() - 1;
-        order_lookup_[order.order_id] = loc;
+        remove_node(node);
     }
 
-    void OrderBook::remove_from_book(const std::string &order_id)
+    void OrderBook::remove_node(OrderNode *node)
     {
-        auto it = order_lookup_.find(order_id);
-        if (it == order_lookup_.end())
-            return;
+        PriceLevel *level = node->level;
+        journal_level(node->order.side, *level);
+        level->unlink(node);
 
-        auto &loc = it->second;
-        auto &book = loc.is_bid ? bids_ : asks_;
-        auto price_it = book.find(loc.price_level);
-        if (price_it == book.end())
+        if (level->empty())
         {
-            order_lookup_.erase(it);
-            return;
+            PriceLadder &book = (node->order.side == OrderSide::BUY) ? *bids_ : *asks_;
+            book.erase(level->price);
         }
 
-        auto &orders = price_it->second;
+        release_node(node);
+    }
 
-        size_t found_idx = SIZE_MAX;
-        for (size_t i = 0; i < orders.size(); ++i)
+    // Drops every index entry for a node already unlinked from its level and
+    // returns it and its details to the pools.
+    void OrderBook::release_node(OrderNode *node)
+    {
+        order_lookup_.erase(node->order.handle);
+        session_index_.unlink(node->details, node->order.side);
+        if (node->details->expiry)
         {
-            if (orders[i].order_id == order_id)
-            {
-                found_idx = i;
-                break;
-            }
+            expiry_wheel_.cancel(node->details->expiry);
         }
+        details_pool_.destroy(node->details);
+        order_pool_.destroy(node);
+    }
 
-        if (found_idx == SIZE_MAX)
+    // Called with book_mutex_ held after every mutation, which makes this the
+    // seqlock's only writer. Readers only see a new record when the touch
+    // actually changed. It is also where the book tells the market data
+    // publisher that it has something to send.
+    void OrderBook::publish_bbo()
+    {
+        const PriceLevel *bid = bids_->best();
+        const PriceLevel *ask = asks_->best();
+
+        BBO bbo;
+        bbo.bid_price = bid ? bid->price : 0;
+        bbo.bid_quantity = bid ? bid->total_quantity : 0;
+        bbo.ask_price = ask ? ask->price : 0;
+        bbo.ask_quantity = ask ? ask->total_quantity : 0;
+
+        bool touch_moved = bbo.bid_price != last_bbo_.bid_price || bbo.bid_quantity != last_bbo_.bid_quantity ||
+                           bbo.ask_price != last_bbo_.ask_price || bbo.ask_quantity != last_bbo_.ask_quantity;
+        if (touch_moved)
         {
-            order_lookup_.erase(it);
-            return;
+            bbo.sequence = last_bbo_.sequence + 1;
+            last_bbo_ = bbo;
+            bbo_.store(bbo);
         }
 
-        orders.erase(orders.begin() + found_idx);
-        for (size_t i = found_idx; i < orders.size(); ++i)
+        if (changes_ && (touch_moved || !bid_journal_.empty() || !ask_journal_.empty()))
         {
-            order_lookup_[orders[i].order_id].order_index = i;
+            changes_->mark(symbol_id_);
         }
+    }
 
-        if (orders.empty())
-        {
-            if (loc.is_bid)
-                bids_.erase(price_it);
-            else
-                asks_.erase(price_it);
-        }
+    // Must run before the level's quantity changes. Only the first touch
+    // since the last drain is recorded, so the steady state is a flag test;
+    // the journals keep their capacity across drains and stop allocating.
+    void OrderBook::journal_level(OrderSide side, PriceLevel &level)
+    {
+        if (!track_depth_ || level.journaled)
+            return;
 
-        order_lookup_.erase(order_id);
+        level.journaled = true;
+        auto &journal = side == OrderSide::BUY ? bid_journal_ : ask_journal_;
+        journal.push_back(JournalEntry{level.price, level.total_quantity});
     }
 
-    bool OrderBook::cancel_order(const std::string &order_id)
+    bool OrderBook::cancel_order(OrderHandle handle)
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
+        bool cancelled = process_cancel(handle);
+        publish_bbo();
+        return cancelled;
+    }
 
-        auto it = order_lookup_.find(order_id);
-        if (it == order_lookup_.end())
+    void OrderBook::cancel_orders(const std::vector<OrderHandle> &handles, std::vector<bool> &cancelled)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        cancelled.clear();
+        cancelled.reserve(handles.size());
+        for (OrderHandle handle : handles)
+        {
+            cancelled.push_back(process_cancel(handle));
+        }
+        publish_bbo();
+    }
+
+    bool OrderBook::process_cancel(OrderHandle handle)
+    {
+        OrderNode *node = order_lookup_.find(handle);
+        if (!node)
         {
-            std::cout << "Cancel failed: Order " << order_id << " not found" << std::endl;
+            LOG_DEBUG("Cancel failed: Order handle {} not found", handle);
             return false;
         }
 
-        remove_from_book(order_id);
-        std::cout << "Order cancelled: " << order_id << std::endl;
+        LOG_DEBUG("Order cancelled: {}", handle);
+        remove_node(node);
         return true;
     }
 
-    bool OrderBook::modify_order(const std::string &order_id, double new_quantity)
+    bool OrderBook::amend_order(OrderHandle handle, Price new_price, Quantity new_quantity,
+                                std::vector<Trade> &trades)
+    {
+        return amend_order(handle, new_price, new_quantity, [&trades](const Trade &trade)
+                           { trades.push_back(trade); });
+    }
+
+    bool OrderBook::amend_order(OrderHandle handle, Price new_price, Quantity new_quantity, TradeCallback trade_cb)
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
 
-        auto it = order_lookup_.find(order_id);
-        if (it == order_lookup_.end())
+        OrderNode *node = order_lookup_.find(handle);
+        if (!node)
         {
+            LOG_DEBUG("Amend failed: Order handle {} not found", handle);
             return false;
         }
 
-        auto &loc = it->second;
-        auto &book = loc.is_bid ? bids_ : asks_;
-        auto price_it = book.find(loc.price_level);
-        if (price_it == book.end())
+        bool amended = process_amend(node, new_price, new_quantity, trade_cb);
+        publish_bbo();
+        return amended;
+    }
+
+    size_t OrderBook::cancel_session_orders(SessionId session, std::optional<OrderSide> side,
+                                            std::vector<OrderHandle> *removed)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+
+        size_t cancelled = 0;
+        for (OrderSide s : {OrderSide::BUY, OrderSide::SELL})
         {
-            return false;
+            if (side && *side != s)
+                continue;
+
+            while (OrderDetails *details = session_index_.head(session, s))
+            {
+                if (removed)
+                    removed->push_back(details->node->order.handle);
+                remove_node(details->node);
+                ++cancelled;
+            }
         }
-        auto &orders = price_it->second;
-        if (loc.order_index >= orders.size())
+
+        LOG_DEBUG("Mass cancel: session {} removed {} orders", session, cancelled);
+        publish_bbo();
+        return cancelled;
+    }
+
+    size_t OrderBook::get_session_order_count(SessionId session) const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        return session_index_.count(session);
+    }
+
+    size_t OrderBook::expire_orders(uint64_t now_ms, std::vector<OrderHandle> *removed)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+
+        size_t expired = expiry_wheel_.advance(now_ms, [this, removed](uint64_t handle)
+                                               {
+            OrderNode *node = order_lookup_.find(handle);
+            if (removed)
+                removed->push_back(handle);
+            node->details->expiry = nullptr;
+            node->order.status = OrderStatus::EXPIRED;
+            LOG_DEBUG("Order expired: {}", handle);
+            remove_node(node); });
+
+        if (expired > 0)
+        {
+            publish_bbo();
+        }
+        return expired;
+    }
+
+    size_t OrderBook::get_pending_expiry_count() const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        return expiry_wheel_.size();
+    }
+
+    bool OrderBook::modify_order(OrderHandle handle, Quantity new_quantity)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+
+        OrderNode *node = order_lookup_.find(handle);
+        if (!node)
+        {
             return false;
-        Order &order = orders[loc.order_index];
+        }
+
+        bool modified = process_amend(node, node->order.price, new_quantity, TradeCallback());
+        publish_bbo();
+        return modified;
+    }
 
-        if (new_quantity < order.filled_quantity)
+    bool OrderBook::process_amend(OrderNode *node, Price new_price, Quantity new_quantity,
+                                  const TradeCallback &trade_cb)
+    {
+        RestingOrder &resting = node->order;
+        OrderDetails &details = *node->details;
+        Quantity filled_quantity = details.quantity - resting.leaves_quantity;
+
+        if (new_price <= 0 || new_quantity < filled_quantity)
         {
+            LOG_DEBUG("Amend rejected: Order handle {}", resting.handle);
             return false;
         }
 
+        Quantity new_leaves = new_quantity - filled_quantity;
+        if (new_leaves == 0)
+        {
+            remove_node(node);
+            return true;
+        }
+
+        if (new_price == resting.price && new_leaves <= resting.leaves_quantity)
+        {
+            journal_level(resting.side, *node->level);
+            node->level->total_quantity -= resting.leaves_quantity - new_leaves;
+            details.quantity = new_quantity;
+            resting.leaves_quantity = new_leaves;
+            return true;
+        }
+
+        // Anything that could jump the queue re-enters as a fresh limit order
+        // under the same handle, so it trades if it crosses and otherwise
+        // joins the tail of its level.
+        Order order = to_order(*node);
+        remove_node(node);
+
+        order.price = new_price;
         order.quantity = new_quantity;
-        order.leaves_quantity = new_quantity - order.filled_quantity;
+        order.leaves_quantity = new_leaves;
+        order.status = filled_quantity > 0 ? OrderStatus::PARTIALLY_FILLED : OrderStatus::ACTIVE;
+
+        LOG_DEBUG("Order amended: {} {} @ {}", order.handle, scale_.to_quantity(new_quantity),
+                  scale_.to_price(new_price));
+        match_order(order, trade_cb);
+        return true;
+    }
+
+    Order OrderBook::to_order(const OrderNode &node) const
+    {
+        const RestingOrder &resting = node.order;
+        const OrderDetails &details = *node.details;
+        Order order({}, symbol_, details.type, resting.side,
+                    details.quantity, resting.price, details.timestamp);
+        order.handle = resting.handle;
+        order.symbol_id = symbol_id_;
+        order.session_id = details.session;
+        order.expire_time = details.expire_time;
+        order.status = resting.status;
+        order.leaves_quantity = resting.leaves_quantity;
+        order.filled_quantity = details.quantity - resting.leaves_quantity;
+        return order;
+    }
 
+    bool OrderBook::get_order(OrderHandle handle, Order &order) const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+
+        const OrderNode *node = order_lookup_.find(handle);
+        if (!node)
+        {
+            return false;
+        }
+
+        order = to_order(*node);
         return true;
     }
 
-    double OrderBook::get_best_bid() const
+    bool OrderBook::has_order(OrderHandle handle) const
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
-        return bids_.empty() ? 0.0 : bids_.rbegin()->first;
+        return order_lookup_.find(handle) != nullptr;
     }
 
-    double OrderBook::get_best_ask() const
+    PoolStats OrderBook::get_order_pool_stats() const
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
-        return asks_.empty() ? 0.0 : asks_.begin()->first;
+        return order_pool_.get_stats();
     }
 
-    std::vector<std::pair<double, double>> OrderBook::get_bid_levels(size_t depth) const
+    PoolStats OrderBook::get_level_pool_stats() const
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
-        std::vector<std::pair<double, double>> levels;
+        return level_pool_.get_stats();
+    }
+
+    std::vector<std::pair<Price, Quantity>> OrderBook::get_bid_levels(size_t depth) const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        return collect_levels(*bids_, depth);
+    }
+
+    std::vector<std::pair<Price, Quantity>> OrderBook::get_ask_levels(size_t depth) const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        return collect_levels(*asks_, depth);
+    }
+
+    std::vector<std::pair<Price, Quantity>> OrderBook::collect_levels(const PriceLadder &ladder,
+                                                                      size_t depth) const
+    {
+        std::vector<std::pair<Price, Quantity>> levels;
 
         size_t count = 0;
-        for (auto it = bids_.rbegin(); it != bids_.rend() && count < depth; ++it)
+        for (PriceLevel *level = ladder.best(); level && count < depth; level = ladder.next(level->price))
         {
-            double total_qty = 0;
-            for (const auto &order : it->second)
-            {
-                total_qty += order.leaves_quantity;
-            }
-            levels.emplace_back(it->first, total_qty);
+            levels.emplace_back(level->price, level->total_quantity);
             ++count;
         }
 
         return levels;
     }
 
-    std::vector<std::pair<double, double>> OrderBook::get_ask_levels(size_t depth) const
+    void OrderBook::enable_depth_tracking()
     {
         std::lock_guard<std::mutex> lock(book_mutex_);
-        std::vector<std::pair<double, double>> levels;
+        track_depth_ = true;
+    }
 
-        size_t count = 0;
-        for (const auto &[price, orders] : asks_)
+    void OrderBook::set_change_set(DirtySet *changes)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        changes_ = changes;
+    }
+
+    uint64_t OrderBook::drain_depth_changes(std::vector<LevelDelta> &deltas)
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        deltas.clear();
+        collect_changes(OrderSide::BUY, *bids_, bid_journal_, deltas);
+        collect_changes(OrderSide::SELL, *asks_, ask_journal_, deltas);
+        if (!deltas.empty())
         {
-            if (count++ >= depth)
-                break;
-            double total_qty = 0;
-            for (const auto &order : orders)
+            ++depth_sequence_;
+        }
+        return depth_sequence_;
+    }
+
+    // The first entry for a price holds its quantity at the last drain and
+    // clears the live level's flag. A later entry for the same price comes
+    // from a level recreated since; it either finds the flag already
+    // cleared or, when the level is gone again, compares 0 with 0.
+    void OrderBook::collect_changes(OrderSide side, const PriceLadder &ladder,
+                                    std::vector<JournalEntry> &journal, std::vector<LevelDelta> &deltas)
+    {
+        for (const JournalEntry &entry : journal)
+        {
+            PriceLevel *level = ladder.find(entry.price);
+            if (level)
             {
-                total_qty += order.leaves_quantity;
+                if (!level->journaled)
+                    continue;
+                level->journaled = false;
             }
-            levels.emplace_back(price, total_qty);
+
+            Quantity after = level ? level->total_quantity : 0;
+            if (after == entry.before)
+                continue;
+
+            LevelAction action = after == 0 ? LevelAction::DELETE : entry.before == 0 ? LevelAction::ADD : LevelAction::UPDATE;
+            deltas.push_back(LevelDelta{entry.price, after, side, action});
         }
+        journal.clear();
+    }
 
-        return levels;
+    uint64_t OrderBook::get_depth_snapshot(std::vector<std::pair<Price, Quantity>> &bids,
+                                           std::vector<std::pair<Price, Quantity>> &asks) const
+    {
+        std::lock_guard<std::mutex> lock(book_mutex_);
+        bids = drained_levels(OrderSide::BUY, *bids_, bid_journal_);
+        asks = drained_levels(OrderSide::SELL, *asks_, ask_journal_);
+        return depth_sequence_;
+    }
+
+    // The ladder may already hold changes the next drain will report. Those
+    // are rolled back to the quantities journalled at their first touch, so
+    // the snapshot is exactly the book at the last drain. Taken as-is, a
+    // level that moved X -> Y before the snapshot and back to X after it
+    // would drain as unchanged and leave the subscriber at Y.
+    std::vector<std::pair<Price, Quantity>> OrderBook::drained_levels(OrderSide side, const PriceLadder &ladder,
+                                                                      const std::vector<JournalEntry> &journal) const
+    {
+        if (journal.empty())
+        {
+            return collect_levels(ladder, ladder.size());
+        }
+
+        std::map<Price, Quantity> levels;
+        for (PriceLevel *level = ladder.best(); level; level = ladder.next(level->price))
+        {
+            levels.emplace(level->price, level->total_quantity);
+        }
+        // Walked backwards so the first entry for a price, the one from before
+        // any recreation, is the one that sticks.
+        for (auto it = journal.rbegin(); it != journal.rend(); ++it)
+        {
+            levels[it->price] = it->before;
+        }
+
+        std::vector<std::pair<Price, Quantity>> result;
+        result.reserve(levels.size());
+        auto keep = [&result](const std::pair<const Price, Quantity> &level)
+        {
+            if (level.second != 0)
+                result.emplace_back(level.first, level.second);
+        };
+        if (side == OrderSide::BUY)
+            std::for_each(levels.rbegin(), levels.rend(), keep);
+        else
+            std::for_each(levels.begin(), levels.end(), keep);
+        return result;
     }
 
 }
\ No newline at end of file
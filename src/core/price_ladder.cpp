@@ -0,0 +1,376 @@
+#include "core/price_ladder.hpp"
+#include <stdexcept>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GoQuant
+{
+
+    namespace
+    {
+        inline int highest_bit(uint64_t x)
+        {
+#if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanReverse64(&idx, x);
+            return static_cast<int>(idx);
+#else
+            return 63 - __builtin_clzll(x);
+#endif
+        }
+
+        inline int lowest_bit(uint64_t x)
+        {
+#if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanForward64(&idx, x);
+            return static_cast<int>(idx);
+#else
+            return __builtin_ctzll(x);
+#endif
+        }
+    }
+
+    LadderType parse_ladder_type(const std::string &name)
+    {
+        if (name == "map")
+            return LadderType::MAP;
+        if (name == "dense")
+            return LadderType::DENSE;
+        throw std::invalid_argument("Unknown book type: " + name);
+    }
+
+    std::unique_ptr<PriceLadder> PriceLadder::create(LadderType type, bool is_bid, LevelPool &pool)
+    {
+        if (type == LadderType::DENSE)
+        {
+            return std::make_unique<DenseLadder>(is_bid, pool);
+        }
+        return std::make_unique<MapLadder>(is_bid, pool);
+    }
+
+    MapLadder::~MapLadder()
+    {
+        for (auto &[price, level] : levels_)
+        {
+            pool_.destroy(level);
+        }
+    }
+
+    PriceLevel *MapLadder::find(Price price) const
+    {
+        auto it = levels_.find(price);
+        return it == levels_.end() ? nullptr : it->second;
+    }
+
+    PriceLevel &MapLadder::get_or_insert(Price price)
+    {
+        auto &level = levels_[price];
+        if (!level)
+        {
+            level = pool_.create(price);
+        }
+        return *level;
+    }
+
+    void MapLadder::erase(Price price)
+    {
+        auto it = levels_.find(price);
+        if (it == levels_.end())
+            return;
+        pool_.destroy(it->second);
+        levels_.erase(it);
+    }
+
+    PriceLevel *MapLadder::best() const
+    {
+        if (levels_.empty())
+            return nullptr;
+        return is_bid_ ? levels_.rbegin()->second : levels_.begin()->second;
+    }
+
+    PriceLevel *MapLadder::next(Price price) const
+    {
+        if (is_bid_)
+        {
+            auto it = levels_.lower_bound(price);
+            if (it == levels_.begin())
+                return nullptr;
+            return std::prev(it)->second;
+        }
+
+        auto it = levels_.upper_bound(price);
+        return it == levels_.end() ? nullptr : it->second;
+    }
+
+    DenseLadder::DenseLadder(bool is_bid, LevelPool &pool)
+        : PriceLadder(is_bid, pool), base_(0), window_count_(0), slots_{}, words_{}, summary_(0) {}
+
+    DenseLadder::~DenseLadder()
+    {
+        for (PriceLevel *level : slots_)
+        {
+            pool_.destroy(level);
+        }
+        for (auto &[price, level] : overflow_)
+        {
+            pool_.destroy(level);
+        }
+    }
+
+    void DenseLadder::set_bit(size_t idx)
+    {
+        words_[idx >> 6] |= (1ULL << (idx & 63));
+        summary_ |= (1ULL << (idx >> 6));
+    }
+
+    void DenseLadder::clear_bit(size_t idx)
+    {
+        size_t w = idx >> 6;
+        words_[w] &= ~(1ULL << (idx & 63));
+        if (words_[w] == 0)
+        {
+            summary_ &= ~(1ULL << w);
+        }
+    }
+
+    long DenseLadder::highest_below(size_t limit) const
+    {
+        if (limit == 0)
+            return -1;
+
+        size_t idx = limit - 1;
+        size_t w = idx >> 6;
+        size_t b = idx & 63;
+        uint64_t bits = words_[w] & (b == 63 ? ~0ULL : ((1ULL << (b + 1)) - 1));
+        if (bits)
+            return static_cast<long>(w * 64 + highest_bit(bits));
+
+        uint64_t words_below = summary_ & ((1ULL << w) - 1);
+        if (words_below)
+        {
+            int ww = highest_bit(words_below);
+            return static_cast<long>(ww * 64 + highest_bit(words_[ww]));
+        }
+        return -1;
+    }
+
+    long DenseLadder::lowest_from(size_t from) const
+    {
+        if (from >= WINDOW_TICKS)
+            return -1;
+
+        size_t w = from >> 6;
+        uint64_t bits = words_[w] & (~0ULL << (from & 63));
+        if (bits)
+            return static_cast<long>(w * 64 + lowest_bit(bits));
+
+        uint64_t words_above = (w == 63) ? 0 : (summary_ & (~0ULL << (w + 1)));
+        if (words_above)
+        {
+            int ww = lowest_bit(words_above);
+            return static_cast<long>(ww * 64 + lowest_bit(words_[ww]));
+        }
+        return -1;
+    }
+
+    PriceLevel *DenseLadder::window_best() const
+    {
+        long idx = is_bid_ ? highest_below(WINDOW_TICKS) : lowest_from(0);
+        return idx < 0 ? nullptr : slots_[idx];
+    }
+
+    PriceLevel *DenseLadder::overflow_best() const
+    {
+        if (overflow_.empty())
+            return nullptr;
+        return is_bid_ ? overflow_.rbegin()->second : overflow_.begin()->second;
+    }
+
+    PriceLevel *DenseLadder::find(Price price) const
+    {
+        if (in_window(price))
+        {
+            return slots_[index_of(price)];
+        }
+        auto it = overflow_.find(price);
+        return it == overflow_.end() ? nullptr : it->second;
+    }
+
+    PriceLevel &DenseLadder::get_or_insert(Price price)
+    {
+        if (size() == 0)
+        {
+            recenter(price);
+        }
+        else if (!in_window(price))
+        {
+            PriceLevel *current = best();
+            if (current && is_better(price, current->price))
+            {
+                recenter(price);
+            }
+        }
+
+        if (in_window(price))
+        {
+            size_t idx = index_of(price);
+            if (!slots_[idx])
+            {
+                slots_[idx] = pool_.create(price);
+                set_bit(idx);
+                ++window_count_;
+            }
+            return *slots_[idx];
+        }
+
+        auto &level = overflow_[price];
+        if (!level)
+        {
+            level = pool_.create(price);
+        }
+        return *level;
+    }
+
+    void DenseLadder::erase(Price price)
+    {
+        if (in_window(price))
+        {
+            size_t idx = index_of(price);
+            if (!slots_[idx])
+                return;
+            pool_.destroy(slots_[idx]);
+            slots_[idx] = nullptr;
+            clear_bit(idx);
+            --window_count_;
+        }
+        else
+        {
+            auto it = overflow_.find(price);
+            if (it == overflow_.end())
+                return;
+            pool_.destroy(it->second);
+            overflow_.erase(it);
+        }
+
+        if (!overflow_.empty() && (window_count_ == 0 || touch_drifted()))
+        {
+            recenter(best()->price);
+        }
+    }
+
+    PriceLevel *DenseLadder::best() const
+    {
+        PriceLevel *in_window_best = window_best();
+        PriceLevel *spilled_best = overflow_best();
+        if (!in_window_best)
+            return spilled_best;
+        if (!spilled_best)
+            return in_window_best;
+        return is_better(spilled_best->price, in_window_best->price) ? spilled_best : in_window_best;
+    }
+
+    PriceLevel *DenseLadder::next(Price price) const
+    {
+        PriceLevel *candidate = nullptr;
+
+        if (price >= base_ + static_cast<Price>(WINDOW_TICKS))
+        {
+            candidate = is_bid_ ? window_best() : nullptr;
+        }
+        else if (price < base_)
+        {
+            candidate = is_bid_ ? nullptr : window_best();
+        }
+        else
+        {
+            size_t idx = index_of(price);
+            long next_idx = is_bid_ ? highest_below(idx) : lowest_from(idx + 1);
+            candidate = next_idx < 0 ? nullptr : slots_[next_idx];
+        }
+
+        PriceLevel *spilled = nullptr;
+        if (is_bid_)
+        {
+            auto it = overflow_.lower_bound(price);
+            if (it != overflow_.begin())
+                spilled = std::prev(it)->second;
+        }
+        else
+        {
+            auto it = overflow_.upper_bound(price);
+            if (it != overflow_.end())
+                spilled = it->second;
+        }
+
+        if (!candidate)
+            return spilled;
+        if (!spilled)
+            return candidate;
+        return is_better(spilled->price, candidate->price) ? spilled : candidate;
+    }
+
+    // The touch has walked into the last eighth of the window on the deep
+    // side; the levels just behind it are likely sitting in overflow.
+    bool DenseLadder::touch_drifted() const
+    {
+        PriceLevel *level = window_best();
+        if (!level)
+            return false;
+        size_t idx = index_of(level->price);
+        return is_bid_ ? idx < WINDOW_TICKS / 8 : idx >= WINDOW_TICKS - WINDOW_TICKS / 8;
+    }
+
+    // Place the touch a quarter of the window from the better edge so that
+    // most slots cover resting depth while leaving room for improvement.
+    void DenseLadder::recenter(Price touch)
+    {
+        const Price window = static_cast<Price>(WINDOW_TICKS);
+        Price new_base = is_bid_ ? touch - (window - window / 4) : touch - window / 4;
+
+        std::vector<PriceLevel *> moved;
+        moved.reserve(window_count_);
+        for (uint64_t summary = summary_; summary; summary &= summary - 1)
+        {
+            int w = lowest_bit(summary);
+            for (uint64_t bits = words_[w]; bits; bits &= bits - 1)
+            {
+                size_t idx = w * 64 + lowest_bit(bits);
+                moved.push_back(slots_[idx]);
+                slots_[idx] = nullptr;
+            }
+            words_[w] = 0;
+        }
+        summary_ = 0;
+        window_count_ = 0;
+        base_ = new_base;
+
+        auto first = overflow_.lower_bound(base_);
+        auto last = overflow_.lower_bound(base_ + window);
+        for (auto it = first; it != last; ++it)
+        {
+            moved.push_back(it->second);
+        }
+        overflow_.erase(first, last);
+
+        for (PriceLevel *level : moved)
+        {
+            Price price = level->price;
+            if (in_window(price))
+            {
+                size_t idx = index_of(price);
+                slots_[idx] = level;
+                set_bit(idx);
+                ++window_count_;
+            }
+            else
+            {
+                overflow_[price] = level;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,126 @@
+#include "core/trailing_stops.hpp"
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GoQuant
+{
+
+    namespace
+    {
+        inline int lowest_bit(unsigned mask)
+        {
+#if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanForward(&idx, mask);
+            return static_cast<int>(idx);
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        // One kernel per side keeps the inner loop free of branches other
+        // than the bit scan over lanes that fired.
+        //   BUY:  trigger = max(trigger, price - distance); fire on price <= trigger
+        //   SELL: trigger = min(trigger, price + distance); fire on price >= trigger
+        template <OrderSide Side>
+        void ratchet(Price price, Price *triggers, const Price *distances, size_t count,
+                     std::vector<size_t> &fired)
+        {
+            size_t i = 0;
+
+#if defined(__AVX2__)
+            const __m256i prices = _mm256_set1_epi64x(price);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m256i trigger = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(triggers + i));
+                __m256i distance = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(distances + i));
+                __m256i resting;
+                if constexpr (Side == OrderSide::BUY)
+                {
+                    __m256i candidate = _mm256_sub_epi64(prices, distance);
+                    trigger = _mm256_blendv_epi8(trigger, candidate, _mm256_cmpgt_epi64(candidate, trigger));
+                    resting = _mm256_cmpgt_epi64(prices, trigger);
+                }
+                else
+                {
+                    __m256i candidate = _mm256_add_epi64(prices, distance);
+                    trigger = _mm256_blendv_epi8(trigger, candidate, _mm256_cmpgt_epi64(trigger, candidate));
+                    resting = _mm256_cmpgt_epi64(trigger, prices);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(triggers + i), trigger);
+
+                unsigned mask = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(resting))) & 0xFu;
+                while (mask)
+                {
+                    fired.push_back(i + lowest_bit(mask));
+                    mask &= mask - 1;
+                }
+            }
+#elif defined(__SSE4_2__)
+            const __m128i prices = _mm_set1_epi64x(price);
+            for (; i + 2 <= count; i += 2)
+            {
+                __m128i trigger = _mm_loadu_si128(reinterpret_cast<const __m128i *>(triggers + i));
+                __m128i distance = _mm_loadu_si128(reinterpret_cast<const __m128i *>(distances + i));
+                __m128i resting;
+                if constexpr (Side == OrderSide::BUY)
+                {
+                    __m128i candidate = _mm_sub_epi64(prices, distance);
+                    trigger = _mm_blendv_epi8(trigger, candidate, _mm_cmpgt_epi64(candidate, trigger));
+                    resting = _mm_cmpgt_epi64(prices, trigger);
+                }
+                else
+                {
+                    __m128i candidate = _mm_add_epi64(prices, distance);
+                    trigger = _mm_blendv_epi8(trigger, candidate, _mm_cmpgt_epi64(trigger, candidate));
+                    resting = _mm_cmpgt_epi64(trigger, prices);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(triggers + i), trigger);
+
+                unsigned mask = ~static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(resting))) & 0x3u;
+                while (mask)
+                {
+                    fired.push_back(i + lowest_bit(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif
+
+            for (; i < count; ++i)
+            {
+                bool fire;
+                if constexpr (Side == OrderSide::BUY)
+                {
+                    Price candidate = price - distances[i];
+                    triggers[i] = candidate > triggers[i] ? candidate : triggers[i];
+                    fire = price <= triggers[i];
+                }
+                else
+                {
+                    Price candidate = price + distances[i];
+                    triggers[i] = candidate < triggers[i] ? candidate : triggers[i];
+                    fire = price >= triggers[i];
+                }
+                if (fire)
+                {
+                    fired.push_back(i);
+                }
+            }
+        }
+    }
+
+    void TrailingStopBook::update(Price price, std::vector<size_t> &fired)
+    {
+        if (side_ == OrderSide::BUY)
+            ratchet<OrderSide::BUY>(price, triggers_.data(), distances_.data(), triggers_.size(), fired);
+        else
+            ratchet<OrderSide::SELL>(price, triggers_.data(), distances_.data(), triggers_.size(), fired);
+    }
+
+}
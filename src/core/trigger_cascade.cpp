@@ -0,0 +1,49 @@
+#include "core/trigger_cascade.hpp"
+#include "utils/logger.hpp"
+
+namespace GoQuant {
+
+size_t TriggerCascade::run(OrderBook& book, Price price, std::vector<Trade>& trades) {
+    SymbolId symbol_id = book.get_symbol_id();
+    pending_.clear();
+    manager_.collect_triggered(symbol_id, price, pending_);
+
+    size_t depth = 1;
+    size_t generation_end = pending_.size();
+    bool limited = false;
+
+    // pending_ is consumed front to back while later generations append to
+    // it, so orders are moved out before anything can grow the vector.
+    for (size_t next = 0; next < pending_.size(); ++next) {
+        if (next == generation_end) {
+            ++depth;
+            generation_end = pending_.size();
+        }
+
+        Order order = std::move(pending_[next]);
+        order.handle = next_handle_++;
+        size_t first_trade = trades.size();
+        if (!book.add_order(order, trades)) {
+            LOG_WARN("Triggered order {} rejected on {}", order.order_id, book.get_symbol());
+        }
+
+        if (trades.size() == first_trade) {
+            continue;
+        }
+        if (depth < max_depth_) {
+            manager_.collect_triggered(symbol_id, trades.back().price, pending_);
+        } else {
+            limited = true;
+        }
+    }
+
+    if (limited) {
+        LOG_WARN("Trigger cascade on {} stopped at depth {}", book.get_symbol(), max_depth_);
+    }
+
+    size_t entered = pending_.size();
+    pending_.clear();
+    return entered;
+}
+
+}
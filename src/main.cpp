@@ -11,6 +11,7 @@
 #include "config/config_manager.hpp"
 #include "monitoring/health_check.hpp"
 #include "utils/performance_counter.hpp"
+#include "utils/task_scheduler.hpp"
 #include "utils/system_info.hpp"
 
 using namespace GoQuant;
@@ -20,6 +21,7 @@ std::unique_ptr<MarketDataFeed> market_data_feed;
 std::unique_ptr<SnapshotManager> snapshot_manager;
 std::unique_ptr<HealthChecker> health_checker;
 std::unique_ptr<MatchingEngine> engine;
+std::unique_ptr<TaskScheduler> scheduler;
 
 void signal_handler(int signal) {
     std::cout << "\nReceived signal " << signal << ", shutting down..." << std::endl;
@@ -32,6 +34,9 @@ void signal_handler(int signal) {
     if (health_checker) {
         health_checker->stop_continuous_check();
     }
+    if (scheduler) {
+        scheduler->stop();
+    }
     exit(0);
 }
 
@@ -40,58 +45,87 @@ void setup_signal_handlers() {
     signal(SIGTERM, signal_handler);
 }
 
-void run_performance_monitor() {
-    auto& config = ConfigManager::get_instance().get_engine_config();
+void report_performance() {
+    double throughput = engine->get_throughput_ops();
+    uint64_t orders_processed = engine->get_orders_processed();
+    
+    auto system_info = SystemInfo::get_system_usage();
     
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(config.performance_stats_interval));
+    std::cout << "\n=== Performance Stats ===" << std::endl;
+    std::cout << "Throughput: " << std::fixed << std::setprecision(2) 
+              << throughput << " orders/sec" << std::endl;
+    std::cout << "Total Orders: " << orders_processed << std::endl;
+    std::cout << "Memory Usage: " << system_info.memory_usage_mb << " MB" << std::endl;
+    std::cout << "CPU Usage: " << std::fixed << std::setprecision(1) 
+              << system_info.cpu_percent << "%" << std::endl;
+    
+    for (const auto& symbol_config : ConfigManager::get_instance().get_all_symbol_configs()) {
+        auto book = engine->get_order_book(symbol_config.symbol);
+        if (!book) continue;
         
-        if (engine) {
-            double throughput = engine->get_throughput_ops();
-            uint64_t orders_processed = engine->get_orders_processed();
-            
-            auto system_info = SystemInfo::get_system_usage();
-            
-            std::cout << "\n=== Performance Stats ===" << std::endl;
-            std::cout << "Throughput: " << std::fixed << std::setprecision(2) 
-                      << throughput << " orders/sec" << std::endl;
-            std::cout << "Total Orders: " << orders_processed << std::endl;
-            std::cout << "Memory Usage: " << system_info.memory_usage_mb << " MB" << std::endl;
-            std::cout << "CPU Usage: " << std::fixed << std::setprecision(1) 
-                      << system_info.cpu_percent << "%" << std::endl;
-        }
+        PoolStats orders = book->get_order_pool_stats();
+        PoolStats levels = book->get_level_pool_stats();
+        std::cout << symbol_config.symbol
+                  << " order pool: " << orders.in_use << "/" << orders.capacity
+                  << " (peak " << orders.high_water_mark << ")"
+                  << ", level pool: " << levels.in_use << "/" << levels.capacity
+                  << " (peak " << levels.high_water_mark << ")" << std::endl;
     }
 }
 
-void run_snapshot_scheduler() {
-    auto& config = ConfigManager::get_instance().get_engine_config();
+void save_snapshots() {
+    auto config = ConfigManager::get_instance().get_engine_config();
+    auto symbol_configs = ConfigManager::get_instance().get_all_symbol_configs();
     
-    if (!config.enable_persistence) {
-        return;
+    for (const auto& symbol_config : symbol_configs) {
+        auto book = engine->get_order_book(symbol_config.symbol);
+        if (book) {
+            const PriceScale& scale = book->get_scale();
+            auto bids = scale.to_decimal_levels(book->get_bid_levels(config.order_book_depth));
+            auto asks = scale.to_decimal_levels(book->get_ask_levels(config.order_book_depth));
+            snapshot_manager->save_snapshot(symbol_config.symbol, bids, asks);
+        }
     }
     
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(config.snapshot_interval_seconds));
-        
-        if (engine && snapshot_manager) {
-            auto symbol_configs = ConfigManager::get_instance().get_all_symbol_configs();
-            
-            for (const auto& symbol_config : symbol_configs) {
-                auto book = engine->get_order_book(symbol_config.symbol);
-                if (book) {
-                    auto bids = book->get_bid_levels(config.order_book_depth);
-                    auto asks = book->get_ask_levels(config.order_book_depth);
-                    snapshot_manager->save_snapshot(symbol_config.symbol, bids, asks);
-                }
+    std::cout << "Order book snapshots saved for " << symbol_configs.size() << " symbols" << std::endl;
+    
+    snapshot_manager->cleanup_old_snapshots(7);
+}
+
+void update_mark_prices() {
+    size_t symbol_count = engine->get_symbol_registry().size();
+    for (SymbolId symbol_id = 0; symbol_id < symbol_count; ++symbol_id) {
+        auto book = engine->get_order_book(symbol_id);
+        if (book) {
+            BBO bbo = book->get_bbo();
+            if (bbo.bid_price > 0 && bbo.ask_price > 0) {
+                Price mid_price = (bbo.bid_price + bbo.ask_price) / 2;
+                engine->update_market_price(symbol_id, mid_price);
             }
-            
-            std::cout << "Order book snapshots saved for " << symbol_configs.size() << " symbols" << std::endl;
-            
-            snapshot_manager->cleanup_old_snapshots(7);
         }
     }
 }
 
+void expire_orders() {
+    uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    engine->expire_orders(now_ms);
+}
+
+// Every periodic job runs off the one scheduler wheel instead of its own
+// sleeping thread.
+void schedule_jobs(const EngineConfig& config) {
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+    
+    scheduler->schedule_every(seconds(config.performance_stats_interval), report_performance);
+    if (config.enable_persistence) {
+        scheduler->schedule_every(seconds(config.snapshot_interval_seconds), save_snapshots);
+    }
+    scheduler->schedule_every(seconds(1), update_mark_prices);
+    scheduler->schedule_every(milliseconds(config.expiry_check_interval_ms), expire_orders);
+}
+
 void print_banner() {
     std::cout << R"(
    _____       ___                  _   
@@ -130,8 +164,11 @@ int main(int argc, char* argv[]) {
     auto config = ConfigManager::get_instance().get_engine_config();
     
     engine = std::make_unique<MatchingEngine>();
+    scheduler = std::make_unique<TaskScheduler>();
     ws_server = std::make_unique<WebSocketServer>(*engine, config.websocket_port);
-    market_data_feed = std::make_unique<MarketDataFeed>(*engine, *ws_server);
+    market_data_feed = std::make_unique<MarketDataFeed>(
+        *engine, *ws_server, std::chrono::milliseconds(config.market_data_bbo_interval_ms),
+        std::chrono::milliseconds(config.market_data_depth_interval_ms));
     snapshot_manager = std::make_unique<SnapshotManager>(config.persistence_path + "orderbook.db");
     health_checker = std::make_unique<HealthChecker>(*engine);
     
@@ -146,18 +183,21 @@ int main(int argc, char* argv[]) {
     
     engine->set_trade_callback([&](const Trade& trade) {
         market_data_feed->on_trade_executed(trade);
+        ws_server->report_fill(trade);
+    });
+    engine->set_order_event_callback([&](const EngineEvent& event) {
+        ws_server->report_order_event(event);
     });
     
     engine->get_fee_calculator().set_fee_structure(
         FeeStructure(config.maker_fee, config.taker_fee));
+    engine->start();
     
     std::cout << "\n Starting Services..." << std::endl;
     ws_server->start();
     market_data_feed->start();
-    health_checker->start_continuous_check(30);
-    
-    std::thread perf_monitor(run_performance_monitor);
-    std::thread snapshot_scheduler(run_snapshot_scheduler);
+    health_checker->start_continuous_check(*scheduler, 30);
+    schedule_jobs(config);
     
     auto system_info = SystemInfo::get_system_usage();
     
@@ -180,27 +220,7 @@ int main(int argc, char* argv[]) {
     
     std::cout << "\n Press Ctrl+C to stop the server" << std::endl;
     
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        
-        for (const auto& symbol_config : symbol_configs) {
-            auto book = engine->get_order_book(symbol_config.symbol);
-            if (book) {
-                double mid_price = (book->get_best_bid() + book->get_best_ask()) / 2.0;
-                if (mid_price > 0) {
-                    engine->update_market_price(symbol_config.symbol, mid_price);
-                }
-            }
-        }
-        
-        auto health_status = health_checker->get_last_status();
-        if (!health_status.is_healthy) {
-            std::cerr << "Health Check Alert: " << health_status.message << std::endl;
-        }
-    }
-    
-    perf_monitor.join();
-    snapshot_scheduler.join();
+    scheduler->run();
     
     return 0;
-}
\ No newline at end of file
+}
@@ -1,88 +1,193 @@
 #include "market_data/market_data_feed.hpp"
 #include "api/json_serializer.hpp"
-#include <thread>
+#include <algorithm>
 #include <iostream>
 namespace GoQuant
 {
-    MarketDataFeed::MarketDataFeed(MatchingEngine &engine, WebSocketServer &ws_server)
-        : engine_(engine), ws_server_(ws_server), running_(false) {}
+    namespace
+    {
+        // Only bounds the publisher's wait while nothing is pending; marks
+        // wake it early.
+        constexpr std::chrono::seconds IDLE_WAIT(1);
+    }
+
+    MarketDataFeed::MarketDataFeed(MatchingEngine &engine, WebSocketServer &ws_server,
+                                   std::chrono::milliseconds bbo_interval, std::chrono::milliseconds depth_interval)
+        : engine_(engine), ws_server_(ws_server), bbo_interval_(bbo_interval), depth_interval_(depth_interval) {}
     MarketDataFeed::~MarketDataFeed()
     {
         stop();
     }
     void MarketDataFeed::start()
     {
-        if (running_)
+        if (running_.exchange(true))
             return;
 
-        running_ = true;
-        feed_thread_ = std::thread(&MarketDataFeed::run_feed, this);
+        if (!dirty_)
+            dirty_ = std::make_unique<DirtySet>(engine_.get_symbol_registry().size());
+        states_.clear();
+        waiting_.clear();
+
+        engine_.set_book_listener([this](OrderBook &book)
+                                  { attach_book(book); });
+
+        publisher_ = std::thread([this]
+                                 { run_publisher(); });
         std::cout << "Market data feed started" << std::endl;
     }
     void MarketDataFeed::stop()
     {
-        if (!running_)
+        if (!running_.exchange(false))
             return;
 
-        running_ = false;
-        if (feed_thread_.joinable())
+        engine_.set_book_listener(nullptr);
+        dirty_->wake();
+        if (publisher_.joinable())
+            publisher_.join();
+
+        for (SymbolId symbol_id = 0;; ++symbol_id)
         {
-            feed_thread_.join();
+            auto book = engine_.get_order_book(symbol_id);
+            if (!book)
+                break;
+            book->set_change_set(nullptr);
         }
         std::cout << "Market data feed stopped" << std::endl;
     }
-    void MarketDataFeed::run_feed()
+    // Runs under the engine lock for every book present at start() and for
+    // each one registered after.
+    void MarketDataFeed::attach_book(OrderBook &book)
+    {
+        SymbolId symbol_id = book.get_symbol_id();
+        dirty_->grow(static_cast<size_t>(symbol_id) + 1);
+        if (symbol_id >= dirty_->capacity())
+        {
+            std::cerr << "Market data feed: no room for " << book.get_symbol() << ", not publishing it" << std::endl;
+            return;
+        }
+
+        book.enable_depth_tracking();
+        book.set_change_set(dirty_.get());
+        // Publish whatever the book already holds.
+        dirty_->mark(symbol_id);
+    }
+    void MarketDataFeed::run_publisher()
     {
-        while (running_)
+        Clock::time_point deadline = Clock::now() + IDLE_WAIT;
+
+        while (running_.load(std::memory_order_acquire))
         {
-            auto symbols = get_active_symbols();
-            for (const auto &symbol : symbols)
+            marked_.clear();
+            dirty_->wait_until(deadline, marked_);
+
+            for (uint32_t symbol_id : marked_)
             {
-                broadcast_bbo_update(symbol);
-                broadcast_depth_update(symbol);
+                if (symbol_id >= states_.size())
+                    states_.resize(static_cast<size_t>(symbol_id) + 1);
+                SymbolState &state = states_[symbol_id];
+                state.bbo_pending = true;
+                state.depth_pending = true;
+                if (!state.waiting)
+                {
+                    state.waiting = true;
+                    waiting_.push_back(symbol_id);
+                }
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            deadline = publish_due(Clock::now());
         }
     }
+    // Publishes every pending channel whose interval has elapsed and returns
+    // when the earliest one still held back becomes due.
+    MarketDataFeed::Clock::time_point MarketDataFeed::publish_due(Clock::time_point now)
+    {
+        Clock::time_point next = Clock::time_point::max();
+
+        for (size_t i = 0; i < waiting_.size();)
+        {
+            SymbolId symbol_id = waiting_[i];
+            SymbolState &state = states_[symbol_id];
+
+            if (state.bbo_pending)
+            {
+                if (now >= state.next_bbo)
+                {
+                    broadcast_bbo_update(symbol_id, state);
+                    state.bbo_pending = false;
+                    state.next_bbo = now + bbo_interval_;
+                }
+                else
+                {
+                    next = std::min(next, state.next_bbo);
+                }
+            }
+            if (state.depth_pending)
+            {
+                if (now >= state.next_depth)
+                {
+                    publish_depth_changes(symbol_id);
+                    state.depth_pending = false;
+                    state.next_depth = now + depth_interval_;
+                }
+                else
+                {
+                    next = std::min(next, state.next_depth);
+                }
+            }
+
+            if (state.bbo_pending || state.depth_pending)
+            {
+                ++i;
+                continue;
+            }
+            state.waiting = false;
+            waiting_[i] = waiting_.back();
+            waiting_.pop_back();
+        }
+
+        return waiting_.empty() ? now + IDLE_WAIT : next;
+    }
     void MarketDataFeed::on_trade_executed(const Trade &trade)
     {
-        ws_server_.broadcast_trade(trade);
+        auto book = engine_.get_order_book(trade.symbol_id);
+        if (!book)
+            return;
+
+        auto trade_msg = JsonSerializer::serialize_trade(trade, book->get_symbol(), book->get_scale());
+        ws_server_.broadcast_market_data(MarketDataChannel::TRADES, trade.symbol_id, std::move(trade_msg));
     }
-    void MarketDataFeed::broadcast_bbo_update(const std::string &symbol)
+    // A mark does not say which channel moved, so an unchanged BBO sequence
+    // is skipped here rather than resent.
+    void MarketDataFeed::broadcast_bbo_update(SymbolId symbol_id, SymbolState &state)
     {
-        auto book = engine_.get_order_book(symbol);
+        auto book = engine_.get_order_book(symbol_id);
         if (!book)
             return;
 
-        double best_bid = book->get_best_bid();
-        double best_ask = book->get_best_ask();
+        BBO bbo = book->get_bbo();
+        if (bbo.sequence == state.bbo_sequence)
+            return;
+        state.bbo_sequence = bbo.sequence;
 
-        if (best_bid > 0 && best_ask > 0 && best_ask > best_bid)
+        if (bbo.bid_price > 0 && bbo.ask_price > 0 && bbo.ask_price > bbo.bid_price)
         {
             auto bbo_msg = JsonSerializer::serialize_bbo_update(
-                symbol, best_bid, best_ask, JsonSerializer::get_current_timestamp());
-            ws_server_.broadcast_market_data(symbol, bbo_msg);
+                book->get_symbol(), bbo, book->get_scale(), JsonSerializer::get_current_timestamp());
+            ws_server_.broadcast_market_data(MarketDataChannel::BBO, symbol_id, std::move(bbo_msg));
         }
     }
-    void MarketDataFeed::broadcast_depth_update(const std::string &symbol)
+    void MarketDataFeed::publish_depth_changes(SymbolId symbol_id)
     {
-        auto book = engine_.get_order_book(symbol);
+        auto book = engine_.get_order_book(symbol_id);
         if (!book)
             return;
 
-        auto bids = book->get_bid_levels(10);
-        auto asks = book->get_ask_levels(10);
-
-        if (!bids.empty() || !asks.empty())
+        uint64_t sequence = book->drain_depth_changes(deltas_);
+        if (!deltas_.empty())
         {
-            auto depth_msg = JsonSerializer::serialize_order_book_update(
-                symbol, bids, asks, JsonSerializer::get_current_timestamp());
-            ws_server_.broadcast_market_data(symbol, depth_msg);
+            auto delta_msg = JsonSerializer::serialize_order_book_delta(
+                book->get_symbol(), deltas_, book->get_scale(), sequence, JsonSerializer::get_current_timestamp());
+            ws_server_.broadcast_market_data(MarketDataChannel::DEPTH, symbol_id, std::move(delta_msg));
         }
     }
-    std::vector<std::string> MarketDataFeed::get_active_symbols()
-    {
-        return {"BTC-USDT", "ETH-USDT"};
-    }
 }
\ No newline at end of file
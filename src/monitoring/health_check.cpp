@@ -10,32 +10,36 @@ HealthStatus HealthChecker::check_health() {
     return perform_health_check();
 }
 
-void HealthChecker::start_continuous_check(int interval_seconds) {
-    if (running_) return;
+void HealthChecker::start_continuous_check(TaskScheduler& scheduler, int interval_seconds) {
+    if (scheduler_) return;
     
-    running_ = true;
-    health_thread_ = std::thread(&HealthChecker::run_health_check, this, interval_seconds);
+    scheduler_ = &scheduler;
+    task_ = scheduler.schedule_every(std::chrono::seconds(interval_seconds), [this] { run_health_check(); });
+    run_health_check();
 }
 
 void HealthChecker::stop_continuous_check() {
-    if (!running_) return;
+    if (!scheduler_) return;
     
-    running_ = false;
-    if (health_thread_.joinable()) {
-        health_thread_.join();
-    }
+    scheduler_->cancel(task_);
+    scheduler_ = nullptr;
+    task_ = INVALID_TASK_ID;
 }
 
-void HealthChecker::run_health_check(int interval_seconds) {
-    while (running_) {
-        last_status_ = perform_health_check();
-        
-        if (!last_status_.is_healthy) {
-            std::cerr << "HEALTH CHECK FAILED: " << last_status_.message << std::endl;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::seconds(interval_seconds));
+HealthStatus HealthChecker::get_last_status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return last_status_;
+}
+
+void HealthChecker::run_health_check() {
+    HealthStatus status = perform_health_check();
+    
+    if (!status.is_healthy) {
+        std::cerr << "HEALTH CHECK FAILED: " << status.message << std::endl;
     }
+    
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    last_status_ = status;
 }
 
 HealthStatus HealthChecker::perform_health_check() {
@@ -49,8 +53,10 @@ HealthStatus HealthChecker::perform_health_check() {
         
         auto btc_book = engine_.get_order_book("BTC-USDT");
         if (btc_book) {
-            double best_bid = btc_book->get_best_bid();
-            double best_ask = btc_book->get_best_ask();
+            const PriceScale& scale = btc_book->get_scale();
+            BBO bbo = btc_book->get_bbo();
+            double best_bid = scale.to_price(bbo.bid_price);
+            double best_ask = scale.to_price(bbo.ask_price);
             status.details["btc_bbo"] = std::to_string(best_bid) + "/" + std::to_string(best_ask);
         }
         
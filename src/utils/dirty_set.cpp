@@ -0,0 +1,83 @@
+#include "utils/dirty_set.hpp"
+#include <algorithm>
+
+namespace GoQuant {
+
+DirtySet::DirtySet(size_t capacity)
+    : chunks_(new std::atomic<Flag*>[MAX_CHUNKS]) {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    grow(capacity);
+}
+
+DirtySet::~DirtySet() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Growth is rare, so it shares the consumer's lock. A chunk is published
+// before the capacity that covers it, and mark() only trusts the chunk.
+void DirtySet::grow(size_t capacity) {
+    capacity = std::min(capacity, max_capacity());
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t current = capacity_.load(std::memory_order_relaxed);
+    if (capacity <= current) {
+        return;
+    }
+
+    for (size_t chunk = current / CHUNK_SIZE; chunk * CHUNK_SIZE < capacity; ++chunk) {
+        chunks_[chunk].store(new Flag[CHUNK_SIZE], std::memory_order_release);
+    }
+    size_t grown = (capacity + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+    marked_.reserve(grown);
+    capacity_.store(grown, std::memory_order_release);
+}
+
+void DirtySet::mark(uint32_t id) {
+    size_t chunk_index = id / CHUNK_SIZE;
+    if (chunk_index >= MAX_CHUNKS) {
+        return;
+    }
+    Flag* chunk = chunks_[chunk_index].load(std::memory_order_acquire);
+    if (!chunk) {
+        return;
+    }
+
+    std::atomic<bool>& flag = chunk[id % CHUNK_SIZE].set;
+    if (flag.load(std::memory_order_relaxed) || flag.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        marked_.push_back(id);
+    }
+    cv_.notify_one();
+}
+
+void DirtySet::wait_until(Clock::time_point deadline, std::vector<uint32_t>& ids) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_until(lock, deadline, [this] { return !marked_.empty() || woken_; });
+    woken_ = false;
+
+    // Cleared before the consumer reads any state, so a change made after
+    // this point marks the id again.
+    for (uint32_t id : marked_) {
+        Flag* chunk = chunks_[id / CHUNK_SIZE].load(std::memory_order_relaxed);
+        chunk[id % CHUNK_SIZE].set.store(false, std::memory_order_release);
+        ids.push_back(id);
+    }
+    marked_.clear();
+}
+
+void DirtySet::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_ = true;
+    }
+    cv_.notify_one();
+}
+
+}
@@ -0,0 +1,179 @@
+#include "utils/logger.hpp"
+#include <chrono>
+
+namespace GoQuant {
+
+namespace {
+const char* level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::TRACE: return "TRACE";
+    case LogLevel::DEBUG: return "DEBUG";
+    case LogLevel::INFO: return "INFO";
+    case LogLevel::WARN: return "WARN";
+    case LogLevel::ERROR: return "ERROR";
+    default: return "OFF";
+    }
+}
+}
+
+std::array<Logger::Format, Logger::MAX_FORMATS> Logger::formats_;
+std::atomic<uint16_t> Logger::format_count_{0};
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : output_(stdout) {
+    writer_thread_ = std::thread(&Logger::writer_loop, this);
+}
+
+Logger::~Logger() {
+    running_ = false;
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+}
+
+Logger::ThreadBufferHandle::~ThreadBufferHandle() {
+    if (buffer) {
+        buffer->retired.store(true, std::memory_order_release);
+    }
+}
+
+uint16_t Logger::register_format(LogLevel level, const char* format) {
+    static std::mutex registration_mutex;
+    std::lock_guard<std::mutex> lock(registration_mutex);
+
+    uint16_t id = format_count_.load(std::memory_order_relaxed);
+    if (id >= MAX_FORMATS) {
+        return MAX_FORMATS - 1;
+    }
+    formats_[id] = Format{level, format};
+    format_count_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+SpscRing<LogRecord>& Logger::local_ring() {
+    thread_local ThreadBufferHandle handle;
+    if (!handle.buffer) {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        handle.buffer = buffer.get();
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(std::move(buffer));
+    }
+    return handle.buffer->ring;
+}
+
+void Logger::flush() {
+    // Two full writer passes guarantee everything pushed before this call
+    // has been drained, whichever pass was in flight when we arrived.
+    uint64_t target = passes_.load(std::memory_order_acquire) + 2;
+    while (passes_.load(std::memory_order_acquire) < target && running_.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void Logger::set_output(std::FILE* output) {
+    output_.store(output, std::memory_order_release);
+}
+
+void Logger::writer_loop() {
+    std::string text;
+    text.reserve(64 * 1024);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        bool wrote = drain_once(text);
+        passes_.fetch_add(1, std::memory_order_release);
+        if (!wrote) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    drain_once(text);
+    passes_.fetch_add(1, std::memory_order_release);
+}
+
+bool Logger::drain_once(std::string& text) {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers.reserve(buffers_.size());
+        for (auto& buffer : buffers_) {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    bool any = false;
+    LogRecord record;
+    for (ThreadBuffer* buffer : buffers) {
+        // Read the flag first: once a retired ring is seen empty it can
+        // never be written again.
+        bool retired = buffer->retired.load(std::memory_order_acquire);
+        text.clear();
+        while (buffer->ring.try_pop(record)) {
+            format_record(record, text);
+        }
+        if (!text.empty()) {
+            std::FILE* output = output_.load(std::memory_order_acquire);
+            std::fwrite(text.data(), 1, text.size(), output);
+            std::fflush(output);
+            any = true;
+        }
+        if (retired) {
+            std::lock_guard<std::mutex> lock(buffers_mutex_);
+            for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+                if (it->get() == buffer) {
+                    buffers_.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+    return any;
+}
+
+void Logger::format_record(const LogRecord& record, std::string& text) const {
+    const Format& format = formats_[record.format_id];
+    char scratch[64];
+
+    int n = std::snprintf(scratch, sizeof(scratch), "%llu.%06llu [%s] ",
+                          static_cast<unsigned long long>(record.timestamp_ns / 1000000000ULL),
+                          static_cast<unsigned long long>((record.timestamp_ns / 1000ULL) % 1000000ULL),
+                          level_name(format.level));
+    text.append(scratch, static_cast<size_t>(n));
+
+    size_t next_arg = 0;
+    for (const char* p = format.text; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}' && next_arg < record.arg_count) {
+            const LogArg& arg = record.args[next_arg++];
+            switch (arg.type) {
+            case LogArg::Type::INT:
+                n = std::snprintf(scratch, sizeof(scratch), "%lld", static_cast<long long>(arg.i));
+                text.append(scratch, static_cast<size_t>(n));
+                break;
+            case LogArg::Type::UINT:
+                n = std::snprintf(scratch, sizeof(scratch), "%llu", static_cast<unsigned long long>(arg.u));
+                text.append(scratch, static_cast<size_t>(n));
+                break;
+            case LogArg::Type::DOUBLE:
+                n = std::snprintf(scratch, sizeof(scratch), "%.10g", arg.d);
+                text.append(scratch, static_cast<size_t>(n));
+                break;
+            case LogArg::Type::STRING:
+                text.append(arg.s);
+                break;
+            }
+            ++p;
+        } else {
+            text.push_back(*p);
+        }
+    }
+    text.push_back('\n');
+}
+
+uint64_t Logger::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
@@ -0,0 +1,117 @@
+#include "utils/task_scheduler.hpp"
+#include <algorithm>
+
+namespace GoQuant {
+
+TaskScheduler::TaskScheduler(std::chrono::milliseconds tick)
+    : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), epoch_(Clock::now()), wheel_(0, 64) {}
+
+TaskScheduler::~TaskScheduler() {
+    stop();
+}
+
+TaskId TaskScheduler::schedule_after(std::chrono::milliseconds delay, std::function<void()> task) {
+    return add_task(delay, 0, std::move(task));
+}
+
+TaskId TaskScheduler::schedule_every(std::chrono::milliseconds interval, std::function<void()> task) {
+    uint64_t interval_ticks = std::max<uint64_t>(1, interval / tick_);
+    return add_task(interval, interval_ticks, std::move(task));
+}
+
+TaskId TaskScheduler::add_task(std::chrono::milliseconds delay, uint64_t interval_ticks,
+                               std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TaskId id = next_id_++;
+    uint64_t deadline = ticks_since_epoch(Clock::now() + delay);
+    Task entry{std::make_shared<std::function<void()>>(std::move(task)), interval_ticks, deadline,
+               wheel_.schedule(deadline, id)};
+    tasks_.emplace(id, std::move(entry));
+    return id;
+}
+
+bool TaskScheduler::cancel(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end()) {
+        return false;
+    }
+    wheel_.cancel(it->second.timer);
+    tasks_.erase(it);
+    return true;
+}
+
+size_t TaskScheduler::run_due(Clock::time_point now) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        due_.clear();
+        uint64_t tick = ticks_since_epoch(now);
+        wheel_.advance(tick, [this](uint64_t id) { due_.push_back(id); });
+        
+        ready_.clear();
+        for (TaskId id : due_) {
+            auto it = tasks_.find(id);
+            Task& task = it->second;
+            ready_.push_back(task.fn);
+            if (task.interval_ticks == 0) {
+                tasks_.erase(it);
+            } else {
+                task.deadline += task.interval_ticks;
+                if (task.deadline <= tick) {
+                    task.deadline = tick + task.interval_ticks;
+                }
+                task.timer = wheel_.schedule(task.deadline, id);
+            }
+        }
+    }
+
+    for (auto& fn : ready_) {
+        (*fn)();
+    }
+    return ready_.size();
+}
+
+void TaskScheduler::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&TaskScheduler::loop, this);
+}
+
+void TaskScheduler::run() {
+    running_ = true;
+    loop();
+}
+
+void TaskScheduler::loop() {
+    while (running_.load(std::memory_order_relaxed)) {
+        run_due(Clock::now());
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, tick_, [this] { return !running_.load(std::memory_order_relaxed); });
+    }
+}
+
+void TaskScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+size_t TaskScheduler::get_task_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+uint64_t TaskScheduler::ticks_since_epoch(Clock::time_point time) const {
+    if (time <= epoch_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((time - epoch_) / tick_);
+}
+
+}
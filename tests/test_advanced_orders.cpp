@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "../include/core/advanced_orders.hpp"
+#include "../include/core/symbol_registry.hpp"
+#include <string>
+#include <vector>
+
+using namespace GoQuant;
+
+class AdvancedOrderManagerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        btc = symbols.intern("BTC-USDT");
+        manager = std::make_unique<AdvancedOrderManager>(symbols);
+        manager->set_order_callback([this](const Order &order)
+                                    { released.push_back(order); });
+    }
+
+    SymbolRegistry symbols;
+    SymbolId btc;
+    std::unique_ptr<AdvancedOrderManager> manager;
+    std::vector<Order> released;
+};
+
+TEST_F(AdvancedOrderManagerTest, StopsFireInTriggerOrderOnlyWhenCrossed)
+{
+    std::string far = manager->add_stop_loss("BTC-USDT", OrderSide::SELL, 1, 4800000);
+    std::string near = manager->add_stop_loss("BTC-USDT", OrderSide::SELL, 2, 4900000);
+    manager->add_stop_limit("BTC-USDT", OrderSide::BUY, 3, 5100000, 5110000);
+    manager->add_take_profit("BTC-USDT", OrderSide::SELL, 4, 5200000);
+    EXPECT_EQ(manager->get_order_count(), 4u);
+
+    manager->check_triggers(btc, 5000000);
+    EXPECT_TRUE(released.empty());
+
+    // A fall through both sell stops releases the nearer trigger first.
+    manager->check_triggers(btc, 4750000);
+    ASSERT_EQ(released.size(), 2u);
+    EXPECT_EQ(released[0].order_id, near);
+    EXPECT_EQ(released[1].order_id, far);
+    EXPECT_EQ(released[0].type, OrderType::MARKET);
+
+    // A rise releases the buy stop-limit and then the sell take-profit.
+    manager->check_triggers(btc, 5200000);
+    ASSERT_EQ(released.size(), 4u);
+    EXPECT_EQ(released[2].side, OrderSide::BUY);
+    EXPECT_EQ(released[2].type, OrderType::LIMIT);
+    EXPECT_EQ(released[2].price, 5110000);
+    EXPECT_EQ(released[3].quantity, 4);
+    EXPECT_EQ(manager->get_order_count(), 0u);
+}
+
+TEST_F(AdvancedOrderManagerTest, CancelRemovesOrderFromItsBook)
+{
+    std::string stop = manager->add_stop_loss("BTC-USDT", OrderSide::SELL, 1, 4900000);
+    std::string trail_a = manager->add_trailing_stop("BTC-USDT", OrderSide::BUY, 1, 1000, 4000000);
+    std::string trail_b = manager->add_trailing_stop("BTC-USDT", OrderSide::BUY, 2, 1000, 4000000);
+    EXPECT_TRUE(manager->add_stop_loss("DOGE-USDT", OrderSide::SELL, 1, 100).empty());
+
+    EXPECT_TRUE(manager->cancel_advanced_order(stop));
+    EXPECT_FALSE(manager->cancel_advanced_order(stop));
+    EXPECT_TRUE(manager->cancel_advanced_order(trail_a));
+    EXPECT_EQ(manager->get_order_count(), 1u);
+
+    manager->check_triggers(btc, 4800000);
+    manager->check_triggers(btc, 4798000);
+    ASSERT_EQ(released.size(), 1u);
+    EXPECT_EQ(released[0].order_id, trail_b);
+}
+
+TEST(TrailingStopBookTest, RatchetsAndReportsFiredRows)
+{
+    // Odd row counts leave a scalar tail after the vector lanes.
+    TrailingStopBook buys(OrderSide::BUY);
+    TrailingStopBook sells(OrderSide::SELL);
+    for (uint64_t i = 0; i < 11; ++i)
+    {
+        buys.add(0, 100 * (i + 1), i);
+        sells.add(1000000, 100 * (i + 1), i);
+    }
+
+    std::vector<size_t> fired;
+    buys.update(10000, fired);
+    sells.update(10000, fired);
+    EXPECT_TRUE(fired.empty());
+    EXPECT_EQ(buys.trigger(0), 9900);
+    EXPECT_EQ(sells.trigger(10), 11100);
+
+    // Triggers never ratchet back: the buy side fires for every distance the
+    // drop covers and the sell side is untouched.
+    buys.update(9550, fired);
+    EXPECT_EQ(fired, (std::vector<size_t>{0, 1, 2, 3}));
+    EXPECT_EQ(buys.trigger(0), 9900);
+    EXPECT_EQ(buys.trigger(4), 9500);
+
+    fired.clear();
+    sells.update(10250, fired);
+    EXPECT_EQ(fired, (std::vector<size_t>{0, 1}));
+
+    buys.remove(0);
+    EXPECT_EQ(buys.size(), 10u);
+    EXPECT_EQ(buys.handle(0), 10u);
+    EXPECT_EQ(buys.trigger(0), 8900);
+}
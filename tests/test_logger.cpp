@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "utils/logger.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace GoQuant;
+
+class LoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        output_ = std::tmpfile();
+        ASSERT_NE(output_, nullptr);
+        Logger::instance().flush();
+        Logger::instance().set_output(output_);
+    }
+
+    void TearDown() override {
+        Logger::instance().flush();
+        Logger::instance().set_output(stdout);
+        Logger::instance().flush();
+        std::fclose(output_);
+    }
+
+    std::string read_output() {
+        Logger::instance().flush();
+        std::fflush(output_);
+        std::rewind(output_);
+        std::string text;
+        char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), output_)) > 0) {
+            text.append(buffer, n);
+        }
+        return text;
+    }
+
+    std::FILE* output_ = nullptr;
+};
+
+TEST_F(LoggerTest, FormatsArgumentsOnWriterThread) {
+    std::string symbol = "BTC-USDT";
+    LOG_WARN("Rejected {} qty {} @ {} ({})", symbol, int64_t(-5), 101.5, "SELL");
+    LOG_INFO("handle {} flag {}", uint64_t(42), true);
+
+    std::string text = read_output();
+    EXPECT_NE(text.find("[WARN] Rejected BTC-USDT qty -5 @ 101.5 (SELL)\n"), std::string::npos);
+    EXPECT_NE(text.find("[INFO] handle 42 flag true\n"), std::string::npos);
+}
+
+TEST_F(LoggerTest, BelowCompileTimeLevelIsCompiledOut) {
+    LOG_TRACE("trace {}", 1);
+    LOG_ERROR("error {}", 2);
+
+    std::string text = read_output();
+    EXPECT_EQ(text.find("trace 1"), std::string::npos);
+    EXPECT_NE(text.find("[ERROR] error 2"), std::string::npos);
+}
+
+TEST_F(LoggerTest, LongStringsAreTruncated) {
+    std::string order_id(64, 'x');
+    LOG_INFO("order {}", order_id);
+
+    std::string text = read_output();
+    EXPECT_NE(text.find("order " + std::string(LogArg::MAX_STRING, 'x') + "\n"), std::string::npos);
+}
+
+TEST_F(LoggerTest, RecordsFromExitedThreadsAreWritten) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) {
+                LOG_INFO("thread {} line {}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::string text = read_output();
+    for (int t = 0; t < 4; ++t) {
+        EXPECT_NE(text.find("thread " + std::to_string(t) + " line 99\n"), std::string::npos);
+    }
+}
@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "../include/core/matching_engine.hpp"
+#include "../include/config/config_manager.hpp"
+#include "../include/utils/dirty_set.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 using namespace GoQuant;
 
@@ -11,40 +17,530 @@ protected:
         engine = std::make_unique<MatchingEngine>();
     }
 
+    Order make_limit_order(const std::string &id, const std::string &symbol, OrderSide side,
+                           double quantity, double price, uint64_t ts)
+    {
+        const PriceScale &scale = engine->get_order_book(symbol)->get_scale();
+        return Order(id, symbol, OrderType::LIMIT, side,
+                     scale.to_lots(quantity), scale.to_ticks(price), ts);
+    }
+
+    double best_bid(const std::string &symbol)
+    {
+        auto book = engine->get_order_book(symbol);
+        return book->get_scale().to_price(book->get_best_bid());
+    }
+
     std::unique_ptr<MatchingEngine> engine;
 };
 
 TEST_F(MatchingEngineTest, BasicOrderSubmission)
 {
-    Order order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1234567890);
+    Order order = make_limit_order("1", "BTC-USDT", OrderSide::BUY, 1.0, 50000.0, 1234567890);
 
-    EXPECT_TRUE(engine->submit_order(order));
+    EXPECT_NE(engine->submit_order(order), INVALID_ORDER_HANDLE);
 
     auto book = engine->get_order_book("BTC-USDT");
     EXPECT_NE(book, nullptr);
-    EXPECT_DOUBLE_EQ(book->get_best_bid(), 50000.0);
+    EXPECT_DOUBLE_EQ(best_bid("BTC-USDT"), 50000.0);
 }
 
 TEST_F(MatchingEngineTest, CrossSymbolIsolation)
 {
-    Order btc_order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1234567890);
-    Order eth_order("2", "ETH-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 3000.0, 1234567891);
+    Order btc_order = make_limit_order("1", "BTC-USDT", OrderSide::BUY, 1.0, 50000.0, 1234567890);
+    Order eth_order = make_limit_order("2", "ETH-USDT", OrderSide::BUY, 1.0, 3000.0, 1234567891);
 
     engine->submit_order(btc_order);
     engine->submit_order(eth_order);
 
-    auto btc_book = engine->get_order_book("BTC-USDT");
-    auto eth_book = engine->get_order_book("ETH-USDT");
-
-    EXPECT_DOUBLE_EQ(btc_book->get_best_bid(), 50000.0);
-    EXPECT_DOUBLE_EQ(eth_book->get_best_bid(), 3000.0);
+    EXPECT_DOUBLE_EQ(best_bid("BTC-USDT"), 50000.0);
+    EXPECT_DOUBLE_EQ(best_bid("ETH-USDT"), 3000.0);
 }
 
 TEST_F(MatchingEngineTest, OrderCancellation)
 {
-    Order order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1234567890);
-    engine->submit_order(order);
+    Order order = make_limit_order("1", "BTC-USDT", OrderSide::BUY, 1.0, 50000.0, 1234567890);
+    OrderHandle handle = engine->submit_order(order);
+    ASSERT_NE(handle, INVALID_ORDER_HANDLE);
+
+    EXPECT_TRUE(engine->cancel_order("BTC-USDT", handle));
+    EXPECT_FALSE(engine->cancel_order("BTC-USDT", handle));
+    EXPECT_FALSE(engine->cancel_order("BTC-USDT", handle + 1000));
+}
+TEST_F(MatchingEngineTest, ReportsOrdersLeavingTheBookOtherThanByFilling)
+{
+    std::vector<OrderHandle> closed;
+    std::vector<Trade> trades;
+    engine->set_order_event_callback([&closed](const EngineEvent &event)
+                                     {
+        ASSERT_EQ(event.type, EngineEvent::Type::ORDER_CLOSED);
+        closed.push_back(event.handle); });
+    engine->set_trade_callback([&trades](const Trade &trade) { trades.push_back(trade); });
+
+    Order ask = make_limit_order("1", "BTC-USDT", OrderSide::SELL, 2.0, 50000.0, 1);
+    ask.session_id = 7;
+    OrderHandle resting = engine->submit_order(ask);
+    OrderHandle partly_filled = engine->submit_order(make_limit_order("2", "BTC-USDT", OrderSide::SELL, 1.0, 50001.0, 2));
+    EXPECT_TRUE(closed.empty());
+
+    // The IOC takes all of the first ask and half of the second. The first
+    // ask's end is told by its fill alone; the IOC never rested, so it is
+    // reported closed.
+    Order ioc = make_limit_order("3", "BTC-USDT", OrderSide::BUY, 2.5, 50001.0, 3);
+    ioc.type = OrderType::IOC;
+    OrderHandle taker = engine->submit_order(ioc);
+    ASSERT_EQ(trades.size(), 2u);
+    EXPECT_EQ(trades[0].maker_handle, resting);
+    EXPECT_EQ(trades[0].maker_leaves, 0);
+    EXPECT_GT(trades[0].taker_leaves, 0);
+    EXPECT_EQ(trades[1].maker_handle, partly_filled);
+    EXPECT_GT(trades[1].maker_leaves, 0);
+    EXPECT_EQ(trades[1].taker_leaves, 0);
+    EXPECT_EQ(closed, (std::vector<OrderHandle>{taker}));
+
+    closed.clear();
+    EXPECT_TRUE(engine->cancel_order("BTC-USDT", partly_filled));
+    EXPECT_FALSE(engine->cancel_order("BTC-USDT", partly_filled));
+    Order quote = make_limit_order("4", "ETH-USDT", OrderSide::BUY, 1.0, 3000.0, 4);
+    quote.session_id = 7;
+    OrderHandle quoted = engine->submit_order(quote);
+    EXPECT_TRUE(engine->cancel_session_orders(7));
+    EXPECT_EQ(closed, (std::vector<OrderHandle>{partly_filled, quoted}));
+}
+
+TEST_F(MatchingEngineTest, TradePrintsCascadeStopOrders)
+{
+    int trades = 0;
+    engine->set_trade_callback([&trades](const Trade &) { trades++; });
+    const PriceScale &scale = engine->get_order_book("BTC-USDT")->get_scale();
+    AdvancedOrderManager &stops = engine->get_advanced_order_manager();
+
+    engine->submit_order(make_limit_order("1", "BTC-USDT", OrderSide::BUY, 1.0, 50000.0, 1));
+    engine->submit_order(make_limit_order("2", "BTC-USDT", OrderSide::BUY, 1.0, 49900.0, 2));
+    engine->submit_order(make_limit_order("3", "BTC-USDT", OrderSide::BUY, 1.0, 49800.0, 3));
+    stops.add_stop_loss("BTC-USDT", OrderSide::SELL, scale.to_lots(1.0), scale.to_ticks(49950.0));
+    stops.add_stop_loss("BTC-USDT", OrderSide::SELL, scale.to_lots(1.0), scale.to_ticks(49850.0));
+
+    engine->submit_order(make_limit_order("4", "BTC-USDT", OrderSide::SELL, 1.0, 50000.0, 4));
+    EXPECT_EQ(trades, 1);
+    EXPECT_EQ(stops.get_order_count(), 2u);
+
+    // The 49900 print fires the first stop, whose 49800 print fires the second.
+    engine->submit_order(make_limit_order("5", "BTC-USDT", OrderSide::SELL, 1.0, 49900.0, 5));
+    EXPECT_EQ(trades, 3);
+    EXPECT_EQ(stops.get_order_count(), 0u);
+    EXPECT_EQ(engine->get_order_book("BTC-USDT")->get_best_bid(), 0);
+}
+
+TEST(ShardedMatchingEngineTest, MatchesOnShardThreadsAndDispatchesTrades)
+{
+    MatchingEngine engine(2);
+    ASSERT_TRUE(engine.is_sharded());
+
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+
+    const PriceScale &btc = engine.get_order_book("BTC-USDT")->get_scale();
+    const PriceScale &eth = engine.get_order_book("ETH-USDT")->get_scale();
+
+    for (int i = 0; i < 500; ++i)
+    {
+        EXPECT_NE(engine.submit_order(Order("b" + std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                                            btc.to_lots(1.0), btc.to_ticks(50000.0), i)),
+                  INVALID_ORDER_HANDLE);
+        EXPECT_NE(engine.submit_order(Order("e" + std::to_string(i), "ETH-USDT", OrderType::LIMIT, OrderSide::SELL,
+                                            eth.to_lots(1.0), eth.to_ticks(3000.0), i)),
+                  INVALID_ORDER_HANDLE);
+    }
+    engine.submit_order(Order("bt", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                              btc.to_lots(300.0), btc.to_ticks(50000.0), 1000));
+    engine.submit_order(Order("et", "ETH-USDT", OrderType::LIMIT, OrderSide::BUY,
+                              eth.to_lots(200.0), eth.to_ticks(3000.0), 1000));
+
+    engine.wait_until_idle();
+
+    EXPECT_EQ(trades.load(), 500);
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_total_orders(), 200);
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 300);
+}
+
+TEST(ShardedMatchingEngineTest, CancelIsQueuedBehindSubmit)
+{
+    MatchingEngine engine(1);
+    engine.start();
+    const PriceScale &scale = engine.get_order_book("BTC-USDT")->get_scale();
+
+    OrderHandle handle = engine.submit_order(Order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                                                   scale.to_lots(1.0), scale.to_ticks(50000.0), 1));
+    ASSERT_NE(handle, INVALID_ORDER_HANDLE);
+    EXPECT_TRUE(engine.cancel_order("BTC-USDT", handle));
+    EXPECT_FALSE(engine.cancel_order("XRP-USDT", handle));
+
+    engine.wait_until_idle();
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_total_orders(), 0);
+}
+
+TEST(ShardedMatchingEngineTest, AmendRunsOnOwningShard)
+{
+    MatchingEngine engine(1);
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+
+    auto book = engine.get_order_book("BTC-USDT");
+    const PriceScale &scale = book->get_scale();
+    SymbolId btc = book->get_symbol_id();
+
+    engine.submit_order(Order("a", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                              scale.to_lots(1.0), scale.to_ticks(50010.0), 1));
+    OrderHandle bid = engine.submit_order(Order("b", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                                                scale.to_lots(2.0), scale.to_ticks(50000.0), 2));
+    ASSERT_NE(bid, INVALID_ORDER_HANDLE);
+
+    EXPECT_TRUE(engine.amend_order(btc, bid, scale.to_ticks(50010.0), scale.to_lots(2.0)));
+    EXPECT_FALSE(engine.amend_order(INVALID_SYMBOL_ID, bid, scale.to_ticks(50010.0), scale.to_lots(2.0)));
+    engine.wait_until_idle();
+
+    EXPECT_EQ(trades.load(), 1);
+    EXPECT_EQ(book->get_best_bid(), scale.to_ticks(50010.0));
+    EXPECT_EQ(book->get_bbo().bid_quantity, scale.to_lots(1.0));
+}
+
+TEST(ShardedMatchingEngineTest, SessionMassCancelSpansBooks)
+{
+    MatchingEngine engine(2);
+    engine.start();
+    const PriceScale &btc = engine.get_order_book("BTC-USDT")->get_scale();
+    const PriceScale &eth = engine.get_order_book("ETH-USDT")->get_scale();
+
+    std::vector<Order> quotes;
+    for (int i = 0; i < 50; ++i)
+    {
+        quotes.emplace_back("b" + std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                            btc.to_lots(1.0), btc.to_ticks(50000.0 + i), i);
+        quotes.emplace_back("e" + std::to_string(i), "ETH-USDT", OrderType::LIMIT, OrderSide::BUY,
+                            eth.to_lots(1.0), eth.to_ticks(3000.0 - i), i);
+    }
+    for (size_t i = 0; i < quotes.size(); ++i)
+    {
+        quotes[i].session_id = i < 60 ? 7 : 8;
+    }
+    engine.submit_orders(quotes);
+
+    EXPECT_TRUE(engine.cancel_session_orders(7, engine.get_symbol_id("ETH-USDT")));
+    engine.wait_until_idle();
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 20u);
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_total_orders(), 50u);
+
+    EXPECT_TRUE(engine.cancel_session_orders(7));
+    EXPECT_FALSE(engine.cancel_session_orders(7, 99));
+    engine.wait_until_idle();
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_total_orders(), 20u);
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_session_order_count(8), 20u);
+}
+
+TEST(ShardedMatchingEngineTest, SessionMassCancelSurvivesAFullQueue)
+{
+    EngineConfig config = ConfigManager::get_instance().get_engine_config();
+    EngineConfig small_queue = config;
+    small_queue.matching_queue_size = 8;
+    ConfigManager::get_instance().set_engine_config(small_queue);
+    MatchingEngine engine(1);
+    ConfigManager::get_instance().set_engine_config(config);
+    const PriceScale &scale = engine.get_order_book("BTC-USDT")->get_scale();
+
+    // Before start() nothing drains the ring, so it fills up.
+    auto quote = [&](int i)
+    {
+        Order order("q" + std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                    scale.to_lots(1.0), scale.to_ticks(50000.0 - i), i);
+        order.session_id = 5;
+        return engine.submit_order(order);
+    };
+    int queued = 0;
+    while (quote(queued) != INVALID_ORDER_HANDLE)
+    {
+        ++queued;
+    }
+    ASSERT_EQ(queued, 8);
+
+    // The disconnect's mass cancel must still run, after the quotes ahead
+    // of it and before the quote sent after it.
+    EXPECT_TRUE(engine.cancel_session_orders(5));
+    engine.start();
+    while (quote(100) == INVALID_ORDER_HANDLE)
+    {
+        std::this_thread::yield();
+    }
+    engine.wait_until_idle();
+    auto book = engine.get_order_book("BTC-USDT");
+    EXPECT_EQ(book->get_session_order_count(5), 1u);
+    EXPECT_EQ(book->get_best_bid(), scale.to_ticks(49900.0));
+}
+
+TEST(ShardedMatchingEngineTest, ExpiryRunsOnOwningShard)
+{
+    MatchingEngine engine(2);
+    engine.start();
+    const PriceScale &scale = engine.get_order_book("ETH-USDT")->get_scale();
+
+    Order order("gtt", "ETH-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(3000.0), 1);
+    order.expire_time = 4102444800000ULL;
+    ASSERT_NE(engine.submit_order(order), INVALID_ORDER_HANDLE);
 
-    EXPECT_TRUE(engine->cancel_order("BTC-USDT", "1"));
-    EXPECT_FALSE(engine->cancel_order("BTC-USDT", "nonexistent"));
-}
\ No newline at end of file
+    engine.expire_orders(4102444799999ULL);
+    engine.wait_until_idle();
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 1u);
+
+    engine.expire_orders(4102444800000ULL);
+    engine.wait_until_idle();
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 0u);
+}
+
+TEST(ShardedMatchingEngineTest, StopsTriggerOnOwningShard)
+{
+    MatchingEngine engine(2);
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+    const PriceScale &scale = engine.get_order_book("ETH-USDT")->get_scale();
+
+    engine.get_advanced_order_manager().add_stop_loss("ETH-USDT", OrderSide::BUY, scale.to_lots(1.0),
+                                                      scale.to_ticks(3010.0));
+    engine.submit_order(Order("a1", "ETH-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(1.0),
+                              scale.to_ticks(3010.0), 1));
+    engine.submit_order(Order("a2", "ETH-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(1.0),
+                              scale.to_ticks(3020.0), 2));
+    engine.submit_order(Order("b1", "ETH-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0),
+                              scale.to_ticks(3010.0), 3));
+    engine.wait_until_idle();
+
+    EXPECT_EQ(trades.load(), 2);
+    EXPECT_EQ(engine.get_advanced_order_manager().get_order_count(), 0u);
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 0u);
+}
+
+TEST_F(MatchingEngineTest, BatchSubmitAndCancel)
+{
+    std::vector<size_t> batch_sizes;
+    engine->set_trade_batch_callback([&batch_sizes](const std::vector<Trade> &trades)
+                                     { batch_sizes.push_back(trades.size()); });
+
+    std::vector<Order> quotes;
+    for (int i = 0; i < 5; ++i)
+    {
+        quotes.push_back(make_limit_order("a" + std::to_string(i), "BTC-USDT", OrderSide::SELL, 1.0, 50000.0 + i, i));
+        quotes.push_back(make_limit_order("e" + std::to_string(i), "ETH-USDT", OrderSide::BUY, 1.0, 3000.0 - i, i));
+    }
+    quotes.push_back(Order("x", "XRP-USDT", OrderType::LIMIT, OrderSide::BUY, 100, 100, 10));
+
+    std::vector<OrderHandle> handles = engine->submit_orders(quotes);
+    ASSERT_EQ(handles.size(), 11);
+    for (size_t i = 0; i < 10; ++i)
+    {
+        EXPECT_NE(handles[i], INVALID_ORDER_HANDLE);
+    }
+    EXPECT_EQ(handles[10], INVALID_ORDER_HANDLE);
+    EXPECT_EQ(engine->get_order_book("BTC-USDT")->get_total_orders(), 5);
+    EXPECT_DOUBLE_EQ(best_bid("ETH-USDT"), 3000.0);
+
+    SymbolId btc = engine->get_symbol_id("BTC-USDT");
+    SymbolId eth = engine->get_symbol_id("ETH-USDT");
+    std::vector<bool> cancelled = engine->cancel_orders({{btc, handles[0]},
+                                                         {eth, handles[1]},
+                                                         {btc, handles[1]},
+                                                         {INVALID_SYMBOL_ID, handles[2]}});
+    EXPECT_EQ(cancelled, std::vector<bool>({true, true, false, false}));
+    EXPECT_EQ(engine->get_order_book("BTC-USDT")->get_total_orders(), 4);
+
+    std::vector<Order> sweep;
+    sweep.push_back(make_limit_order("s1", "BTC-USDT", OrderSide::BUY, 2.0, 50004.0, 20));
+    sweep.push_back(make_limit_order("s2", "ETH-USDT", OrderSide::SELL, 2.0, 2990.0, 21));
+    engine->submit_orders(sweep);
+
+    ASSERT_EQ(batch_sizes.size(), 1);
+    EXPECT_EQ(batch_sizes[0], 4);
+}
+
+TEST_F(MatchingEngineTest, SymbolsInternToDenseIds)
+{
+    SymbolId btc = engine->get_symbol_id("BTC-USDT");
+    SymbolId eth = engine->get_symbol_id("ETH-USDT");
+    EXPECT_EQ(btc, 0u);
+    EXPECT_EQ(eth, 1u);
+    EXPECT_EQ(engine->get_symbol_id("XRP-USDT"), INVALID_SYMBOL_ID);
+
+    SymbolId xrp = engine->add_symbol("XRP-USDT");
+    EXPECT_EQ(xrp, 2u);
+    EXPECT_EQ(engine->add_symbol("XRP-USDT"), xrp);
+    EXPECT_EQ(engine->get_symbol_registry().name(xrp), "XRP-USDT");
+    EXPECT_EQ(engine->get_order_book(xrp)->get_symbol_id(), xrp);
+    EXPECT_EQ(engine->get_order_book(xrp), engine->get_order_book("XRP-USDT"));
+    EXPECT_EQ(engine->get_order_book(xrp + 1), nullptr);
+
+    // An order carrying only an id never touches the name lookup.
+    Order order = make_limit_order("1", "BTC-USDT", OrderSide::BUY, 1.0, 50000.0, 1);
+    order.symbol.clear();
+    order.symbol_id = btc;
+    OrderHandle handle = engine->submit_order(order);
+    ASSERT_NE(handle, INVALID_ORDER_HANDLE);
+    EXPECT_DOUBLE_EQ(best_bid("BTC-USDT"), 50000.0);
+    EXPECT_FALSE(engine->cancel_order(eth, handle));
+    EXPECT_TRUE(engine->cancel_order(btc, handle));
+}
+
+TEST_F(MatchingEngineTest, BookListenerSeesBooksAddedLater)
+{
+    // The way the market data feed uses it: a change set that grows as
+    // books arrive, with each book marking its own id.
+    DirtySet changes;
+    std::vector<SymbolId> seen;
+    engine->set_book_listener([&](OrderBook &book)
+                              {
+        seen.push_back(book.get_symbol_id());
+        changes.grow(book.get_symbol_id() + 1);
+        book.set_change_set(&changes); });
+    EXPECT_EQ(seen, (std::vector<SymbolId>{0, 1}));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        engine->add_symbol("SYM" + std::to_string(i) + "-USDT");
+    }
+    EXPECT_EQ(engine->add_symbol("SYM0-USDT"), 2u);
+    ASSERT_EQ(seen.size(), 102u);
+    EXPECT_EQ(seen.back(), 101u);
+    EXPECT_GE(changes.capacity(), 102u);
+
+    engine->submit_order(make_limit_order("1", "SYM99-USDT", OrderSide::BUY, 1.0, 10.0, 1));
+    std::vector<uint32_t> marked;
+    changes.wait_until(DirtySet::Clock::now(), marked);
+    EXPECT_EQ(marked, (std::vector<uint32_t>{101}));
+
+    engine->set_book_listener(nullptr);
+    engine->add_symbol("LATE-USDT");
+    EXPECT_EQ(seen.size(), 102u);
+    for (SymbolId id : seen)
+    {
+        engine->get_order_book(id)->set_change_set(nullptr);
+    }
+}
+
+TEST(ShardedMatchingEngineTest, BatchesRunOnOwningShard)
+{
+    MatchingEngine engine(2);
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+
+    const PriceScale &btc = engine.get_order_book("BTC-USDT")->get_scale();
+    const PriceScale &eth = engine.get_order_book("ETH-USDT")->get_scale();
+
+    std::vector<Order> quotes;
+    for (int i = 0; i < 20; ++i)
+    {
+        quotes.emplace_back("b" + std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                            btc.to_lots(1.0), btc.to_ticks(50000.0 + i), i);
+        quotes.emplace_back("e" + std::to_string(i), "ETH-USDT", OrderType::LIMIT, OrderSide::SELL,
+                            eth.to_lots(1.0), eth.to_ticks(3000.0 + i), i);
+    }
+    std::vector<OrderHandle> handles = engine.submit_orders(quotes);
+
+    std::vector<std::pair<SymbolId, OrderHandle>> cancels;
+    for (size_t i = 0; i < handles.size(); i += 3)
+    {
+        cancels.emplace_back(engine.get_symbol_id(quotes[i].symbol), handles[i]);
+    }
+    engine.cancel_orders(cancels);
+
+    engine.submit_orders({Order("tb", "BTC-USDT", OrderType::IOC, OrderSide::BUY,
+                                btc.to_lots(100.0), btc.to_ticks(60000.0), 100)});
+    engine.wait_until_idle();
+
+    EXPECT_EQ(trades.load(), 13);
+    EXPECT_EQ(engine.get_order_book("BTC-USDT")->get_total_orders(), 0);
+    EXPECT_EQ(engine.get_order_book("ETH-USDT")->get_total_orders(), 13);
+}
+
+TEST(ShardedMatchingEngineTest, SleepingDispatcherWakesForTrades)
+{
+    MatchingEngine engine(1);
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+    // Wired callbacks are frozen once the threads run.
+    engine.set_trade_callback([](const Trade &) {});
+
+    // Long enough for the dispatcher to run out of empty polls and sleep.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const PriceScale &scale = engine.get_order_book("BTC-USDT")->get_scale();
+    engine.submit_order(Order("s", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                              scale.to_lots(1.0), scale.to_ticks(50000.0), 1));
+    engine.submit_order(Order("b", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                              scale.to_lots(1.0), scale.to_ticks(50000.0), 2));
+
+    auto started = std::chrono::steady_clock::now();
+    engine.wait_until_idle();
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(50));
+    EXPECT_EQ(trades.load(), 1);
+}
+
+TEST(ShardedMatchingEngineTest, SweepLargerThanTheEventRingWakesTheDispatcher)
+{
+    EngineConfig config = ConfigManager::get_instance().get_engine_config();
+    EngineConfig small_queue = config;
+    small_queue.matching_queue_size = 8;
+    ConfigManager::get_instance().set_engine_config(small_queue);
+    MatchingEngine engine(1);
+    ConfigManager::get_instance().set_engine_config(config);
+    std::atomic<int> trades{0};
+    engine.set_trade_callback([&trades](const Trade &) { trades++; });
+    engine.start();
+    const PriceScale &scale = engine.get_order_book("BTC-USDT")->get_scale();
+
+    std::vector<Order> makers;
+    for (int i = 0; i < 40; ++i)
+    {
+        makers.emplace_back("m" + std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                            scale.to_lots(1.0), scale.to_ticks(50000.0 + i), i);
+    }
+    engine.submit_orders(makers);
+    engine.wait_until_idle();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // One command whose trades overflow the outbound ring.
+    engine.submit_order(Order("t", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                              scale.to_lots(40.0), scale.to_ticks(50100.0), 100));
+    auto started = std::chrono::steady_clock::now();
+    engine.wait_until_idle();
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(50));
+    EXPECT_EQ(trades.load(), 40);
+}
+
+TEST(ShardedMatchingEngineTest, OrderEventsFollowTheirTrades)
+{
+    MatchingEngine engine(1);
+    std::vector<std::pair<char, OrderHandle>> events;
+    std::mutex events_mutex;
+    engine.set_trade_callback([&](const Trade &trade)
+                              {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.emplace_back('T', trade.taker_handle); });
+    engine.set_order_event_callback([&](const EngineEvent &event)
+                                    {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.emplace_back('C', event.handle); });
+    engine.start();
+
+    const PriceScale &scale = engine.get_order_book("BTC-USDT")->get_scale();
+    OrderHandle ask = engine.submit_order(Order("a", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                                                scale.to_lots(2.0), scale.to_ticks(50000.0), 1));
+    OrderHandle ioc = engine.submit_order(Order("i", "BTC-USDT", OrderType::IOC, OrderSide::BUY,
+                                                scale.to_lots(1.0), scale.to_ticks(50000.0), 2));
+    engine.cancel_order("BTC-USDT", ask);
+    engine.wait_until_idle();
+
+    std::vector<std::pair<char, OrderHandle>> expected{{'T', ioc}, {'C', ioc}, {'C', ask}};
+    EXPECT_EQ(events, expected);
+}
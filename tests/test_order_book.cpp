@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include "../include/core/order_book.hpp"
 #include "../include/core/order_types.hpp"
+#include "../include/core/fixed_point.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 using namespace GoQuant;
 
@@ -9,97 +13,889 @@ class OrderBookTest : public ::testing::Test
 protected:
     void SetUp() override
     {
-        book = std::make_unique<OrderBook>("BTC-USDT");
+        book = std::make_unique<OrderBook>("BTC-USDT", scale);
     }
 
+    PriceScale scale{0.01, 0.0001};
     std::unique_ptr<OrderBook> book;
 };
 
 TEST_F(OrderBookTest, AddLimitOrder)
 {
-    Order order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1234567890);
+    Order order("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567890);
+    order.handle = 1;
     std::vector<Trade> trades;
 
     EXPECT_TRUE(book->add_order(order, trades));
     EXPECT_EQ(order.status, OrderStatus::ACTIVE);
     EXPECT_TRUE(trades.empty());
-    EXPECT_DOUBLE_EQ(book->get_best_bid(), 50000.0);
+    EXPECT_EQ(book->get_best_bid(), scale.to_ticks(50000.0));
 }
 
 TEST_F(OrderBookTest, BasicMatching)
 {
-    Order buy("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1234567890);
+    Order buy("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567890);
+    buy.handle = 1;
     std::vector<Trade> trades1;
     book->add_order(buy, trades1);
 
-    Order sell("2", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 1.0, 50000.0, 1234567891);
+    Order sell("2", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567891);
+    sell.handle = 2;
     std::vector<Trade> trades2;
     book->add_order(sell, trades2);
 
     EXPECT_EQ(trades2.size(), 1);
-    EXPECT_DOUBLE_EQ(trades2[0].price, 50000.0);
-    EXPECT_DOUBLE_EQ(trades2[0].quantity, 1.0);
+    EXPECT_EQ(trades2[0].price, scale.to_ticks(50000.0));
+    EXPECT_EQ(trades2[0].quantity, scale.to_lots(1.0));
     EXPECT_EQ(sell.status, OrderStatus::FILLED);
 }
 
 TEST_F(OrderBookTest, PriceTimePriority)
 {
-    Order buy1("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1000);
-    Order buy2("2", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1.0, 50000.0, 1001);
+    Order buy1("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1000);
+    buy1.handle = 1;
+    Order buy2("2", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1001);
+    buy2.handle = 2;
     std::vector<Trade> trades1, trades2;
     book->add_order(buy1, trades1);
     book->add_order(buy2, trades2);
 
-    Order sell("3", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 1.0, 50000.0, 1002);
+    Order sell("3", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(1.0), scale.to_ticks(50000.0), 1002);
+    sell.handle = 3;
     std::vector<Trade> trades3;
     book->add_order(sell, trades3);
 
-    EXPECT_EQ(trades3.size(), 1);
-    EXPECT_EQ(trades3[0].maker_order_id, "1");
-    EXPECT_EQ(buy1.status, OrderStatus::FILLED);
-    EXPECT_EQ(buy2.status, OrderStatus::ACTIVE);
+    ASSERT_EQ(trades3.size(), 1);
+    EXPECT_EQ(trades3[0].maker_handle, 1);
+    EXPECT_EQ(trades3[0].quantity, scale.to_lots(1.0));
+
+    // buy1 and buy2 are the callers' copies; the resting state lives in the book.
+    Order resting;
+    EXPECT_FALSE(book->get_order(1, resting));
+    ASSERT_TRUE(book->get_order(2, resting));
+    EXPECT_EQ(resting.status, OrderStatus::ACTIVE);
+    EXPECT_EQ(resting.leaves_quantity, scale.to_lots(1.0));
 }
 
 TEST_F(OrderBookTest, MarketOrder)
 {
-    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 1.0, 50000.0, 1234567890);
+    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567890);
+    sell.handle = 1;
     std::vector<Trade> trades1;
     book->add_order(sell, trades1);
 
-    Order market_buy("2", "BTC-USDT", OrderType::MARKET, OrderSide::BUY, 1.0, 0.0, 1234567891);
+    Order market_buy("2", "BTC-USDT", OrderType::MARKET, OrderSide::BUY, scale.to_lots(1.0), 0, 1234567891);
+    market_buy.handle = 2;
     std::vector<Trade> trades2;
     book->add_order(market_buy, trades2);
 
     EXPECT_EQ(trades2.size(), 1);
-    EXPECT_DOUBLE_EQ(trades2[0].price, 50000.0);
+    EXPECT_EQ(trades2[0].price, scale.to_ticks(50000.0));
     EXPECT_EQ(market_buy.status, OrderStatus::FILLED);
 }
 
 TEST_F(OrderBookTest, IOCOrder)
 {
-    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 0.5, 50000.0, 1234567890);
+    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(0.5), scale.to_ticks(50000.0), 1234567890);
+    sell.handle = 1;
     std::vector<Trade> trades1;
     book->add_order(sell, trades1);
 
-    Order ioc_buy("2", "BTC-USDT", OrderType::IOC, OrderSide::BUY, 1.0, 50000.0, 1234567891);
+    Order ioc_buy("2", "BTC-USDT", OrderType::IOC, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567891);
+    ioc_buy.handle = 2;
     std::vector<Trade> trades2;
     book->add_order(ioc_buy, trades2);
 
     EXPECT_EQ(trades2.size(), 1);
-    EXPECT_DOUBLE_EQ(trades2[0].quantity, 0.5);
+    EXPECT_EQ(trades2[0].quantity, scale.to_lots(0.5));
     EXPECT_EQ(ioc_buy.status, OrderStatus::PARTIALLY_FILLED);
 }
 
 TEST_F(OrderBookTest, FOKOrder)
 {
-    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 0.5, 50000.0, 1234567890);
+    Order sell("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(0.5), scale.to_ticks(50000.0), 1234567890);
+    sell.handle = 1;
     std::vector<Trade> trades1;
     book->add_order(sell, trades1);
 
-    Order fok_buy("2", "BTC-USDT", OrderType::FOK, OrderSide::BUY, 1.0, 50000.0, 1234567891);
+    Order fok_buy("2", "BTC-USDT", OrderType::FOK, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 1234567891);
+    fok_buy.handle = 2;
     std::vector<Trade> trades2;
     book->add_order(fok_buy, trades2);
 
+    // An FOK that cannot fill in full is refused before it touches the book.
     EXPECT_TRUE(trades2.empty());
-    EXPECT_EQ(fok_buy.status, OrderStatus::CANCELLED);
-}
\ No newline at end of file
+    EXPECT_EQ(fok_buy.status, OrderStatus::REJECTED);
+    EXPECT_EQ(book->get_best_ask(), scale.to_ticks(50000.0));
+}
+
+TEST_F(OrderBookTest, EverySideAndTypeStopsAtItsLimit)
+{
+    OrderHandle next_handle = 1;
+    auto order = [&](OrderType type, OrderSide side, double qty, double px)
+    {
+        Order o(std::to_string(next_handle), "BTC-USDT", type, side, scale.to_lots(qty),
+                type == OrderType::MARKET ? 0 : scale.to_ticks(px), next_handle);
+        o.handle = next_handle++;
+        return o;
+    };
+
+    for (OrderSide taker_side : {OrderSide::BUY, OrderSide::SELL})
+    {
+        book = std::make_unique<OrderBook>("BTC-USDT", scale);
+        OrderSide maker_side = taker_side == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY;
+        double dir = taker_side == OrderSide::BUY ? 1.0 : -1.0;
+        std::vector<Trade> trades;
+
+        // Two makers at the touch, one a tick behind it, one two ticks behind.
+        for (double offset : {0.0, 0.0, 1.0, 2.0})
+        {
+            Order maker = order(OrderType::LIMIT, maker_side, 1.0, 100.0 + dir * offset);
+            ASSERT_TRUE(book->add_order(maker, trades));
+        }
+        ASSERT_TRUE(trades.empty());
+
+        Order fok = order(OrderType::FOK, taker_side, 3.5, 100.0 + dir);
+        book->add_order(fok, trades);
+        EXPECT_EQ(fok.status, OrderStatus::REJECTED);
+        EXPECT_TRUE(trades.empty());
+
+        Order ioc = order(OrderType::IOC, taker_side, 1.5, 100.0);
+        book->add_order(ioc, trades);
+        EXPECT_EQ(trades.size(), 2u);
+        EXPECT_EQ(ioc.leaves_quantity, 0);
+
+        Order limit = order(OrderType::LIMIT, taker_side, 2.0, 100.0 + dir);
+        trades.clear();
+        book->add_order(limit, trades);
+        ASSERT_EQ(trades.size(), 2u);
+        EXPECT_EQ(trades[0].price, scale.to_ticks(100.0));
+        EXPECT_EQ(trades[0].quantity, scale.to_lots(0.5));
+        EXPECT_EQ(trades[1].price, scale.to_ticks(100.0 + dir));
+        EXPECT_EQ(limit.leaves_quantity, scale.to_lots(0.5));
+        BBO bbo = book->get_bbo();
+        EXPECT_EQ(taker_side == OrderSide::BUY ? bbo.bid_price : bbo.ask_price, scale.to_ticks(100.0 + dir));
+
+        Order market = order(OrderType::MARKET, taker_side, 5.0, 0.0);
+        trades.clear();
+        book->add_order(market, trades);
+        ASSERT_EQ(trades.size(), 1u);
+        EXPECT_EQ(trades[0].price, scale.to_ticks(100.0 + 2 * dir));
+        EXPECT_EQ(market.leaves_quantity, scale.to_lots(4.0));
+        EXPECT_EQ(book->get_total_orders(), 1u);
+    }
+}
+
+TEST_F(OrderBookTest, TradeRecordsCarryIdsAndHandles)
+{
+    std::vector<Trade> trades;
+    for (int i = 1; i <= 3; ++i)
+    {
+        Order ask(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 10, 5000000 + i, i);
+        ask.handle = i;
+        book->add_order(ask, trades);
+    }
+    Order sweep("4", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 30, 5000003, 4);
+    sweep.handle = 4;
+    book->add_order(sweep, trades);
+
+    ASSERT_EQ(trades.size(), 3);
+    for (size_t i = 0; i < trades.size(); ++i)
+    {
+        EXPECT_EQ(trades[i].trade_id, i + 1);
+        EXPECT_EQ(trades[i].maker_handle, i + 1);
+        EXPECT_EQ(trades[i].taker_handle, 4);
+        EXPECT_EQ(trades[i].symbol_id, book->get_symbol_id());
+        EXPECT_FALSE(trades[i].is_buyer_maker);
+    }
+}
+
+TEST_F(OrderBookTest, FixedPointLevelIdentity)
+{
+    Order buy1("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(0.1), scale.to_ticks(0.1 + 0.2), 1000);
+    buy1.handle = 1;
+    Order buy2("2", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, scale.to_lots(0.2), scale.to_ticks(0.3), 1001);
+    buy2.handle = 2;
+    std::vector<Trade> trades;
+    book->add_order(buy1, trades);
+    book->add_order(buy2, trades);
+
+    auto levels = book->get_bid_levels();
+    ASSERT_EQ(levels.size(), 1);
+    EXPECT_EQ(levels[0].first, 30);
+    EXPECT_EQ(levels[0].second, scale.to_lots(0.3));
+}
+
+TEST_F(OrderBookTest, CancelFromMiddleOfQueueKeepsFifo)
+{
+    std::vector<Trade> trades;
+    for (int i = 1; i <= 5; ++i)
+    {
+        Order buy(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000, i);
+        buy.handle = i;
+        book->add_order(buy, trades);
+    }
+
+    EXPECT_TRUE(book->cancel_order(3));
+    EXPECT_FALSE(book->cancel_order(3));
+    EXPECT_TRUE(book->cancel_order(1));
+    EXPECT_TRUE(book->modify_order(4, 5));
+    EXPECT_EQ(book->get_total_orders(), 3);
+    EXPECT_EQ(book->get_bid_levels()[0].second, 25);
+
+    Order sell("6", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 25, 5000000, 6);
+    sell.handle = 6;
+    book->add_order(sell, trades);
+
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].maker_handle, 2);
+    EXPECT_EQ(trades[1].maker_handle, 4);
+    EXPECT_EQ(trades[2].maker_handle, 5);
+    EXPECT_EQ(book->get_total_orders(), 0);
+    EXPECT_EQ(book->get_best_bid(), 0);
+}
+
+TEST_F(OrderBookTest, LevelAggregatesFollowFillsModifiesAndCancels)
+{
+    std::vector<Trade> trades;
+    for (int i = 1; i <= 3; ++i)
+    {
+        Order ask(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 10 * i, 5000000, i);
+        ask.handle = i;
+        book->add_order(ask, trades);
+    }
+    EXPECT_EQ(book->get_ask_levels()[0].second, 60);
+
+    Order buy("4", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 15, 5000000, 4);
+    buy.handle = 4;
+    book->add_order(buy, trades);
+    EXPECT_EQ(book->get_ask_levels()[0].second, 45);
+
+    EXPECT_TRUE(book->modify_order(2, 25));
+    EXPECT_EQ(book->get_ask_levels()[0].second, 50);
+
+    EXPECT_TRUE(book->modify_order(2, 5));
+    EXPECT_EQ(book->get_total_orders(), 1);
+    EXPECT_EQ(book->get_ask_levels()[0].second, 30);
+
+    Order fok("5", "BTC-USDT", OrderType::FOK, OrderSide::BUY, 31, 5000000, 5);
+    fok.handle = 5;
+    book->add_order(fok, trades);
+    EXPECT_EQ(book->get_ask_levels()[0].second, 30);
+
+    EXPECT_TRUE(book->cancel_order(3));
+    EXPECT_TRUE(book->get_ask_levels().empty());
+}
+
+TEST_F(OrderBookTest, RestingOrderViewJoinsHotAndColdData)
+{
+    Order maker("client-7", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, scale.to_lots(3.0), scale.to_ticks(50000.0), 777);
+    maker.handle = 7;
+    std::vector<Trade> trades;
+    ASSERT_TRUE(book->add_order(maker, trades));
+
+    Order taker("t", "BTC-USDT", OrderType::IOC, OrderSide::BUY, scale.to_lots(1.0), scale.to_ticks(50000.0), 778);
+    taker.handle = 8;
+    book->add_order(taker, trades);
+    ASSERT_EQ(trades.size(), 1u);
+
+    Order view;
+    ASSERT_TRUE(book->get_order(7, view));
+    EXPECT_EQ(view.handle, 7u);
+    EXPECT_EQ(view.symbol, "BTC-USDT");
+    EXPECT_EQ(view.type, OrderType::LIMIT);
+    EXPECT_EQ(view.side, OrderSide::SELL);
+    EXPECT_EQ(view.price, scale.to_ticks(50000.0));
+    EXPECT_EQ(view.timestamp, 777u);
+    EXPECT_EQ(view.quantity, scale.to_lots(3.0));
+    EXPECT_EQ(view.filled_quantity, scale.to_lots(1.0));
+    EXPECT_EQ(view.leaves_quantity, scale.to_lots(2.0));
+    EXPECT_EQ(view.status, OrderStatus::PARTIALLY_FILLED);
+
+    // Shrinking below what has already filled is refused; otherwise the
+    // filled amount carries over.
+    EXPECT_FALSE(book->modify_order(7, scale.to_lots(0.5)));
+    EXPECT_TRUE(book->modify_order(7, scale.to_lots(1.5)));
+    ASSERT_TRUE(book->get_order(7, view));
+    EXPECT_EQ(view.quantity, scale.to_lots(1.5));
+    EXPECT_EQ(view.filled_quantity, scale.to_lots(1.0));
+    EXPECT_EQ(view.leaves_quantity, scale.to_lots(0.5));
+
+    EXPECT_TRUE(book->cancel_order(7));
+    EXPECT_FALSE(book->get_order(7, view));
+    EXPECT_EQ(book->get_order_pool_stats().in_use, 0u);
+}
+
+TEST_F(OrderBookTest, AmendKeepsPriorityOnlyOnSizeDown)
+{
+    std::vector<Trade> trades;
+    for (int i = 1; i <= 3; ++i)
+    {
+        Order bid(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000, i);
+        bid.handle = i;
+        book->add_order(bid, trades);
+    }
+
+    // Size-down in place: 1 stays at the front.
+    EXPECT_TRUE(book->amend_order(1, 5000000, 6, trades));
+    // Size-up at the same price: 2 moves behind 3.
+    EXPECT_TRUE(book->amend_order(2, 5000000, 12, trades));
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(book->get_bid_levels()[0].second, 28);
+
+    Order sell("4", "BTC-USDT", OrderType::IOC, OrderSide::SELL, 28, 5000000, 4);
+    sell.handle = 4;
+    book->add_order(sell, trades);
+    ASSERT_EQ(trades.size(), 3u);
+    EXPECT_EQ(trades[0].maker_handle, 1u);
+    EXPECT_EQ(trades[1].maker_handle, 3u);
+    EXPECT_EQ(trades[2].maker_handle, 2u);
+    EXPECT_EQ(trades[2].quantity, 12);
+    EXPECT_EQ(book->get_total_orders(), 0u);
+}
+
+TEST_F(OrderBookTest, AmendRepriceCrossesAndRestsRemainder)
+{
+    std::vector<Trade> trades;
+    Order ask("1", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 4, 5000100, 1);
+    ask.handle = 1;
+    book->add_order(ask, trades);
+    Order bid("2", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000, 2);
+    bid.handle = 2;
+    book->add_order(bid, trades);
+
+    // Repricing through the ask trades under the same handle and rests the rest.
+    EXPECT_TRUE(book->amend_order(2, 5000100, 10, trades));
+    ASSERT_EQ(trades.size(), 1u);
+    EXPECT_EQ(trades[0].maker_handle, 1u);
+    EXPECT_EQ(trades[0].taker_handle, 2u);
+    EXPECT_EQ(trades[0].price, 5000100);
+    EXPECT_EQ(book->get_best_bid(), 5000100);
+    EXPECT_EQ(book->get_best_ask(), 0);
+
+    Order view;
+    ASSERT_TRUE(book->get_order(2, view));
+    EXPECT_EQ(view.filled_quantity, 4);
+    EXPECT_EQ(view.leaves_quantity, 6);
+    EXPECT_EQ(view.status, OrderStatus::PARTIALLY_FILLED);
+
+    // Below the filled quantity is refused; equal to it retires the order.
+    EXPECT_FALSE(book->amend_order(2, 5000100, 3, trades));
+    EXPECT_FALSE(book->amend_order(99, 5000100, 10, trades));
+    EXPECT_TRUE(book->amend_order(2, 5000000, 4, trades));
+    EXPECT_FALSE(book->get_order(2, view));
+    EXPECT_EQ(book->get_best_bid(), 0);
+}
+
+TEST_F(OrderBookTest, SessionMassCancelBySide)
+{
+    std::vector<Trade> trades;
+    OrderHandle next_handle = 1;
+    for (SessionId session : {1u, 2u})
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            Order bid("b", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000 - i, 0);
+            bid.handle = next_handle++;
+            bid.session_id = session;
+            book->add_order(bid, trades);
+            Order ask("a", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 10, 5000100 + i, 0);
+            ask.handle = next_handle++;
+            ask.session_id = session;
+            book->add_order(ask, trades);
+        }
+    }
+    Order anonymous("x", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000, 0);
+    anonymous.handle = next_handle++;
+    book->add_order(anonymous, trades);
+
+    EXPECT_EQ(book->get_session_order_count(1), 8u);
+    EXPECT_EQ(book->cancel_session_orders(1, OrderSide::SELL), 4u);
+    EXPECT_EQ(book->get_session_order_count(1), 4u);
+    EXPECT_EQ(book->get_ask_levels()[0].second, 10);
+
+    // A fill retires the order from its session too.
+    Order taker("t", "BTC-USDT", OrderType::IOC, OrderSide::SELL, 30, 5000000, 0);
+    taker.handle = next_handle++;
+    book->add_order(taker, trades);
+    EXPECT_EQ(book->get_session_order_count(1), 3u);
+
+    EXPECT_EQ(book->cancel_session_orders(1), 3u);
+    EXPECT_EQ(book->cancel_session_orders(1), 0u);
+    EXPECT_EQ(book->get_session_order_count(2), 7u);
+    EXPECT_EQ(book->get_total_orders(), 7u);
+    EXPECT_EQ(book->cancel_session_orders(INVALID_SESSION_ID), 0u);
+}
+
+TEST_F(OrderBookTest, SessionsComeAndGo)
+{
+    std::vector<Trade> trades;
+    OrderHandle next_handle = 1;
+    auto rest = [&](SessionId session)
+    {
+        Order bid("b", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000 - next_handle, 0);
+        bid.handle = next_handle++;
+        bid.session_id = session;
+        book->add_order(bid, trades);
+        return bid.handle;
+    };
+
+    // Far more sessions than ever rest at once, each leaving before the
+    // next arrives, with one long-lived session throughout.
+    rest(3);
+    for (SessionId session = 4; session < 2000; ++session)
+    {
+        OrderHandle handle = rest(session);
+        EXPECT_EQ(book->get_session_order_count(session), 1u);
+        EXPECT_TRUE(book->cancel_order(handle));
+        EXPECT_EQ(book->get_session_order_count(session), 0u);
+    }
+    EXPECT_EQ(book->get_session_order_count(3), 1u);
+
+    // Ids that share a probe run; removing the middle one must not hide
+    // the one after it.
+    for (SessionId session : {100u, 116u, 132u, 101u})
+    {
+        rest(session);
+    }
+    EXPECT_EQ(book->cancel_session_orders(116), 1u);
+    EXPECT_EQ(book->get_session_order_count(132), 1u);
+    EXPECT_EQ(book->get_session_order_count(101), 1u);
+    EXPECT_EQ(book->cancel_session_orders(132), 1u);
+    EXPECT_EQ(book->cancel_session_orders(100), 1u);
+    EXPECT_EQ(book->get_session_order_count(101), 1u);
+    EXPECT_EQ(book->get_total_orders(), 2u);
+}
+
+TEST_F(OrderBookTest, ExpiresGoodTillTimeOrders)
+{
+    std::vector<Trade> trades;
+    uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+
+    for (int i = 1; i <= 3; ++i)
+    {
+        Order bid(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000 - i, 0);
+        bid.handle = i;
+        bid.expire_time = i == 3 ? 0 : now_ms + 1000 * i;
+        book->add_order(bid, trades);
+    }
+    EXPECT_EQ(book->get_pending_expiry_count(), 2u);
+
+    // A filled or amended order leaves or re-files its timer.
+    Order taker("t", "BTC-USDT", OrderType::IOC, OrderSide::SELL, 10, 4999999, 0);
+    taker.handle = 4;
+    book->add_order(taker, trades);
+    EXPECT_EQ(book->get_pending_expiry_count(), 1u);
+    EXPECT_TRUE(book->amend_order(2, 4999990, 10, trades));
+    EXPECT_EQ(book->get_pending_expiry_count(), 1u);
+
+    EXPECT_EQ(book->expire_orders(now_ms + 1999), 0u);
+    EXPECT_EQ(book->expire_orders(now_ms + 2000), 1u);
+    EXPECT_EQ(book->get_total_orders(), 1u);
+    EXPECT_EQ(book->get_best_bid(), 4999997);
+    EXPECT_EQ(book->get_pending_expiry_count(), 0u);
+}
+
+TEST_F(OrderBookTest, BBOPublishesOnTouchChangesOnly)
+{
+    std::vector<Trade> trades;
+    EXPECT_EQ(book->get_bbo().sequence, 0);
+
+    Order bid("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 4999900, 1);
+    bid.handle = 1;
+    book->add_order(bid, trades);
+    Order ask("2", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 20, 5000100, 2);
+    ask.handle = 2;
+    book->add_order(ask, trades);
+
+    BBO bbo = book->get_bbo();
+    EXPECT_EQ(bbo.bid_price, 4999900);
+    EXPECT_EQ(bbo.bid_quantity, 10);
+    EXPECT_EQ(bbo.ask_price, 5000100);
+    EXPECT_EQ(bbo.ask_quantity, 20);
+    EXPECT_EQ(bbo.sequence, 2);
+
+    Order deep("3", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 5, 4999000, 3);
+    deep.handle = 3;
+    book->add_order(deep, trades);
+    EXPECT_EQ(book->get_bbo().sequence, 2);
+
+    EXPECT_TRUE(book->cancel_order(1));
+    bbo = book->get_bbo();
+    EXPECT_EQ(bbo.bid_price, 4999000);
+    EXPECT_EQ(bbo.bid_quantity, 5);
+    EXPECT_EQ(bbo.sequence, 3);
+}
+
+TEST_F(OrderBookTest, DepthDeltasCollapseChangesBetweenDrains)
+{
+    std::vector<Trade> trades;
+    std::vector<LevelDelta> deltas;
+    book->enable_depth_tracking();
+
+    Order bid("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 4999900, 1);
+    bid.handle = 1;
+    book->add_order(bid, trades);
+    Order ask("2", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 20, 5000100, 2);
+    ask.handle = 2;
+    book->add_order(ask, trades);
+
+    EXPECT_EQ(book->drain_depth_changes(deltas), 1u);
+    ASSERT_EQ(deltas.size(), 2u);
+    for (const LevelDelta &delta : deltas)
+    {
+        EXPECT_EQ(delta.action, LevelAction::ADD);
+        EXPECT_EQ(delta.quantity, delta.side == OrderSide::BUY ? 10 : 20);
+    }
+
+    // A level added and removed between drains, and one sized down and
+    // back up, report nothing; a partial fill reports the new total.
+    Order flash("3", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 5, 4999000, 3);
+    flash.handle = 3;
+    book->add_order(flash, trades);
+    book->cancel_order(3);
+    book->modify_order(1, 4);
+    Order top_up("4", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 6, 4999900, 4);
+    top_up.handle = 4;
+    book->add_order(top_up, trades);
+    Order taker("5", "BTC-USDT", OrderType::IOC, OrderSide::BUY, 5, 5000100, 5);
+    taker.handle = 5;
+    book->add_order(taker, trades);
+
+    EXPECT_EQ(book->drain_depth_changes(deltas), 2u);
+    ASSERT_EQ(deltas.size(), 1u);
+    EXPECT_EQ(deltas[0].side, OrderSide::SELL);
+    EXPECT_EQ(deltas[0].action, LevelAction::UPDATE);
+    EXPECT_EQ(deltas[0].quantity, 15);
+
+    EXPECT_EQ(book->drain_depth_changes(deltas), 2u);
+    EXPECT_TRUE(deltas.empty());
+
+    book->cancel_order(2);
+    EXPECT_EQ(book->drain_depth_changes(deltas), 3u);
+    ASSERT_EQ(deltas.size(), 1u);
+    EXPECT_EQ(deltas[0].action, LevelAction::DELETE);
+    EXPECT_EQ(deltas[0].price, 5000100);
+    EXPECT_EQ(deltas[0].quantity, 0);
+
+    std::vector<std::pair<Price, Quantity>> bids, asks;
+    EXPECT_EQ(book->get_depth_snapshot(bids, asks), 3u);
+    ASSERT_EQ(bids.size(), 1u);
+    EXPECT_EQ(bids[0], std::make_pair(Price(4999900), Quantity(10)));
+    EXPECT_TRUE(asks.empty());
+
+    // A level emptied and recreated at the same price between drains
+    // reports one update against its quantity at the last drain.
+    book->cancel_order(1);
+    book->cancel_order(4);
+    Order rebid("6", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 7, 4999900, 6);
+    rebid.handle = 6;
+    book->add_order(rebid, trades);
+    EXPECT_EQ(book->drain_depth_changes(deltas), 4u);
+    ASSERT_EQ(deltas.size(), 1u);
+    EXPECT_EQ(deltas[0].action, LevelAction::UPDATE);
+    EXPECT_EQ(deltas[0].price, 4999900);
+    EXPECT_EQ(deltas[0].quantity, 7);
+}
+
+TEST_F(OrderBookTest, DepthSnapshotIsTheBookAtItsSequence)
+{
+    std::vector<Trade> trades;
+    std::vector<LevelDelta> deltas;
+    std::vector<std::pair<Price, Quantity>> bids, asks;
+    book->enable_depth_tracking();
+
+    Order bid("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 4999900, 1);
+    bid.handle = 1;
+    book->add_order(bid, trades);
+    EXPECT_EQ(book->drain_depth_changes(deltas), 1u);
+
+    // X -> Y, snapshot, Y -> X. The snapshot must still show X: the drain
+    // after it sees no net change and sends nothing.
+    Order join("2", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 5, 4999900, 2);
+    join.handle = 2;
+    book->add_order(join, trades);
+    Order ask("3", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 20, 5000100, 3);
+    ask.handle = 3;
+    book->add_order(ask, trades);
+
+    EXPECT_EQ(book->get_depth_snapshot(bids, asks), 1u);
+    ASSERT_EQ(bids.size(), 1u);
+    EXPECT_EQ(bids[0], std::make_pair(Price(4999900), Quantity(10)));
+    EXPECT_TRUE(asks.empty());
+
+    book->cancel_order(2);
+    EXPECT_EQ(book->drain_depth_changes(deltas), 2u);
+    ASSERT_EQ(deltas.size(), 1u);
+    EXPECT_EQ(deltas[0].side, OrderSide::SELL);
+    EXPECT_EQ(deltas[0].action, LevelAction::ADD);
+
+    EXPECT_EQ(book->get_depth_snapshot(bids, asks), 2u);
+    ASSERT_EQ(bids.size(), 1u);
+    EXPECT_EQ(bids[0], std::make_pair(Price(4999900), Quantity(10)));
+    ASSERT_EQ(asks.size(), 1u);
+    EXPECT_EQ(asks[0], std::make_pair(Price(5000100), Quantity(20)));
+}
+
+TEST_F(OrderBookTest, MarksItsSymbolWhenTouchOrDepthMoves)
+{
+    std::vector<Trade> trades;
+    std::vector<LevelDelta> deltas;
+    std::vector<uint32_t> marked;
+    DirtySet changes(1);
+    book->enable_depth_tracking();
+    book->set_change_set(&changes);
+
+    auto take = [&]
+    {
+        marked.clear();
+        changes.wait_until(DirtySet::Clock::now(), marked);
+        return marked.size();
+    };
+
+    Order bid("1", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 4999900, 1);
+    bid.handle = 1;
+    book->add_order(bid, trades);
+    Order ask("2", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 20, 5000100, 2);
+    ask.handle = 2;
+    book->add_order(ask, trades);
+    EXPECT_EQ(take(), 1u);
+    EXPECT_EQ(marked[0], 0u);
+
+    // Nothing moved since the drain: a rejected cancel marks nothing.
+    book->drain_depth_changes(deltas);
+    EXPECT_FALSE(book->cancel_order(99));
+    EXPECT_EQ(take(), 0u);
+
+    // A level behind the touch is a depth-only change.
+    Order deep("3", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 5, 4999000, 3);
+    deep.handle = 3;
+    book->add_order(deep, trades);
+    EXPECT_EQ(take(), 1u);
+
+    book->drain_depth_changes(deltas);
+    book->set_change_set(nullptr);
+    book->cancel_order(1);
+    EXPECT_EQ(take(), 0u);
+}
+
+TEST_F(OrderBookTest, BBOReadersSeeConsistentSnapshots)
+{
+    std::atomic<bool> done{false};
+    std::atomic<bool> torn{false};
+    std::thread reader([&]()
+                       {
+        uint64_t last_sequence = 0;
+        while (!done.load())
+        {
+            BBO bbo = book->get_bbo();
+            if (bbo.sequence < last_sequence ||
+                (bbo.bid_price != 0 && bbo.bid_quantity != bbo.bid_price - 4990000) ||
+                (bbo.ask_price != 0 && bbo.ask_quantity != bbo.ask_price - 5000000))
+            {
+                torn = true;
+            }
+            last_sequence = bbo.sequence;
+        } });
+
+    std::vector<Trade> trades;
+    for (int i = 1; i <= 2000; ++i)
+    {
+        Price bid_price = 4990000 + 1 + (i % 97);
+        Order bid(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY,
+                  bid_price - 4990000, bid_price, i);
+        bid.handle = i;
+        book->add_order(bid, trades);
+        Price ask_price = 5000000 + 1 + (i % 89);
+        Order ask(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::SELL,
+                  ask_price - 5000000, ask_price, i);
+        ask.handle = 10000 + i;
+        book->add_order(ask, trades);
+        book->cancel_order(i);
+        book->cancel_order(10000 + i);
+    }
+
+    done = true;
+    reader.join();
+    EXPECT_FALSE(torn.load());
+    EXPECT_GT(book->get_bbo().sequence, 2000);
+}
+
+TEST_F(OrderBookTest, PoolsRecycleOrdersAndLevels)
+{
+    OrderBook pooled("BTC-USDT", scale, LadderType::MAP, 8, 4);
+    std::vector<Trade> trades;
+
+    for (int round = 0; round < 100; ++round)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            Order buy(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000 - (i % 4), i);
+            buy.handle = round * 8 + i + 1;
+            pooled.add_order(buy, trades);
+        }
+        for (int i = 0; i < 8; ++i)
+        {
+            pooled.cancel_order(round * 8 + i + 1);
+        }
+    }
+
+    PoolStats orders = pooled.get_order_pool_stats();
+    PoolStats levels = pooled.get_level_pool_stats();
+    EXPECT_EQ(orders.in_use, 0);
+    EXPECT_EQ(orders.capacity, 8);
+    EXPECT_EQ(orders.high_water_mark, 8);
+    EXPECT_EQ(levels.in_use, 0);
+    EXPECT_EQ(levels.capacity, 4);
+    EXPECT_EQ(levels.high_water_mark, 4);
+
+    for (int i = 0; i < 9; ++i)
+    {
+        Order buy(std::to_string(i), "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 10, 5000000, i);
+        buy.handle = 1000 + i;
+        pooled.add_order(buy, trades);
+    }
+    EXPECT_EQ(pooled.get_order_pool_stats().capacity, 16);
+    EXPECT_EQ(pooled.get_order_pool_stats().high_water_mark, 9);
+}
+
+class DenseOrderBookTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        book = std::make_unique<OrderBook>("BTC-USDT", scale, LadderType::DENSE);
+    }
+
+    Order limit(const std::string &id, OrderSide side, Quantity qty, Price price)
+    {
+        Order order(id, "BTC-USDT", OrderType::LIMIT, side, qty, price, 0);
+        order.handle = ++next_handle;
+        return order;
+    }
+
+    OrderHandle next_handle = 0;
+
+    PriceScale scale{0.01, 0.0001};
+    std::unique_ptr<OrderBook> book;
+};
+
+TEST_F(DenseOrderBookTest, FarLevelsSpillAndKeepPriority)
+{
+    std::vector<Trade> trades;
+    Order near = limit("1", OrderSide::BUY, 10, 5000000);
+    Order far = limit("2", OrderSide::BUY, 20, 5000000 - 100000);
+    Order better = limit("3", OrderSide::BUY, 30, 5000000 + 100000);
+    book->add_order(near, trades);
+    book->add_order(far, trades);
+    book->add_order(better, trades);
+
+    auto levels = book->get_bid_levels();
+    ASSERT_EQ(levels.size(), 3);
+    EXPECT_EQ(levels[0], std::make_pair(Price(5100000), Quantity(30)));
+    EXPECT_EQ(levels[1], std::make_pair(Price(5000000), Quantity(10)));
+    EXPECT_EQ(levels[2], std::make_pair(Price(4900000), Quantity(20)));
+}
+
+TEST_F(DenseOrderBookTest, SweepAcrossOverflowRecenters)
+{
+    std::vector<Trade> trades;
+    for (int i = 0; i < 5; ++i)
+    {
+        Order ask = limit("a" + std::to_string(i), OrderSide::SELL, 10, 5000000 + i * 3000);
+        book->add_order(ask, trades);
+    }
+    EXPECT_EQ(book->get_best_ask(), 5000000);
+
+    Order sweep = limit("b", OrderSide::BUY, 45, 5000000 + 4 * 3000);
+    book->add_order(sweep, trades);
+
+    ASSERT_EQ(trades.size(), 5);
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(trades[i].price, 5000000 + i * 3000);
+    }
+    EXPECT_EQ(book->get_best_ask(), 5012000);
+    EXPECT_EQ(book->get_ask_levels()[0].second, 5);
+}
+
+TEST(PriceLadderTest, DenseMatchesMapOnRandomFlow)
+{
+    PriceScale scale{0.01, 0.0001};
+    OrderBook map_book("BTC-USDT", scale, LadderType::MAP);
+    OrderBook dense_book("BTC-USDT", scale, LadderType::DENSE);
+
+    uint64_t state = 42;
+    auto next_rand = [&state]()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state >> 33;
+    };
+
+    std::vector<Trade> map_trades, dense_trades;
+    Price mid = 5000000;
+    for (int i = 0; i < 20000; ++i)
+    {
+        mid += static_cast<Price>(next_rand() % 201) - 100;
+        OrderSide side = (next_rand() & 1) ? OrderSide::BUY : OrderSide::SELL;
+        Price offset = static_cast<Price>(next_rand() % 12000) - 1000;
+        Price price = side == OrderSide::BUY ? mid - offset : mid + offset;
+        Quantity qty = 1 + static_cast<Quantity>(next_rand() % 50);
+        std::string id = std::to_string(i);
+
+        Order a(id, "BTC-USDT", OrderType::LIMIT, side, qty, price, i);
+        a.handle = i + 1;
+        Order b = a;
+        map_book.add_order(a, map_trades);
+        dense_book.add_order(b, dense_trades);
+
+        if (i % 3 == 0)
+        {
+            OrderHandle victim = 1 + next_rand() % (i + 1);
+            EXPECT_EQ(map_book.cancel_order(victim), dense_book.cancel_order(victim));
+        }
+    }
+
+    ASSERT_EQ(map_trades.size(), dense_trades.size());
+    for (size_t i = 0; i < map_trades.size(); ++i)
+    {
+        EXPECT_EQ(map_trades[i].price, dense_trades[i].price);
+        EXPECT_EQ(map_trades[i].quantity, dense_trades[i].quantity);
+    }
+    EXPECT_EQ(map_book.get_bid_levels(1000), dense_book.get_bid_levels(1000));
+    EXPECT_EQ(map_book.get_ask_levels(1000), dense_book.get_ask_levels(1000));
+}
+
+TEST(OrderIndexTest, ChurnKeepsProbeRunsIntact)
+{
+    OrderIndex index(4);
+    std::vector<OrderNode *> expected(5001, nullptr);
+    Order dummy("x", "BTC-USDT", OrderType::LIMIT, OrderSide::BUY, 1, 1, 0);
+    std::vector<std::unique_ptr<OrderNode>> nodes;
+
+    for (OrderHandle h = 1; h <= 5000; ++h)
+    {
+        nodes.push_back(std::make_unique<OrderNode>(dummy));
+        EXPECT_TRUE(index.insert(h, nodes.back().get()));
+        expected[h] = nodes.back().get();
+    }
+    EXPECT_FALSE(index.insert(42, nodes[0].get()));
+
+    for (OrderHandle h = 1; h <= 5000; h += 3)
+    {
+        EXPECT_TRUE(index.erase(h));
+        expected[h] = nullptr;
+    }
+    EXPECT_FALSE(index.erase(1));
+
+    size_t live = 0;
+    for (OrderHandle h = 1; h <= 5000; ++h)
+    {
+        EXPECT_EQ(index.find(h), expected[h]);
+        live += expected[h] != nullptr;
+    }
+    EXPECT_EQ(index.size(), live);
+    EXPECT_EQ(index.find(6000), nullptr);
+}
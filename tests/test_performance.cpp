@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include "../include/core/order_book.hpp"
+#include "../include/core/order_types.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace GoQuant;
+
+namespace
+{
+    // Hardware cache-miss counter for the calling thread. Unavailable when
+    // the kernel or container does not expose perf events, in which case the
+    // benchmark falls back to timing only.
+    class CacheMissCounter
+    {
+    public:
+        CacheMissCounter()
+        {
+#if defined(__linux__)
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#if defined(__linux__)
+            if (fd_ >= 0)
+                close(fd_);
+#endif
+        }
+
+        bool available() const { return fd_ >= 0; }
+
+        void start()
+        {
+#if defined(__linux__)
+            if (fd_ >= 0)
+            {
+                ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        uint64_t stop()
+        {
+            uint64_t count = 0;
+#if defined(__linux__)
+            if (fd_ >= 0)
+            {
+                ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd_, &count, sizeof(count)) != sizeof(count))
+                    count = 0;
+            }
+#endif
+            return count;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    // The node layout before the hot/cold split: a full Order plus links.
+    struct FullOrderNode
+    {
+        Order order;
+        FullOrderNode *prev;
+        FullOrderNode *next;
+        PriceLevel *level;
+
+        explicit FullOrderNode(const Order &o) : order(o), prev(nullptr), next(nullptr), level(nullptr) {}
+    };
+
+    struct ScanResult
+    {
+        double ns_per_order;
+        uint64_t misses;
+        Quantity checksum;
+    };
+
+    // Links `count` nodes into one FIFO, either in allocation order or in a
+    // shuffled order that defeats the prefetcher, then walks it the way a
+    // sweeping taker does: read the handle, price and leaves of each maker.
+    template <typename Node>
+    ScanResult scan_level(size_t count, bool shuffled, CacheMissCounter &counter)
+    {
+        Order prototype("benchmark-order-0001", "BTC-USDT", OrderType::LIMIT, OrderSide::SELL, 100, 5000000, 0);
+        std::vector<Node> nodes;
+        nodes.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            prototype.handle = i + 1;
+            nodes.emplace_back(prototype);
+        }
+
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        if (shuffled)
+            std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+        for (size_t i = 0; i + 1 < count; ++i)
+            nodes[order[i]].next = &nodes[order[i + 1]];
+        nodes[order.back()].next = nullptr;
+
+        // Evict the nodes from cache before the measured walk.
+        std::vector<char> flush(64 << 20, 1);
+        volatile char sink = 0;
+        for (size_t i = 0; i < flush.size(); i += 64)
+            sink = sink + flush[i];
+
+        Quantity checksum = 0;
+        counter.start();
+        auto begin = std::chrono::steady_clock::now();
+        for (const Node *node = &nodes[order.front()]; node; node = node->next)
+        {
+            checksum += node->order.leaves_quantity + node->order.price + static_cast<Quantity>(node->order.handle);
+        }
+        auto end = std::chrono::steady_clock::now();
+        uint64_t misses = counter.stop();
+
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+        return ScanResult{ns / static_cast<double>(count), misses, checksum};
+    }
+
+    void report(const char *name, size_t node_size, size_t count, const ScanResult &result, bool counted)
+    {
+        if (counted && result.misses > 0)
+        {
+            std::printf("  %-24s %4zu B/node  %7.2f ns/order  %6.2f orders/miss\n", name, node_size,
+                        result.ns_per_order, static_cast<double>(count) / static_cast<double>(result.misses));
+        }
+        else
+        {
+            std::printf("  %-24s %4zu B/node  %7.2f ns/order  %6.2f orders/line (no perf counters)\n", name,
+                        node_size, result.ns_per_order, 64.0 / static_cast<double>(node_size));
+        }
+    }
+}
+
+TEST(LayoutBenchmark, RestingOrderFitsTheHotBudget)
+{
+    EXPECT_LE(sizeof(RestingOrder), 32u);
+    EXPECT_LE(sizeof(OrderNode), 64u);
+    EXPECT_LT(sizeof(OrderNode), sizeof(FullOrderNode));
+}
+
+TEST(LayoutBenchmark, LevelScanOrdersPerCacheMiss)
+{
+    constexpr size_t ORDERS = 1 << 18;
+    CacheMissCounter counter;
+
+    for (bool shuffled : {false, true})
+    {
+        std::printf("Level scan over %zu resting orders (%s FIFO):\n", ORDERS, shuffled ? "shuffled" : "sequential");
+
+        ScanResult compact = scan_level<OrderNode>(ORDERS, shuffled, counter);
+        ScanResult full = scan_level<FullOrderNode>(ORDERS, shuffled, counter);
+        report("hot/cold OrderNode", sizeof(OrderNode), ORDERS, compact, counter.available());
+        report("full Order node", sizeof(FullOrderNode), ORDERS, full, counter.available());
+
+        EXPECT_EQ(compact.checksum, full.checksum);
+    }
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "utils/timing_wheel.hpp"
+#include "utils/task_scheduler.hpp"
+#include <random>
+#include <vector>
+
+using namespace GoQuant;
+
+TEST(TimingWheelTest, FiresInDeadlineOrderAcrossLevels) {
+    TimingWheel wheel(1000);
+    std::vector<uint64_t> deadlines = {1000, 1001, 1063, 1064, 1065, 5095, 5096, 300000, 1000 + (1ULL << 24)};
+    for (uint64_t deadline : deadlines) {
+        wheel.schedule(deadline, deadline);
+    }
+
+    std::vector<uint64_t> fired;
+    auto record = [&fired](uint64_t key) { fired.push_back(key); };
+
+    EXPECT_EQ(wheel.advance(999, record), 0u);
+    EXPECT_EQ(wheel.advance(1064, record), 4u);
+    EXPECT_EQ(wheel.advance(300000, record), 4u);
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_EQ(wheel.advance(1000 + (1ULL << 24), record), 1u);
+    EXPECT_EQ(fired, deadlines);
+    EXPECT_EQ(wheel.get_stats().in_use, 0u);
+}
+
+TEST(TimingWheelTest, RandomDeadlinesFireExactlyOnTime) {
+    TimingWheel wheel(0);
+    std::mt19937_64 rng(7);
+    std::vector<TimerNode*> timers;
+    std::vector<bool> cancelled;
+    for (uint64_t key = 0; key < 5000; ++key) {
+        timers.push_back(wheel.schedule(rng() % 200000, key));
+        cancelled.push_back(key % 3 == 0);
+    }
+    for (uint64_t key = 0; key < timers.size(); key += 3) {
+        wheel.cancel(timers[key]);
+    }
+
+    std::vector<uint64_t> deadline(timers.size());
+    for (uint64_t key = 0; key < timers.size(); ++key) {
+        if (!cancelled[key]) {
+            deadline[key] = timers[key]->deadline;
+        }
+    }
+
+    size_t fired = 0;
+    for (uint64_t tick = 0; tick < 200000; tick += 997) {
+        fired += wheel.advance(tick, [&](uint64_t key) {
+            EXPECT_FALSE(cancelled[key]);
+            EXPECT_LE(deadline[key], tick);
+            EXPECT_GT(deadline[key] + 997, tick);
+        });
+    }
+    fired += wheel.advance(200000, [](uint64_t) {});
+    EXPECT_EQ(fired, 5000u - 1667u);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimingWheelTest, CallbackMayRescheduleWithoutRefiringSameTick) {
+    TimingWheel wheel(0);
+    wheel.schedule(5, 1);
+    int runs = 0;
+    wheel.advance(5, [&](uint64_t key) {
+        ++runs;
+        wheel.schedule(5, key);
+    });
+    EXPECT_EQ(runs, 1);
+    EXPECT_EQ(wheel.advance(6, [&](uint64_t) { ++runs; }), 1u);
+    EXPECT_EQ(runs, 2);
+}
+
+TEST(TaskSchedulerTest, RunsDueTasksAndRepeatsPeriodicOnes) {
+    TaskScheduler scheduler(std::chrono::milliseconds(1));
+    auto start = TaskScheduler::Clock::now();
+    int once = 0;
+    int periodic = 0;
+    scheduler.schedule_after(std::chrono::milliseconds(5), [&] { ++once; });
+    TaskId every = scheduler.schedule_every(std::chrono::milliseconds(10), [&] { ++periodic; });
+
+    scheduler.run_due(start + std::chrono::milliseconds(4));
+    EXPECT_EQ(once + periodic, 0);
+
+    scheduler.run_due(start + std::chrono::milliseconds(12));
+    EXPECT_EQ(once, 1);
+    EXPECT_EQ(periodic, 1);
+
+    scheduler.run_due(start + std::chrono::milliseconds(21));
+    EXPECT_EQ(periodic, 2);
+    EXPECT_EQ(scheduler.get_task_count(), 1u);
+
+    EXPECT_TRUE(scheduler.cancel(every));
+    EXPECT_FALSE(scheduler.cancel(every));
+    scheduler.run_due(start + std::chrono::milliseconds(100));
+    EXPECT_EQ(periodic, 2);
+}
+
+TEST(TaskSchedulerTest, BackgroundThreadRunsTasks) {
+    TaskScheduler scheduler(std::chrono::milliseconds(1));
+    std::atomic<int> runs{0};
+    scheduler.schedule_every(std::chrono::milliseconds(2), [&] { runs++; });
+    scheduler.start();
+    while (runs.load() < 3) {
+        std::this_thread::yield();
+    }
+    scheduler.stop();
+    EXPECT_GE(runs.load(), 3);
+}
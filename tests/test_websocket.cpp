@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "../include/api/message_decoder.hpp"
+#include "../include/api/binary_protocol.hpp"
+#include "../include/api/client_order_map.hpp"
+#include <cstddef>
+#include <string>
+
+using namespace GoQuant;
+
+TEST(MessageDecoderTest, DecodesOrderFieldsInOnePass)
+{
+    std::string frame = R"({"symbol": "BTC-USDT", "meta": {"tags": ["a", {"b": null}], "ok": true},
+                            "order_type": "limit", "side": "buy", "quantity": 1.5, "price": 50000,
+                            "order_id": "c-1", "time_in_force": "gtt", "expire_time": 4102444800000,
+                            "type": "order"})";
+
+    InboundMessage message;
+    ASSERT_TRUE(MessageDecoder::decode(frame, message));
+    EXPECT_EQ(message.type, InboundType::ORDER);
+    EXPECT_EQ(message.symbol, "BTC-USDT");
+    EXPECT_DOUBLE_EQ(message.quantity, 1.5);
+    EXPECT_DOUBLE_EQ(message.price, 50000.0);
+    EXPECT_EQ(message.expire_time, 4102444800000ULL);
+
+    OrderRequest request;
+    MessageDecoder::fill(message, request);
+    EXPECT_EQ(request.order_type, "limit");
+    EXPECT_EQ(request.side, "buy");
+    EXPECT_EQ(request.order_id, "c-1");
+    EXPECT_EQ(request.time_in_force, "gtt");
+
+    // Absent fields fall back to the defaults on the next decode.
+    ASSERT_TRUE(MessageDecoder::decode(R"({"type":"cancel","symbol":"ETH-USDT","order_id":"c-1"})", message));
+    EXPECT_EQ(message.type, InboundType::CANCEL);
+    EXPECT_TRUE(message.side.empty());
+    EXPECT_DOUBLE_EQ(message.quantity, 0.0);
+
+    ASSERT_TRUE(MessageDecoder::decode(R"({"type":"ping"})", message));
+    EXPECT_EQ(message.type, InboundType::UNKNOWN);
+}
+
+TEST(MessageDecoderTest, DeclinesWhatNeedsTheFullParser)
+{
+    InboundMessage message;
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order","order_id":"a\"b"})", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order","quantity":"1"})", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order","price":01})", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order","expire_time":-1})", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order",})", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"({"type":"order"} x)", message));
+    EXPECT_FALSE(MessageDecoder::decode(R"(["order"])", message));
+
+    // Escapes are fine in fields the decoder only skips.
+    EXPECT_TRUE(MessageDecoder::decode(R"({"type":"order","note":"a\"b"})", message));
+}
+
+TEST(BinaryProtocolTest, MessagesRoundTripThroughTheirFixedLayout)
+{
+    Binary::NewOrder order = Binary::make<Binary::NewOrder>(Binary::MessageType::NEW_ORDER);
+    order.side = static_cast<uint8_t>(OrderSide::SELL);
+    order.order_type = static_cast<uint8_t>(OrderType::LIMIT);
+    order.time_in_force = Binary::TimeInForce::GTT;
+    order.symbol_id = 1;
+    order.client_order_id = 42;
+    order.price = 5000000;
+    order.quantity = 1000;
+    order.expire_time = 4102444800000ULL;
+
+    std::string frame(Binary::bytes(order));
+    ASSERT_EQ(frame.size(), 44u);
+    EXPECT_EQ(static_cast<uint8_t>(frame[0]), Binary::PROTOCOL_VERSION);
+    EXPECT_EQ(static_cast<uint8_t>(frame[1]), 1);
+    EXPECT_EQ(static_cast<uint8_t>(frame[2]), 44);
+    EXPECT_EQ(offsetof(Binary::NewOrder, client_order_id), 12u);
+    EXPECT_EQ(static_cast<uint8_t>(frame[12]), 42);
+
+    Binary::NewOrder decoded;
+    ASSERT_TRUE(Binary::read(frame, decoded));
+    EXPECT_EQ(decoded.client_order_id, 42u);
+    EXPECT_EQ(decoded.price, 5000000);
+    EXPECT_EQ(decoded.expire_time, 4102444800000ULL);
+
+    // A frame must be exactly the message its header claims.
+    Binary::Cancel cancel;
+    EXPECT_FALSE(Binary::read(frame, cancel));
+    EXPECT_FALSE(Binary::read(std::string_view(frame).substr(0, 40), decoded));
+    frame[2] = 40;
+    EXPECT_FALSE(Binary::read(frame, decoded));
+}
+
+TEST(ClientOrderMapTest, LiveIdsCannotBeReused)
+{
+    ClientOrderMap<std::string> orders;
+    ASSERT_TRUE(orders.insert("c-1", 10));
+
+    // A second order under a live id is refused and the first stays
+    // reachable.
+    EXPECT_TRUE(orders.contains("c-1"));
+    EXPECT_FALSE(orders.insert("c-1", 11));
+    EXPECT_EQ(orders.find("c-1"), 10u);
+
+    // Only the order holding the id frees it.
+    orders.release("c-1", 11);
+    EXPECT_EQ(orders.find("c-1"), 10u);
+    orders.release("c-1", 10);
+    EXPECT_EQ(orders.find("c-1"), INVALID_ORDER_HANDLE);
+    EXPECT_TRUE(orders.insert("c-1", 12));
+    EXPECT_EQ(orders.size(), 1u);
+
+    // Binary sessions key the same way by their numeric ids.
+    ClientOrderMap<uint64_t> binary_orders;
+    ASSERT_TRUE(binary_orders.insert(42, 20));
+    EXPECT_FALSE(binary_orders.insert(42, 21));
+    EXPECT_EQ(binary_orders.find(42), 20u);
+}
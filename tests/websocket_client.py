@@ -32,7 +32,7 @@ class GoQuantClient:
         message = {
             "type": "subscribe",
             "symbol": symbol,
-            "type": subscription_type
+            "subscription_type": subscription_type
         }
         await self.websocket.send(json.dumps(message))
         print(f"Subscribed to {subscription_type} for {symbol}")